@@ -0,0 +1,126 @@
+/*!
+ * \file cdBenchMaps.hpp
+ * Synthetic maps shared by the benchmarks.
+ */
+#ifndef _CDBENCHMAPS_HPP_
+#define _CDBENCHMAPS_HPP_
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+	enum class cdBenchMapKind : int {
+		OPEN,   // No obstacles.
+		MAZE,   // 1 cell corridors, recursive backtracker.
+		ROOMS,  // 16 x 16 rooms joined by 2 cell doors.
+		RANDOM  // Independent obstacles at a given density.
+	};
+
+	inline const char* GetBenchMapName(cdBenchMapKind kind) {
+		switch (kind) {
+			case cdBenchMapKind::OPEN: return "open";
+			case cdBenchMapKind::MAZE: return "maze";
+			case cdBenchMapKind::ROOMS: return "rooms";
+			default: return "random";
+		}
+	}
+
+	inline cdGridCellList MakeBenchCells(cdBenchMapKind kind, int size, f32 density = 0.2f, u32 seed = 1) {
+		std::mt19937 rng(seed);
+		cdGridCellList cells(static_cast<size_t>(size) * size, cdGridCell());
+		auto block = [&cells, size](int x, int y) {
+			cells[y * size + x].Type = cdGridCell::CellType::BLOCKED;
+		};
+		auto open = [&cells, size](int x, int y) {
+			cells[y * size + x].Type = cdGridCell::CellType::EMPTY;
+		};
+
+		if (kind == cdBenchMapKind::RANDOM) {
+			std::uniform_real_distribution<f32> roll(0.0f, 1.0f);
+			for (int y = 0; y < size; ++y) {
+				for (int x = 0; x < size; ++x) {
+					if (roll(rng) < density) {
+						block(x, y);
+					}
+				}
+			}
+		} else if (kind == cdBenchMapKind::ROOMS) {
+			constexpr int kRoomSize = 16;
+			for (int y = 0; y < size; ++y) {
+				for (int x = 0; x < size; ++x) {
+					if (x % kRoomSize == 0 || y % kRoomSize == 0) {
+						block(x, y);
+					}
+				}
+			}
+			for (int ry = 0; ry < size; ry += kRoomSize) {
+				for (int rx = 0; rx < size; rx += kRoomSize) {
+					// Door in the middle of the west and north wall of every room.
+					int door = kRoomSize / 2;
+					for (int d = 0; d < 2; ++d) {
+						if (rx > 0 && ry + door + d < size) {
+							open(rx, ry + door + d);
+						}
+						if (ry > 0 && rx + door + d < size) {
+							open(rx + door + d, ry);
+						}
+					}
+				}
+			}
+		} else if (kind == cdBenchMapKind::MAZE) {
+			for (auto& cell : cells) {
+				cell.Type = cdGridCell::CellType::BLOCKED;
+			}
+
+			// Carve on the odd cells, knocking out the wall between each step.
+			std::vector<std::pair<int, int>> stack;
+			stack.push_back({ 1, 1 });
+			open(1, 1);
+			constexpr int kSteps[4][2] = { {2, 0}, {-2, 0}, {0, 2}, {0, -2} };
+			while (stack.empty() == false) {
+				auto [x, y] = stack.back();
+				int options[4];
+				int numOptions = 0;
+				for (int i = 0; i < 4; ++i) {
+					int nx = x + kSteps[i][0];
+					int ny = y + kSteps[i][1];
+					if (nx > 0 && ny > 0 && nx < size - 1 && ny < size - 1 &&
+						cells[ny * size + nx].Type == cdGridCell::CellType::BLOCKED) {
+						options[numOptions++] = i;
+					}
+				}
+				if (numOptions == 0) {
+					stack.pop_back();
+					continue;
+				}
+				auto step = options[std::uniform_int_distribution<int>(0, numOptions - 1)(rng)];
+				open(x + kSteps[step][0] / 2, y + kSteps[step][1] / 2);
+				open(x + kSteps[step][0], y + kSteps[step][1]);
+				stack.push_back({ x + kSteps[step][0], y + kSteps[step][1] });
+			}
+		}
+
+		return cells;
+	}
+
+	// Random open cells, handy as query endpoints.
+	inline std::vector<cdGridCoord> MakeBenchOpenCells(const cdGridMap& map, size_t count, u32 seed = 2) {
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<int> xDist(0, map.GetNumCols() - 1);
+		std::uniform_int_distribution<int> yDist(0, map.GetNumRows() - 1);
+
+		std::vector<cdGridCoord> result;
+		while (result.size() < count) {
+			cdGridCoord cell(xDist(rng), yDist(rng));
+			if (map.CellCollides(cell) == false) {
+				result.push_back(cell);
+			}
+		}
+		return result;
+	}
+}
+
+#endif
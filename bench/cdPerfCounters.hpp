@@ -0,0 +1,115 @@
+/*!
+ * \file cdPerfCounters.hpp
+ * Hardware counters through perf_event_open for the Google Benchmark suites. Counters the kernel
+ * or the machine does not give us (containers, perf_event_paranoid, other platforms) are skipped.
+ */
+#ifndef _CDPERFCOUNTERS_HPP_
+#define _CDPERFCOUNTERS_HPP_
+
+#include <benchmark/benchmark.h>
+
+#include "cdTypes.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ceed::ai::path {
+	class cdPerfCounters {
+		private:
+			static constexpr int k_NumCounters = 5;
+
+			struct Counter {
+				const char* Name;
+				u32 Type;
+				u64 Config;
+				int File;
+			};
+
+			Counter m_Counters[k_NumCounters];
+
+		public:
+
+			cdPerfCounters() {
+#ifdef __linux__
+				const u64 l1Miss = PERF_COUNT_HW_CACHE_L1D |
+					(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+					(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+				m_Counters[0] = { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1 };
+				m_Counters[1] = { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1 };
+				m_Counters[2] = { "l1d_misses", PERF_TYPE_HW_CACHE, l1Miss, -1 };
+				m_Counters[3] = { "llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, -1 };
+				m_Counters[4] = { "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, -1 };
+
+				for (auto& counter : m_Counters) {
+					perf_event_attr attr = {};
+					attr.size = sizeof(attr);
+					attr.type = counter.Type;
+					attr.config = counter.Config;
+					attr.disabled = 1;
+					attr.exclude_kernel = 1;
+					attr.exclude_hv = 1;
+					counter.File = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+				}
+#else
+				for (auto& counter : m_Counters) {
+					counter = { "", 0, 0, -1 };
+				}
+#endif
+			}
+
+			~cdPerfCounters() {
+#ifdef __linux__
+				for (auto& counter : m_Counters) {
+					if (counter.File >= 0) {
+						close(counter.File);
+					}
+				}
+#endif
+			}
+
+			cdPerfCounters(const cdPerfCounters&) = delete;
+			cdPerfCounters& operator = (const cdPerfCounters&) = delete;
+
+			void Start() {
+#ifdef __linux__
+				for (auto& counter : m_Counters) {
+					if (counter.File >= 0) {
+						ioctl(counter.File, PERF_EVENT_IOC_RESET, 0);
+						ioctl(counter.File, PERF_EVENT_IOC_ENABLE, 0);
+					}
+				}
+#endif
+			}
+
+			void Stop() {
+#ifdef __linux__
+				for (auto& counter : m_Counters) {
+					if (counter.File >= 0) {
+						ioctl(counter.File, PERF_EVENT_IOC_DISABLE, 0);
+					}
+				}
+#endif
+			}
+
+			// Adds every counter that could be opened, averaged per benchmark iteration.
+			void Report(benchmark::State& state) const {
+#ifdef __linux__
+				for (const auto& counter : m_Counters) {
+					u64 value = 0;
+					if (counter.File >= 0 && read(counter.File, &value, sizeof(value)) == sizeof(value)) {
+						state.counters[counter.Name] = benchmark::Counter(static_cast<double>(value),
+							benchmark::Counter::kAvgIterations);
+					}
+				}
+#else
+				(void)state;
+#endif
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,253 @@
+/*!
+ * \file ceedpath_bench.cpp
+ * Runs MovingAI .scen files through cdAStar + cdGridMap and reports per bucket latency,
+ * expansions and path length error against the reference optimal lengths.
+ *
+ * Every mode runs under the reference's movement rules, so each path has to come out at the
+ * optimal length. Queries that do not, or find no path, are listed and make the run fail.
+ *
+ * ceedpath_bench [--map-dir DIR] [--mode jps|grid] [--goal-bounds] [--json FILE|-] FILE.scen...
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <math.h>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "cdAStar.hpp"
+#include "cdGridMap.hpp"
+#include "cdMovingAI.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+// Relative length error still counted as optimal, for the float costs the search adds up.
+constexpr f64 kLengthTolerance = 1e-5;
+
+struct BucketStats {
+    std::vector<f64> LatenciesUs;
+    f64 ExpansionSum = 0;
+    f64 ErrorSum = 0;
+    f64 ErrorMin = std::numeric_limits<f64>::infinity();
+    f64 ErrorMax = -std::numeric_limits<f64>::infinity();
+    int Failures = 0;
+};
+
+struct BucketSummary {
+    size_t Queries;
+    int Failures;
+    f64 MeanUs, P50Us, P99Us, MaxUs;
+    f64 ExpansionsMean;
+    f64 ErrorMean, ErrorMin, ErrorMax;
+};
+
+struct Options {
+    std::string MapDir;
+    std::string JsonPath;
+    cdSearchMode Mode = cdSearchMode::JUMP_POINT;
+    bool GoalBounds = false;
+    std::vector<std::string> Scenarios;
+};
+
+f64 Percentile(const std::vector<f64>& sorted, f64 fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    auto idx = static_cast<size_t>(fraction * static_cast<f64>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+BucketSummary Summarize(const BucketStats& stats) {
+    auto sorted = stats.LatenciesUs;
+    std::sort(sorted.begin(), sorted.end());
+
+    f64 total = 0;
+    for (auto latency : sorted) {
+        total += latency;
+    }
+    auto count = static_cast<f64>(std::max<size_t>(sorted.size(), 1));
+    auto numSolved = sorted.size() - stats.Failures;
+    auto solved = static_cast<f64>(std::max<size_t>(numSolved, 1));
+
+    BucketSummary summary;
+    summary.Queries = sorted.size();
+    summary.Failures = stats.Failures;
+    summary.MeanUs = total / count;
+    summary.P50Us = Percentile(sorted, 0.5);
+    summary.P99Us = Percentile(sorted, 0.99);
+    summary.MaxUs = sorted.empty() ? 0.0 : sorted.back();
+    summary.ExpansionsMean = stats.ExpansionSum / count;
+    summary.ErrorMean = stats.ErrorSum / solved;
+    summary.ErrorMin = numSolved > 0 ? stats.ErrorMin : 0.0;
+    summary.ErrorMax = numSolved > 0 ? stats.ErrorMax : 0.0;
+    return summary;
+}
+
+std::string GetDirectory(const std::string& path) {
+    auto slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+}
+
+std::string GetFileName(const std::string& path) {
+    auto slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--map-dir") == 0 && i + 1 < argc) {
+            options.MapDir = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            options.JsonPath = argv[++i];
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "grid") == 0) {
+                options.Mode = cdSearchMode::GRID;
+            } else if (strcmp(argv[i], "jps") != 0) {
+                return false;
+            }
+        } else if (strcmp(argv[i], "--goal-bounds") == 0) {
+            options.GoalBounds = true;
+        } else if (argv[i][0] == '-') {
+            return false;
+        } else {
+            options.Scenarios.push_back(argv[i]);
+        }
+    }
+    return options.Scenarios.empty() == false;
+}
+
+cdGridMap* GetMap(std::map<std::string, std::unique_ptr<cdGridMap>>& maps,
+    const Options& options, const std::string& scenarioPath, const std::string& mapName) {
+    auto found = maps.find(mapName);
+    if (found != maps.end()) {
+        return found->second.get();
+    }
+
+    auto dir = options.MapDir.empty() ? GetDirectory(scenarioPath) : options.MapDir;
+    auto map = LoadMovingAIMap((dir + "/" + mapName).c_str());
+    if (map == nullptr) {
+        map = LoadMovingAIMap((dir + "/" + GetFileName(mapName)).c_str());
+    }
+    if (map == nullptr) {
+        fprintf(stderr, "failed to load map %s\n", mapName.c_str());
+        return nullptr;
+    }
+
+    SetMovingAISearchMode(*map, options.Mode);
+    if (options.GoalBounds) {
+        map->BuildGoalBounds();
+    }
+
+    auto result = map.get();
+    maps[mapName] = std::move(map);
+    return result;
+}
+
+void WriteJson(FILE* out, const Options& options, const std::map<int, BucketStats>& buckets) {
+    fprintf(out, "{\n  \"mode\": \"%s\",\n  \"goal_bounds\": %s,\n  \"buckets\": [",
+        options.Mode == cdSearchMode::GRID ? "grid" : "jps", options.GoalBounds ? "true" : "false");
+
+    bool first = true;
+    for (const auto& [bucket, stats] : buckets) {
+        auto summary = Summarize(stats);
+        fprintf(out, "%s\n    {\"bucket\": %d, \"queries\": %zu, \"failures\": %d, "
+            "\"latency_us\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}, "
+            "\"expansions_mean\": %.1f, \"length_error\": {\"mean\": %.6f, \"min\": %.6f, \"max\": %.6f}}",
+            first ? "" : ",", bucket, summary.Queries, summary.Failures,
+            summary.MeanUs, summary.P50Us, summary.P99Us, summary.MaxUs,
+            summary.ExpansionsMean, summary.ErrorMean, summary.ErrorMin, summary.ErrorMax);
+        first = false;
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (ParseOptions(argc, argv, options) == false) {
+        fprintf(stderr, "usage: %s [--map-dir DIR] [--mode jps|grid] [--goal-bounds] [--json FILE|-] FILE.scen...\n",
+            argv[0]);
+        return 1;
+    }
+
+    std::map<std::string, std::unique_ptr<cdGridMap>> maps;
+    std::map<int, BucketStats> buckets;
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    int numMismatches = 0;
+
+    for (const auto& scenarioPath : options.Scenarios) {
+        std::vector<cdMovingAIScenario> scenarios;
+        if (LoadMovingAIScenarios(scenarioPath.c_str(), scenarios) == false) {
+            fprintf(stderr, "failed to load scenarios %s\n", scenarioPath.c_str());
+            return 1;
+        }
+
+        for (const auto& scenario : scenarios) {
+            auto map = GetMap(maps, options, scenarioPath, scenario.MapName);
+            if (map == nullptr) {
+                return 1;
+            }
+
+            resultPath.clear();
+            auto begin = std::chrono::steady_clock::now();
+            auto found = aStar.FindPath(scenario.Start, scenario.Goal, map, resultPath);
+            auto end = std::chrono::steady_clock::now();
+
+            auto& stats = buckets[scenario.Bucket];
+            stats.LatenciesUs.push_back(std::chrono::duration<f64, std::micro>(end - begin).count());
+            stats.ExpansionSum += static_cast<f64>(aStar.GetNumExpansions());
+            if (found == false) {
+                ++stats.Failures;
+                ++numMismatches;
+                fprintf(stderr, "%s: no path from (%d, %d) to (%d, %d), optimal %.8f\n", scenario.MapName.c_str(),
+                    scenario.Start.X, scenario.Start.Y, scenario.Goal.X, scenario.Goal.Y, scenario.OptimalLength);
+                continue;
+            }
+
+            auto error = GetPathLengthError(resultPath, scenario.OptimalLength);
+            if (fabs(error) > kLengthTolerance) {
+                ++numMismatches;
+                fprintf(stderr, "%s: path from (%d, %d) to (%d, %d) is %.8f long, optimal %.8f\n",
+                    scenario.MapName.c_str(), scenario.Start.X, scenario.Start.Y, scenario.Goal.X, scenario.Goal.Y,
+                    GetOctilePathLength(resultPath), scenario.OptimalLength);
+            }
+            stats.ErrorSum += error;
+            stats.ErrorMin = std::min(stats.ErrorMin, error);
+            stats.ErrorMax = std::max(stats.ErrorMax, error);
+        }
+    }
+
+    printf("%-8s %8s %8s %12s %12s %12s %12s %12s %12s %12s %12s\n", "bucket", "queries", "failed",
+        "mean_us", "p50_us", "p99_us", "max_us", "expansions", "len_err", "len_err_min", "len_err_max");
+    for (const auto& [bucket, stats] : buckets) {
+        auto summary = Summarize(stats);
+        printf("%-8d %8zu %8d %12.2f %12.2f %12.2f %12.2f %12.1f %12.6f %12.6f %12.6f\n", bucket,
+            summary.Queries, summary.Failures, summary.MeanUs, summary.P50Us, summary.P99Us, summary.MaxUs,
+            summary.ExpansionsMean, summary.ErrorMean, summary.ErrorMin, summary.ErrorMax);
+    }
+
+    if (options.JsonPath.empty() == false) {
+        auto out = options.JsonPath == "-" ? stdout : fopen(options.JsonPath.c_str(), "w");
+        if (out == nullptr) {
+            fprintf(stderr, "failed to open %s\n", options.JsonPath.c_str());
+            return 1;
+        }
+        WriteJson(out, options, buckets);
+        if (out != stdout) {
+            fclose(out);
+        }
+    }
+
+    if (numMismatches > 0) {
+        fprintf(stderr, "%d queries missed the optimal length\n", numMismatches);
+        return 1;
+    }
+    return 0;
+}
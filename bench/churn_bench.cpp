@@ -0,0 +1,231 @@
+/*!
+ * \file churn_bench.cpp
+ * Edits a cdGridMap every frame while agents keep querying it, to find the edit rate at which
+ * cdGridMap::SetCell's incremental upkeep costs more than rebuilding the derived layers.
+ *
+ * Each frame applies a batch of random edits, then runs a set of queries. Edits are split into
+ * threat only edits (cell and threat layer) and blocking flips, which also update the occupancy
+ * bits, neighbour masks and clearance. The rebuild column builds the same layers from scratch
+ * over the edited cells. With --goal-bounds the map starts with goal bounds, which every
+ * blocking edit drops, and the rebuild column includes building them again.
+ *
+ * churn_bench [--map open|maze|rooms|random] [--size N] [--frames N] [--queries N]
+ *             [--flip-fraction F] [--goal-bounds] [--seed N]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <span>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "cdAStar.hpp"
+#include "cdBenchMaps.hpp"
+#include "cdGridMap.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+// Edits per frame swept by the benchmark.
+constexpr int kEditRates[] = { 1, 4, 16, 64, 256, 1024, 4096 };
+
+struct Options {
+    int Size = 256;
+    int NumFrames = 20;
+    size_t NumQueries = 50;
+    f32 FlipFraction = 0.5f;
+    bool GoalBounds = false;
+    u32 Seed = 1;
+    cdBenchMapKind Kind = cdBenchMapKind::ROOMS;
+};
+
+struct RateResult {
+    f64 ThreatEditUs = 0;   // Per threat only edit.
+    f64 FlipEditUs = 0;     // Per blocking flip.
+    f64 FrameEditUs = 0;    // Whole batch, summed over its SetCell calls only.
+    f64 RebuildUs = 0;      // Derived layers from scratch, per frame.
+    f64 QueryP50Us = 0;
+    f64 QueryP99Us = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+f64 GetElapsedUs(Clock::time_point begin) {
+    return std::chrono::duration<f64, std::micro>(Clock::now() - begin).count();
+}
+
+f64 Percentile(const std::vector<f64>& sorted, f64 fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    auto idx = static_cast<size_t>(fraction * static_cast<f64>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            options.Size = std::max(atoi(argv[++i]), 16);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            options.NumFrames = std::max(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            options.NumQueries = static_cast<size_t>(std::max(atoi(argv[++i]), 1));
+        } else if (strcmp(argv[i], "--flip-fraction") == 0 && i + 1 < argc) {
+            options.FlipFraction = std::clamp(static_cast<f32>(atof(argv[++i])), 0.0f, 1.0f);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.Seed = static_cast<u32>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--goal-bounds") == 0) {
+            options.GoalBounds = true;
+        } else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+            ++i;
+            bool found = false;
+            for (auto kind : { cdBenchMapKind::OPEN, cdBenchMapKind::MAZE, cdBenchMapKind::ROOMS, cdBenchMapKind::RANDOM }) {
+                if (strcmp(argv[i], GetBenchMapName(kind)) == 0) {
+                    options.Kind = kind;
+                    found = true;
+                }
+            }
+            if (found == false) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Query latencies on the map, endpoints drawn from whatever is open right now.
+void RunQueries(cdGridMap& map, size_t count, u32 seed, std::vector<f64>& latencies) {
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    auto endpoints = MakeBenchOpenCells(map, count * 2, seed);
+    for (size_t i = 0; i < count; ++i) {
+        resultPath.clear();
+        auto begin = Clock::now();
+        aStar.FindPath(endpoints[i * 2], endpoints[i * 2 + 1], &map, resultPath);
+        latencies.push_back(GetElapsedUs(begin));
+    }
+}
+
+RateResult RunRate(const Options& options, int editsPerFrame) {
+    auto size = options.Size;
+    cdPoint2f dimension(static_cast<f32>(size), static_cast<f32>(size));
+    auto cells = MakeBenchCells(options.Kind, size);
+    // Mirrors the edits so the rebuild sees the same cells.
+    auto mirror = cells;
+    cdGridMap map(std::move(cells), size, size, dimension);
+    if (options.GoalBounds) {
+        map.BuildGoalBounds();
+    }
+
+    std::mt19937 rng(options.Seed);
+    std::uniform_int_distribution<int> coordDist(0, size - 1);
+    std::uniform_real_distribution<f32> roll(0.0f, 1.0f);
+
+    RateResult result;
+    f64 threatUs = 0, flipUs = 0;
+    size_t numThreat = 0, numFlip = 0;
+    std::vector<f64> latencies;
+
+    for (int frame = 0; frame < options.NumFrames; ++frame) {
+        for (int edit = 0; edit < editsPerFrame; ++edit) {
+            cdGridCoord coord(coordDist(rng), coordDist(rng));
+            auto value = map.GetCell(coord);
+            auto flip = roll(rng) < options.FlipFraction;
+            if (flip) {
+                value.Type = value.Type == cdGridCell::CellType::BLOCKED ?
+                    cdGridCell::CellType::EMPTY : cdGridCell::CellType::BLOCKED;
+            } else {
+                value.Threat = roll(rng);
+            }
+
+            auto begin = Clock::now();
+            map.SetCell(coord, value);
+            auto elapsed = GetElapsedUs(begin);
+            result.FrameEditUs += elapsed;
+            mirror[coord.Y * size + coord.X] = value;
+
+            if (flip) {
+                flipUs += elapsed;
+                ++numFlip;
+            } else {
+                threatUs += elapsed;
+                ++numThreat;
+            }
+        }
+
+        // Same work as dropping the layers and building them again.
+        auto rebuildBegin = Clock::now();
+        {
+            cdGridMap rebuilt(std::span<const cdGridCell>(mirror), size, size, dimension);
+            if (options.GoalBounds) {
+                rebuilt.BuildGoalBounds();
+            }
+        }
+        result.RebuildUs += GetElapsedUs(rebuildBegin);
+
+        RunQueries(map, options.NumQueries, options.Seed + static_cast<u32>(frame), latencies);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto numFrames = static_cast<f64>(options.NumFrames);
+    result.ThreatEditUs = numThreat > 0 ? threatUs / static_cast<f64>(numThreat) : 0.0;
+    result.FlipEditUs = numFlip > 0 ? flipUs / static_cast<f64>(numFlip) : 0.0;
+    result.FrameEditUs /= numFrames;
+    result.RebuildUs /= numFrames;
+    result.QueryP50Us = Percentile(latencies, 0.5);
+    result.QueryP99Us = Percentile(latencies, 0.99);
+    return result;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (ParseOptions(argc, argv, options) == false) {
+        fprintf(stderr, "usage: %s [--map open|maze|rooms|random] [--size N] [--frames N] [--queries N] "
+            "[--flip-fraction F] [--goal-bounds] [--seed N]\n", argv[0]);
+        return 1;
+    }
+
+    // Query latency on the untouched map is the baseline for the churned runs.
+    auto size = options.Size;
+    cdGridMap baseline(MakeBenchCells(options.Kind, size), size, size,
+        cdPoint2f(static_cast<f32>(size), static_cast<f32>(size)));
+    if (options.GoalBounds) {
+        baseline.BuildGoalBounds();
+    }
+    std::vector<f64> latencies;
+    for (int frame = 0; frame < options.NumFrames; ++frame) {
+        RunQueries(baseline, options.NumQueries, options.Seed + static_cast<u32>(frame), latencies);
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    printf("map %s %dx%d, %d frames, %zu queries per frame, %.0f%% blocking flips%s\n",
+        GetBenchMapName(options.Kind), size, size, options.NumFrames, options.NumQueries,
+        options.FlipFraction * 100.0f, options.GoalBounds ? ", goal bounds" : "");
+    printf("static map queries: p50 %.2f us, p99 %.2f us\n", Percentile(latencies, 0.5), Percentile(latencies, 0.99));
+    printf("%8s %12s %12s %14s %14s %8s %12s %12s\n", "edits", "threat_us", "flip_us", "frame_edit_us",
+        "rebuild_us", "ratio", "query_p50", "query_p99");
+
+    int crossover = 0;
+    for (auto rate : kEditRates) {
+        auto result = RunRate(options, rate);
+        auto ratio = result.FrameEditUs / std::max(result.RebuildUs, 1e-9);
+        printf("%8d %12.3f %12.3f %14.2f %14.2f %8.3f %12.2f %12.2f\n", rate, result.ThreatEditUs,
+            result.FlipEditUs, result.FrameEditUs, result.RebuildUs, ratio, result.QueryP50Us, result.QueryP99Us);
+        if (crossover == 0 && ratio >= 1.0) {
+            crossover = rate;
+        }
+    }
+
+    if (crossover > 0) {
+        printf("rebuilding is cheaper from about %d edits per frame\n", crossover);
+    } else {
+        printf("incremental updates stay cheaper up to %d edits per frame\n", kEditRates[std::size(kEditRates) - 1]);
+    }
+    return 0;
+}
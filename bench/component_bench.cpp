@@ -0,0 +1,242 @@
+/*!
+ * \file component_bench.cpp
+ * Microbenchmarks for the pieces a search spends its time in, on synthetic maps, with hardware
+ * counters where perf_event_open is available.
+ */
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <functional>
+#include <random>
+
+#include "cdAStar.hpp"
+#include "cdBenchMaps.hpp"
+#include "cdGridMap.hpp"
+#include "cdPerfCounters.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+constexpr int kMapSize = 256;
+constexpr int kPruneMapSize = 96;
+constexpr size_t kNumQueryCells = 1024;
+// Diagonal jumps on open maps scan whole rows and columns per step, keep these few.
+constexpr size_t kNumJumpCells = 64;
+
+// Opens up the JPS internals for benchmarking.
+class cdBenchGridMap : public cdGridMap {
+    public:
+        using cdGridMap::cdGridMap;
+        using cdJumpStartMap::Jump;
+        using cdJumpStartMap::Prune;
+};
+
+std::unique_ptr<cdBenchGridMap> MakeMap(const benchmark::State& state, int size) {
+    auto kind = static_cast<cdBenchMapKind>(state.range(0));
+    auto density = static_cast<f32>(state.range(1)) / 100.0f;
+    return std::make_unique<cdBenchGridMap>(MakeBenchCells(kind, size, density), size, size,
+        cdPoint2f(static_cast<f32>(size), static_cast<f32>(size)));
+}
+
+void SetMapLabel(benchmark::State& state) {
+    auto kind = static_cast<cdBenchMapKind>(state.range(0));
+    if (kind == cdBenchMapKind::RANDOM) {
+        state.SetLabel(std::string("random_") + std::to_string(state.range(1)));
+    } else {
+        state.SetLabel(GetBenchMapName(kind));
+    }
+}
+
+void MapArgs(benchmark::internal::Benchmark* bench) {
+    bench->ArgNames({ "map", "density" });
+    bench->Args({ static_cast<int>(cdBenchMapKind::OPEN), 0 });
+    bench->Args({ static_cast<int>(cdBenchMapKind::MAZE), 0 });
+    bench->Args({ static_cast<int>(cdBenchMapKind::ROOMS), 0 });
+    bench->Args({ static_cast<int>(cdBenchMapKind::RANDOM), 10 });
+    bench->Args({ static_cast<int>(cdBenchMapKind::RANDOM), 20 });
+    bench->Args({ static_cast<int>(cdBenchMapKind::RANDOM), 35 });
+}
+}
+
+static void BM_CellCollides(benchmark::State& state) {
+    auto map = MakeMap(state, kMapSize);
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> coord(0, kMapSize - 1);
+    std::vector<cdGridCoord> cells(kNumQueryCells);
+    for (auto& cell : cells) {
+        cell = cdGridCoord(coord(rng), coord(rng));
+    }
+
+    cdPerfCounters counters;
+    counters.Start();
+    for (auto _ : state) {
+        int hits = 0;
+        for (const auto& cell : cells) {
+            hits += map->CellCollides(cell) ? 1 : 0;
+        }
+        benchmark::DoNotOptimize(hits);
+    }
+    counters.Stop();
+    counters.Report(state);
+    state.SetItemsProcessed(state.iterations() * cells.size());
+    SetMapLabel(state);
+}
+BENCHMARK(BM_CellCollides)->Apply(MapArgs);
+
+static void BM_Jump(benchmark::State& state) {
+    auto map = MakeMap(state, kMapSize);
+    auto cells = MakeBenchOpenCells(*map, kNumJumpCells);
+    std::vector<cdGridCoord> goals = { cells.back() };
+
+    cdPerfCounters counters;
+    counters.Start();
+    for (auto _ : state) {
+        int jumpPoints = 0;
+        cdGridCoord result;
+        for (const auto& cell : cells) {
+            for (const auto& dir : k_GridDirections) {
+                jumpPoints += map->Jump(cell, dir.X, dir.Y, cells.front(), goals, result) ? 1 : 0;
+            }
+        }
+        benchmark::DoNotOptimize(jumpPoints);
+    }
+    counters.Stop();
+    counters.Report(state);
+    state.SetItemsProcessed(state.iterations() * cells.size() * 8);
+    SetMapLabel(state);
+}
+BENCHMARK(BM_Jump)->Apply(MapArgs);
+
+static void BM_Prune(benchmark::State& state) {
+    // Prune needs real parents, so take the closed list of a finished search. The straight line
+    // shortcut would answer open maps without one.
+    auto map = MakeMap(state, kPruneMapSize);
+    map->SetLineOfSightShortcut(false);
+    auto cells = MakeBenchOpenCells(*map, 2);
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> path;
+    aStar.FindPath(cells[0], cells[1], map.get(), path);
+
+    std::vector<cdNode<cdGridCoord>> nodes;
+    cdNode<cdGridCoord> node;
+    for (int i = 0; aStar.GetNodeFromClosedList(i, node); ++i) {
+        nodes.push_back(node);
+    }
+    if (nodes.empty()) {
+        state.SkipWithError("search left no closed list to prune");
+        return;
+    }
+
+    std::vector<cdGridCoord> result;
+    cdPerfCounters counters;
+    counters.Start();
+    for (auto _ : state) {
+        for (const auto& current : nodes) {
+            result.clear();
+            map->Prune(&aStar, current, result);
+        }
+        benchmark::DoNotOptimize(result.data());
+    }
+    counters.Stop();
+    counters.Report(state);
+    state.SetItemsProcessed(state.iterations() * nodes.size());
+    SetMapLabel(state);
+}
+BENCHMARK(BM_Prune)->Apply(MapArgs);
+
+static void BM_GetHeuristics(benchmark::State& state) {
+    auto map = MakeMap(state, kMapSize);
+    auto cells = MakeBenchOpenCells(*map, kNumQueryCells);
+    std::vector<cdGridCoord> goals(cells.end() - state.range(2), cells.end());
+
+    cdPerfCounters counters;
+    counters.Start();
+    for (auto _ : state) {
+        f32 total = 0;
+        for (const auto& cell : cells) {
+            total += map->GetHeuristics(cell, cells.front(), goals);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    counters.Stop();
+    counters.Report(state);
+    state.SetItemsProcessed(state.iterations() * cells.size());
+    SetMapLabel(state);
+}
+BENCHMARK(BM_GetHeuristics)
+    ->ArgNames({ "map", "density", "goals" })
+    ->Args({ static_cast<int>(cdBenchMapKind::OPEN), 0, 1 })
+    ->Args({ static_cast<int>(cdBenchMapKind::OPEN), 0, 16 });
+
+// Visibility checks between random open cells, one at a time against the batched rays.
+static void BM_HasLineOfSight(benchmark::State& state) {
+    auto map = MakeMap(state, kMapSize);
+    auto from = MakeBenchOpenCells(*map, kNumQueryCells, 5);
+    auto to = MakeBenchOpenCells(*map, kNumQueryCells, 6);
+
+    cdPerfCounters counters;
+    counters.Start();
+    for (auto _ : state) {
+        int visible = 0;
+        for (size_t i = 0; i < from.size(); ++i) {
+            visible += map->HasLineOfSight(from[i], to[i]) ? 1 : 0;
+        }
+        benchmark::DoNotOptimize(visible);
+    }
+    counters.Stop();
+    counters.Report(state);
+    state.SetItemsProcessed(state.iterations() * from.size());
+    SetMapLabel(state);
+}
+BENCHMARK(BM_HasLineOfSight)->Apply(MapArgs);
+
+static void BM_CastRays(benchmark::State& state) {
+    auto map = MakeMap(state, kMapSize);
+    auto from = MakeBenchOpenCells(*map, kNumQueryCells, 5);
+    auto to = MakeBenchOpenCells(*map, kNumQueryCells, 6);
+    std::vector<u8> hits(from.size());
+    std::vector<cdGridCoord> firstHits(from.size());
+
+    cdPerfCounters counters;
+    counters.Start();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map->CastRays(from, to, hits, firstHits));
+    }
+    counters.Stop();
+    counters.Report(state);
+    state.SetItemsProcessed(state.iterations() * from.size());
+    SetMapLabel(state);
+}
+BENCHMARK(BM_CastRays)->Apply(MapArgs);
+
+static void BM_OpenListPushPop(benchmark::State& state) {
+    // Same heap discipline as cdAStar::FindPath.
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<f32> score(0.0f, 512.0f);
+    std::vector<cdNode<cdGridCoord>> nodes(static_cast<size_t>(state.range(0)));
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        nodes[i] = cdNode<cdGridCoord>(cdGridCoord(static_cast<int>(i), 0), score(rng), score(rng));
+    }
+
+    std::vector<cdNode<cdGridCoord>> openList;
+    openList.reserve(nodes.size());
+    std::greater<cdNode<cdGridCoord>> compare;
+
+    cdPerfCounters counters;
+    counters.Start();
+    for (auto _ : state) {
+        for (const auto& node : nodes) {
+            openList.push_back(node);
+            push_heap(openList.begin(), openList.end(), compare);
+        }
+        while (openList.empty() == false) {
+            pop_heap(openList.begin(), openList.end(), compare);
+            openList.pop_back();
+        }
+        benchmark::ClobberMemory();
+    }
+    counters.Stop();
+    counters.Report(state);
+    state.SetItemsProcessed(state.iterations() * nodes.size());
+}
+BENCHMARK(BM_OpenListPushPop)->Arg(64)->Arg(1024)->Arg(16384);
@@ -0,0 +1,156 @@
+/*!
+ * \file layout_bench.cpp
+ * Row major vs tiled cell layout on wide maps, for raw neighbourhood access and for JPS and
+ * plain grid A* queries, with hardware counters where perf_event_open is available.
+ */
+
+#include <benchmark/benchmark.h>
+#include <random>
+
+#include "cdAStar.hpp"
+#include "cdBenchMaps.hpp"
+#include "cdGridMap.hpp"
+#include "cdPerfCounters.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+// Wide enough that a row major column step is always a new cache line and page.
+constexpr int kScanMapSize = 2048;
+constexpr int kQueryMapSize = 512;
+constexpr size_t kNumQueries = 64;
+// Grid A* scans its lists linearly, keep its queries short.
+constexpr int kGridQueryRadius = 24;
+
+const char* GetLayoutName(cdCellLayout layout) {
+    return layout == cdCellLayout::TILED ? "tiled" : "row_major";
+}
+
+std::unique_ptr<cdGridMap> MakeMap(cdBenchMapKind kind, int size, cdCellLayout layout) {
+    auto map = std::make_unique<cdGridMap>(MakeBenchCells(kind, size, 0.2f), size, size,
+        cdPoint2f(static_cast<f32>(size), static_cast<f32>(size)));
+    map->SetCellLayout(layout);
+    return map;
+}
+
+// Open start and goal pairs, goals within radius of their start when the radius is set.
+std::vector<std::pair<cdGridCoord, cdGridCoord>> MakeQueries(const cdGridMap& map, int radius) {
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> offset(-radius, radius);
+    auto starts = MakeBenchOpenCells(map, kNumQueries, 3);
+    auto goals = MakeBenchOpenCells(map, kNumQueries, 4);
+
+    std::vector<std::pair<cdGridCoord, cdGridCoord>> queries;
+    for (size_t i = 0; i < kNumQueries; ++i) {
+        auto goal = goals[i];
+        while (radius > 0) {
+            goal = cdGridCoord(starts[i].X + offset(rng), starts[i].Y + offset(rng));
+            if (map.CellCollides(goal) == false) {
+                break;
+            }
+        }
+        queries.push_back({ starts[i], goal });
+    }
+    return queries;
+}
+
+void RunQueries(benchmark::State& state, cdSearchMode mode, int radius) {
+    auto layout = static_cast<cdCellLayout>(state.range(0));
+    auto kind = static_cast<cdBenchMapKind>(state.range(1));
+    auto map = MakeMap(kind, kQueryMapSize, layout);
+    map->SetSearchMode(mode);
+    auto queries = MakeQueries(*map, radius);
+
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    size_t expansions = 0;
+
+    cdPerfCounters counters;
+    counters.Start();
+    for (auto _ : state) {
+        for (const auto& [start, goal] : queries) {
+            resultPath.clear();
+            benchmark::DoNotOptimize(aStar.FindPath(start, goal, map.get(), resultPath));
+            expansions += aStar.GetNumExpansions();
+        }
+    }
+    counters.Stop();
+    counters.Report(state);
+    state.SetItemsProcessed(state.iterations() * queries.size());
+    state.counters["expansions"] = benchmark::Counter(static_cast<double>(expansions),
+        benchmark::Counter::kAvgIterations);
+    state.SetLabel(std::string(GetLayoutName(layout)) + "/" + GetBenchMapName(kind));
+}
+
+void LayoutArgs(benchmark::internal::Benchmark* bench) {
+    bench->ArgNames({ "layout", "map" });
+    for (auto layout : { cdCellLayout::ROW_MAJOR, cdCellLayout::TILED }) {
+        for (auto kind : { cdBenchMapKind::ROOMS, cdBenchMapKind::RANDOM }) {
+            bench->Args({ static_cast<int>(layout), static_cast<int>(kind) });
+        }
+    }
+}
+}
+
+// Walks every column top to bottom, the worst case for row major.
+static void BM_ColumnWalk(benchmark::State& state) {
+    auto layout = static_cast<cdCellLayout>(state.range(0));
+    auto map = MakeMap(cdBenchMapKind::RANDOM, kScanMapSize, layout);
+
+    cdPerfCounters counters;
+    counters.Start();
+    for (auto _ : state) {
+        int open = 0;
+        for (int x = 0; x < kScanMapSize; ++x) {
+            for (int y = 0; y < kScanMapSize; ++y) {
+                open += map->CellCollides(cdGridCoord(x, y)) ? 0 : 1;
+            }
+        }
+        benchmark::DoNotOptimize(open);
+    }
+    counters.Stop();
+    counters.Report(state);
+    state.SetItemsProcessed(state.iterations() * kScanMapSize * kScanMapSize);
+    state.SetLabel(GetLayoutName(layout));
+}
+BENCHMARK(BM_ColumnWalk)
+    ->ArgName("layout")
+    ->Arg(static_cast<int>(cdCellLayout::ROW_MAJOR))
+    ->Arg(static_cast<int>(cdCellLayout::TILED));
+
+// The 3x3 neighbourhood around every cell, what Prune and the grid successors read.
+static void BM_Neighbourhood(benchmark::State& state) {
+    auto layout = static_cast<cdCellLayout>(state.range(0));
+    auto map = MakeMap(cdBenchMapKind::RANDOM, kScanMapSize, layout);
+    auto cells = MakeBenchOpenCells(*map, 4096, 6);
+
+    cdPerfCounters counters;
+    counters.Start();
+    for (auto _ : state) {
+        int open = 0;
+        for (const auto& cell : cells) {
+            for (const auto& dir : k_GridDirections) {
+                open += map->CellCollides(cdGridCoord(cell.X + dir.X, cell.Y + dir.Y)) ? 0 : 1;
+            }
+        }
+        benchmark::DoNotOptimize(open);
+    }
+    counters.Stop();
+    counters.Report(state);
+    state.SetItemsProcessed(state.iterations() * cells.size());
+    state.SetLabel(GetLayoutName(layout));
+}
+BENCHMARK(BM_Neighbourhood)
+    ->ArgName("layout")
+    ->Arg(static_cast<int>(cdCellLayout::ROW_MAJOR))
+    ->Arg(static_cast<int>(cdCellLayout::TILED));
+
+static void BM_FindPathJps(benchmark::State& state) {
+    RunQueries(state, cdSearchMode::JUMP_POINT, 0);
+}
+BENCHMARK(BM_FindPathJps)->Apply(LayoutArgs)->Unit(benchmark::kMillisecond);
+
+static void BM_FindPathGrid(benchmark::State& state) {
+    RunQueries(state, cdSearchMode::GRID, kGridQueryRadius);
+}
+BENCHMARK(BM_FindPathGrid)->Apply(LayoutArgs)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,243 @@
+/*!
+ * \file replay_bench.cpp
+ * Replays a cdQueryRecorder log against map snapshots with this build and compares latency and
+ * results with what was recorded.
+ *
+ * Every map id in the log needs a snapshot, either a .cdmap written by cdMapFile::Write or a
+ * MovingAI .map. The search settings of each record are applied to its map before the query.
+ * A snapshot given as ID=FILE@VERSION was taken at that cdGridMap::GetVersion of the live map,
+ * records of that map on any other version are counted as version drift, their results can
+ * differ for good reason.
+ *
+ * replay_bench --map ID=FILE[@VERSION] [--map ...] [--repeat N] [--json FILE|-] LOG
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "cdAStar.hpp"
+#include "cdGridMap.hpp"
+#include "cdMapFile.hpp"
+#include "cdMovingAI.hpp"
+#include "cdQueryRecorder.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+struct Options {
+    std::map<u32, std::string> MapPaths;
+    std::map<u32, u32> MapVersions;
+    std::string LogPath;
+    std::string JsonPath;
+    int Repeat = 1;
+};
+
+struct LatencySummary {
+    f64 MeanUs, P50Us, P99Us, MaxUs;
+};
+
+struct ReplayStats {
+    std::vector<f64> RecordedUs;
+    std::vector<f64> ReplayUs;
+    size_t Skipped = 0;
+    size_t FoundMismatches = 0;
+    size_t ExpansionMismatches = 0;
+    // Records of a map on another live version than its snapshot, see ID=FILE@VERSION.
+    size_t VersionDrift = 0;
+};
+
+f64 Percentile(const std::vector<f64>& sorted, f64 fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    auto idx = static_cast<size_t>(fraction * static_cast<f64>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+LatencySummary Summarize(std::vector<f64> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    f64 total = 0;
+    for (auto latency : latencies) {
+        total += latency;
+    }
+
+    LatencySummary summary;
+    summary.MeanUs = total / static_cast<f64>(std::max<size_t>(latencies.size(), 1));
+    summary.P50Us = Percentile(latencies, 0.5);
+    summary.P99Us = Percentile(latencies, 0.99);
+    summary.MaxUs = latencies.empty() ? 0.0 : latencies.back();
+    return summary;
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+            auto arg = std::string(argv[++i]);
+            auto eq = arg.find('=');
+            if (eq == std::string::npos || eq == 0) {
+                return false;
+            }
+            const auto id = static_cast<u32>(strtoul(arg.substr(0, eq).c_str(), nullptr, 10));
+            auto path = arg.substr(eq + 1);
+            auto at = path.rfind('@');
+            if (at != std::string::npos) {
+                options.MapVersions[id] = static_cast<u32>(strtoul(path.substr(at + 1).c_str(), nullptr, 10));
+                path.resize(at);
+            }
+            options.MapPaths[id] = path;
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            options.Repeat = std::max(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            options.JsonPath = argv[++i];
+        } else if (argv[i][0] == '-' || options.LogPath.empty() == false) {
+            return false;
+        } else {
+            options.LogPath = argv[i];
+        }
+    }
+    return options.LogPath.empty() == false && options.MapPaths.empty() == false;
+}
+
+std::unique_ptr<cdGridMap> LoadSnapshot(const std::string& path) {
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".map") == 0) {
+        return LoadMovingAIMap(path.c_str());
+    }
+
+    auto file = std::make_shared<cdMapFile>();
+    if (file->Open(path.c_str()) == false) {
+        return nullptr;
+    }
+    return std::make_unique<cdGridMap>(file);
+}
+
+void ApplySettings(cdGridMap& map, const cdQueryRecord& record) {
+    if (map.GetSearchMode() != record.SearchMode) {
+        map.SetSearchMode(record.SearchMode);
+    }
+    if (map.GetCostMode() != record.CostMode) {
+        map.SetCostMode(record.CostMode);
+    }
+    if (map.GetCornerRule() != record.CornerRule) {
+        map.SetCornerRule(record.CornerRule);
+    }
+    if (map.GetAgentSize() != record.AgentSize) {
+        map.SetAgentSize(record.AgentSize);
+    }
+    // Only on change, the weight rebuilds the cost table and the scale requantizes the threat layer.
+    if (map.GetThreatWeight() != record.ThreatWeight) {
+        map.SetThreatWeight(record.ThreatWeight);
+    }
+    if (map.GetThreatScale() != record.ThreatScale) {
+        map.SetThreatScale(record.ThreatScale);
+    }
+    if (map.GetDiagonalStepLength() != record.DiagonalStepLength) {
+        map.SetDiagonalStepLength(record.DiagonalStepLength);
+    }
+    map.SetLineOfSightShortcut(record.LineOfSightShortcut);
+}
+
+void PrintSummary(FILE* out, const char* name, const LatencySummary& summary) {
+    fprintf(out, "%-10s %12.2f %12.2f %12.2f %12.2f\n", name, summary.MeanUs, summary.P50Us,
+        summary.P99Us, summary.MaxUs);
+}
+
+void WriteJson(FILE* out, const ReplayStats& stats, size_t numRecords, int repeat) {
+    auto recorded = Summarize(stats.RecordedUs);
+    auto replay = Summarize(stats.ReplayUs);
+    fprintf(out, "{\n  \"records\": %zu,\n  \"repeat\": %d,\n  \"skipped\": %zu,\n"
+        "  \"found_mismatches\": %zu,\n  \"expansion_mismatches\": %zu,\n  \"version_drift\": %zu,\n",
+        numRecords, repeat, stats.Skipped, stats.FoundMismatches, stats.ExpansionMismatches, stats.VersionDrift);
+    fprintf(out, "  \"recorded_us\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n",
+        recorded.MeanUs, recorded.P50Us, recorded.P99Us, recorded.MaxUs);
+    fprintf(out, "  \"replay_us\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}\n}\n",
+        replay.MeanUs, replay.P50Us, replay.P99Us, replay.MaxUs);
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (ParseOptions(argc, argv, options) == false) {
+        fprintf(stderr, "usage: %s --map ID=FILE[@VERSION] [--map ...] [--repeat N] [--json FILE|-] LOG\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<cdQueryRecord> records;
+    if (cdQueryRecorder::Load(options.LogPath.c_str(), records) == false) {
+        fprintf(stderr, "failed to load query log %s\n", options.LogPath.c_str());
+        return 1;
+    }
+
+    std::map<u32, std::unique_ptr<cdGridMap>> maps;
+    for (const auto& [id, path] : options.MapPaths) {
+        auto map = LoadSnapshot(path);
+        if (map == nullptr) {
+            fprintf(stderr, "failed to load map snapshot %s\n", path.c_str());
+            return 1;
+        }
+        map->SetMapId(id);
+        maps[id] = std::move(map);
+    }
+
+    ReplayStats stats;
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+
+    for (int pass = 0; pass < options.Repeat; ++pass) {
+        for (const auto& record : records) {
+            auto found = maps.find(record.MapId);
+            if (found == maps.end() || record.Goals.empty()) {
+                stats.Skipped += pass == 0 ? 1 : 0;
+                continue;
+            }
+
+            auto& map = *found->second;
+            ApplySettings(map, record);
+
+            resultPath.clear();
+            auto begin = std::chrono::steady_clock::now();
+            auto solved = aStar.FindPath(record.Start, record.Goals, &map, resultPath);
+            auto end = std::chrono::steady_clock::now();
+            stats.ReplayUs.push_back(std::chrono::duration<f64, std::micro>(end - begin).count());
+
+            if (pass > 0) {
+                continue;
+            }
+            stats.RecordedUs.push_back(record.LatencyUs);
+            stats.FoundMismatches += solved != record.Found ? 1 : 0;
+            stats.ExpansionMismatches += aStar.GetNumExpansions() != record.Expansions ? 1 : 0;
+
+            // The log can span several versions of a live map, a snapshot only matches one of them.
+            auto version = options.MapVersions.find(record.MapId);
+            if (version != options.MapVersions.end() && version->second != record.MapVersion) {
+                ++stats.VersionDrift;
+            }
+        }
+    }
+
+    printf("%zu records, %zu skipped, %zu found mismatches, %zu expansion mismatches, %zu on other versions than their snapshot\n",
+        records.size(), stats.Skipped, stats.FoundMismatches, stats.ExpansionMismatches, stats.VersionDrift);
+    printf("%-10s %12s %12s %12s %12s\n", "", "mean_us", "p50_us", "p99_us", "max_us");
+    PrintSummary(stdout, "recorded", Summarize(stats.RecordedUs));
+    PrintSummary(stdout, "replay", Summarize(stats.ReplayUs));
+
+    if (options.JsonPath.empty() == false) {
+        auto out = options.JsonPath == "-" ? stdout : fopen(options.JsonPath.c_str(), "w");
+        if (out == nullptr) {
+            fprintf(stderr, "failed to open %s\n", options.JsonPath.c_str());
+            return 1;
+        }
+        WriteJson(out, stats, records.size(), options.Repeat);
+        if (out != stdout) {
+            fclose(out);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+/*!
+ * \file scaling_bench.cpp
+ * Runs a fixed query mix against one shared cdGridMap from 1, 2, 4 ... N threads and reports
+ * queries/sec, scaling efficiency against the single thread run and tail latency.
+ *
+ * Each thread runs the whole mix from its own offset, so perfect scaling keeps the per thread
+ * rate flat. The search contexts are laid out three ways to expose contention:
+ *   packed - cdAStar objects adjacent in one array, their hot members share cache lines.
+ *   padded - each cdAStar on its own cache lines.
+ *   fresh  - a new cdAStar per query, every query goes through the allocator.
+ *
+ * scaling_bench [--threads N] [--queries N] [--map open|maze|rooms|random] [--size N]
+ *               [--mode jps|grid] [--layout packed|padded|fresh|all]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "cdAStar.hpp"
+#include "cdBenchMaps.hpp"
+#include "cdGridMap.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+constexpr size_t kCacheLineSize = 64;
+
+enum class ContextLayout : int {
+    PACKED,
+    PADDED,
+    FRESH
+};
+
+struct alignas(kCacheLineSize) PaddedContext {
+    cdAStar<cdGridCoord> AStar;
+};
+
+struct Query {
+    cdGridCoord Start;
+    cdGridCoord Goal;
+};
+
+struct Options {
+    int MaxThreads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+    size_t NumQueries = 2000;
+    int Size = 256;
+    cdBenchMapKind Kind = cdBenchMapKind::ROOMS;
+    cdSearchMode Mode = cdSearchMode::JUMP_POINT;
+    std::vector<ContextLayout> Layouts = { ContextLayout::PACKED, ContextLayout::PADDED, ContextLayout::FRESH };
+};
+
+struct RunResult {
+    f64 QueriesPerSec;
+    f64 P50Us, P99Us, P999Us, MaxUs;
+};
+
+const char* GetLayoutName(ContextLayout layout) {
+    switch (layout) {
+        case ContextLayout::PACKED: return "packed";
+        case ContextLayout::PADDED: return "padded";
+        default: return "fresh";
+    }
+}
+
+f64 Percentile(const std::vector<f64>& sorted, f64 fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    auto idx = static_cast<size_t>(fraction * static_cast<f64>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.MaxThreads = std::max(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            options.NumQueries = static_cast<size_t>(std::max(atoi(argv[++i]), 1));
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            options.Size = std::max(atoi(argv[++i]), 16);
+        } else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+            ++i;
+            bool found = false;
+            for (auto kind : { cdBenchMapKind::OPEN, cdBenchMapKind::MAZE, cdBenchMapKind::ROOMS, cdBenchMapKind::RANDOM }) {
+                if (strcmp(argv[i], GetBenchMapName(kind)) == 0) {
+                    options.Kind = kind;
+                    found = true;
+                }
+            }
+            if (found == false) {
+                return false;
+            }
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "grid") == 0) {
+                options.Mode = cdSearchMode::GRID;
+            } else if (strcmp(argv[i], "jps") != 0) {
+                return false;
+            }
+        } else if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "all") == 0) {
+                continue;
+            }
+            bool found = false;
+            for (auto layout : { ContextLayout::PACKED, ContextLayout::PADDED, ContextLayout::FRESH }) {
+                if (strcmp(argv[i], GetLayoutName(layout)) == 0) {
+                    options.Layouts = { layout };
+                    found = true;
+                }
+            }
+            if (found == false) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs the mix on every thread and joins. Latencies are gathered per thread and merged afterwards
+// so the measurement itself does not share anything between the workers.
+RunResult RunQueries(cdGridMap& map, const std::vector<Query>& queries, int numThreads, ContextLayout layout) {
+    std::vector<cdAStar<cdGridCoord>> packed(layout == ContextLayout::PACKED ? numThreads : 0);
+    std::vector<PaddedContext> padded(layout == ContextLayout::PADDED ? numThreads : 0);
+    std::vector<std::vector<f64>> latencies(numThreads);
+    std::atomic<int> numReady(0);
+    std::atomic<bool> go(false);
+
+    auto worker = [&](int thread) {
+        std::vector<f64> threadLatencies;
+        threadLatencies.reserve(queries.size());
+        std::vector<cdGridCoord> resultPath;
+
+        numReady.fetch_add(1);
+        while (go.load(std::memory_order_acquire) == false) {
+            std::this_thread::yield();
+        }
+
+        auto offset = queries.size() * static_cast<size_t>(thread) / static_cast<size_t>(numThreads);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto& query = queries[(offset + i) % queries.size()];
+            resultPath.clear();
+
+            auto begin = std::chrono::steady_clock::now();
+            if (layout == ContextLayout::FRESH) {
+                auto aStar = std::make_unique<cdAStar<cdGridCoord>>();
+                aStar->FindPath(query.Start, query.Goal, &map, resultPath);
+            } else {
+                auto& aStar = layout == ContextLayout::PACKED ? packed[thread] : padded[thread].AStar;
+                aStar.FindPath(query.Start, query.Goal, &map, resultPath);
+            }
+            auto end = std::chrono::steady_clock::now();
+            threadLatencies.push_back(std::chrono::duration<f64, std::micro>(end - begin).count());
+        }
+
+        latencies[thread] = std::move(threadLatencies);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    while (numReady.load() < numThreads) {
+        std::this_thread::yield();
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    std::vector<f64> merged;
+    for (const auto& threadLatencies : latencies) {
+        merged.insert(merged.end(), threadLatencies.begin(), threadLatencies.end());
+    }
+    std::sort(merged.begin(), merged.end());
+
+    RunResult result;
+    auto seconds = std::chrono::duration<f64>(end - begin).count();
+    result.QueriesPerSec = static_cast<f64>(merged.size()) / std::max(seconds, 1e-9);
+    result.P50Us = Percentile(merged, 0.5);
+    result.P99Us = Percentile(merged, 0.99);
+    result.P999Us = Percentile(merged, 0.999);
+    result.MaxUs = merged.empty() ? 0.0 : merged.back();
+    return result;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (ParseOptions(argc, argv, options) == false) {
+        fprintf(stderr, "usage: %s [--threads N] [--queries N] [--map open|maze|rooms|random] [--size N] "
+            "[--mode jps|grid] [--layout packed|padded|fresh|all]\n", argv[0]);
+        return 1;
+    }
+
+    auto size = options.Size;
+    cdGridMap map(MakeBenchCells(options.Kind, size), size, size,
+        cdPoint2f(static_cast<f32>(size), static_cast<f32>(size)));
+    map.SetSearchMode(options.Mode);
+
+    auto endpoints = MakeBenchOpenCells(map, options.NumQueries * 2);
+    std::vector<Query> queries(options.NumQueries);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        queries[i] = { endpoints[i * 2], endpoints[i * 2 + 1] };
+    }
+
+    std::vector<int> threadCounts;
+    for (int count = 1; count < options.MaxThreads; count *= 2) {
+        threadCounts.push_back(count);
+    }
+    threadCounts.push_back(options.MaxThreads);
+
+    printf("map %s %dx%d, mode %s, %zu queries per thread\n", GetBenchMapName(options.Kind), size, size,
+        options.Mode == cdSearchMode::GRID ? "grid" : "jps", options.NumQueries);
+    printf("%-8s %8s %12s %10s %10s %10s %10s %10s\n", "layout", "threads", "qps", "efficiency",
+        "p50_us", "p99_us", "p999_us", "max_us");
+
+    for (auto layout : options.Layouts) {
+        // Warm the map layers and the allocator before the single thread baseline.
+        RunQueries(map, queries, 1, layout);
+
+        f64 baseline = 0;
+        for (auto numThreads : threadCounts) {
+            auto result = RunQueries(map, queries, numThreads, layout);
+            if (numThreads == 1) {
+                baseline = result.QueriesPerSec;
+            }
+            auto efficiency = result.QueriesPerSec / (baseline * static_cast<f64>(numThreads));
+            printf("%-8s %8d %12.0f %10.3f %10.2f %10.2f %10.2f %10.2f\n", GetLayoutName(layout), numThreads,
+                result.QueriesPerSec, efficiency, result.P50Us, result.P99Us, result.P999Us, result.MaxUs);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <benchmark/benchmark.h>
+#include <random>
+
+#include "cdAStar.hpp"
+#include "cdGridMap.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+constexpr int kMapSize = 64;
+
+// Random obstacles plus a few threat blobs so the weighted search has something to avoid.
+cdGridCellList MakeThreatCells() {
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> coord(0, kMapSize - 1);
+    std::uniform_real_distribution<f32> roll(0.0f, 1.0f);
+
+    cdGridCellList cells(kMapSize * kMapSize, cdGridCell());
+    for (auto& cell : cells) {
+        if (roll(rng) < 0.15f) {
+            cell.Type = cdGridCell::CellType::BLOCKED;
+        }
+    }
+
+    for (int blob = 0; blob < 8; ++blob) {
+        int cx = coord(rng);
+        int cy = coord(rng);
+        for (int y = std::max(0, cy - 6); y < std::min(kMapSize, cy + 7); ++y) {
+            for (int x = std::max(0, cx - 6); x < std::min(kMapSize, cx + 7); ++x) {
+                auto dist = std::max(abs(x - cx), abs(y - cy));
+                cells[y * kMapSize + x].Threat += 1.0f - dist / 7.0f;
+            }
+        }
+    }
+
+    cells[0].Type = cdGridCell::CellType::EMPTY;
+    cells[kMapSize * kMapSize - 1].Type = cdGridCell::CellType::EMPTY;
+    return cells;
+}
+
+void RunFindPath(benchmark::State& state, cdCostMode mode) {
+    auto cells = MakeThreatCells();
+    cdPoint2f dimension(kMapSize, kMapSize);
+    cdGridMap gridMap(cells, kMapSize, kMapSize, dimension);
+    gridMap.SetSearchMode(cdSearchMode::GRID);
+    gridMap.SetCostMode(mode);
+    gridMap.SetThreatScale(2.0f);
+    gridMap.SetThreatWeight(4.0f);
+
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    cdGridCoord start(0, 0);
+    cdGridCoord end(kMapSize - 1, kMapSize - 1);
+
+    for (auto _ : state) {
+        resultPath.clear();
+        benchmark::DoNotOptimize(aStar.FindPath(start, end, &gridMap, resultPath));
+    }
+    state.counters["path_cells"] = static_cast<double>(resultPath.size());
+}
+
+void RunMovementCost(benchmark::State& state, cdCostMode mode) {
+    auto cells = MakeThreatCells();
+    cdPoint2f dimension(kMapSize, kMapSize);
+    cdGridMap gridMap(cells, kMapSize, kMapSize, dimension);
+    gridMap.SetCostMode(mode);
+
+    for (auto _ : state) {
+        f32 total = 0;
+        for (int y = 0; y < kMapSize - 1; ++y) {
+            for (int x = 0; x < kMapSize - 1; ++x) {
+                total += gridMap.GetMovementCost(cdGridCoord(x, y), cdGridCoord(x + 1, y + 1));
+            }
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * (kMapSize - 1) * (kMapSize - 1));
+}
+}
+
+static void BM_FindPathDistance(benchmark::State& state) {
+    RunFindPath(state, cdCostMode::DISTANCE);
+}
+BENCHMARK(BM_FindPathDistance);
+
+static void BM_FindPathThreatWeighted(benchmark::State& state) {
+    RunFindPath(state, cdCostMode::THREAT_WEIGHTED);
+}
+BENCHMARK(BM_FindPathThreatWeighted);
+
+static void BM_MovementCostDistance(benchmark::State& state) {
+    RunMovementCost(state, cdCostMode::DISTANCE);
+}
+BENCHMARK(BM_MovementCostDistance);
+
+static void BM_MovementCostThreatWeighted(benchmark::State& state) {
+    RunMovementCost(state, cdCostMode::THREAT_WEIGHTED);
+}
+BENCHMARK(BM_MovementCostThreatWeighted);
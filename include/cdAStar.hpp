@@ -5,11 +5,14 @@
 #ifndef _CDASTAR_HPP_
 #define _CDASTAR_HPP_
 
+#include <chrono>
 #include <vector>
 #include <functional>
 #include <queue>
+#include <unordered_map>
 
 #include "cdTypes.h"
+#include "FastDelegate.h"
 
 namespace ceed::ai::path {
 	template <typename NODE> class cdAStarMap;
@@ -64,6 +67,13 @@ namespace ceed::ai::path {
 
 			using cdMovePath = std::vector<CELL>;
 			using GREATER = std::greater<cdNode<CELL>>;
+			// Called after every FindPath with the search, start, goals, map, result and latency in us.
+			using QueryFunc = fastdelegate::FastDelegate6<const cdAStar*,
+				const CELL&,
+				const std::vector<CELL>&,
+				const cdAStarMap<CELL>*,
+				bool,
+				f64>;
 
 		private:
 
@@ -72,10 +82,22 @@ namespace ceed::ai::path {
 			std::vector<cdNode<CELL>> m_ClosedList; // Nodes that are visited.
 
 			std::vector<CELL> m_EndList;
+			std::vector<CELL> m_AdjacentList;
+
+			// Closed list positions by cdAStarMap::NodeKey, kept by any-angle searches when the map
+			// has the keys.
+			std::unordered_map<u64, s32> m_ClosedIndex;
+			bool m_IndexClosed;
+
+			// Nodes taken off the open list by the last FindPath.
+			size_t m_NumExpansions;
 
 			// STL thingie that compares stuff.
 			GREATER m_Compare;
 
+			// Unset unless something wants to observe the queries, FindPath skips the timing then.
+			QueryFunc m_QueryHook;
+
 		private:
 
 			bool IsInOpenList(const cdNode<CELL>& node) const {
@@ -87,18 +109,59 @@ namespace ceed::ai::path {
 				return i == m_OpenList.end() ? false : true;
 			}
 
-			bool IsInClosedList(const cdNode<CELL>& node) const {
-				// Find the node first.
+			bool IsInClosedList(const cdNode<CELL>& node, cdAStarMap<CELL>* pMap) const {
+				return FindInClosedList(node.NodePos, pMap) != -1;
+			}
+
+			// Position of the cell in the closed list, -1 when it is not there.
+			s32 FindInClosedList(const CELL& cell, cdAStarMap<CELL>* pMap) const {
+				if (m_IndexClosed) {
+					auto found = m_ClosedIndex.find(pMap->NodeKey(cell));
+					return found == m_ClosedIndex.end() ? -1 : found->second;
+				}
+
 				typename std::vector<cdNode<CELL>>::const_iterator i =
-					find(m_ClosedList.begin(), m_ClosedList.end(), node);
+					find(m_ClosedList.begin(), m_ClosedList.end(), cdNode<CELL>(cell, 0, 0));
+				return i == m_ClosedList.end() ? -1 : static_cast<s32>(i - m_ClosedList.begin());
+			}
 
-				// If in the list return true or else return false.
-				return i == m_ClosedList.end() ? false : true;
+			void AddToClosedList(const cdNode<CELL>& node, cdAStarMap<CELL>* pMap) {
+				if (m_IndexClosed) {
+					m_ClosedIndex.emplace(pMap->NodeKey(node.NodePos), static_cast<s32>(m_ClosedList.size()));
+				}
+				m_ClosedList.push_back(node);
+			}
+
+			// Lazy Theta*: the node cannot see the parent it was opened with, so it goes back to the
+			// expanded neighbour that reaches it cheapest. The one it was opened from is always there.
+			void SetNeighbourParent(cdNode<CELL>& node,
+				const CELL& start,
+				const std::vector<CELL>& endPts,
+				cdAStarMap<CELL>* pMap) {
+				m_AdjacentList.clear();
+				pMap->GetSucessors(this, node, start, endPts, m_AdjacentList);
+
+				for (typename std::vector<CELL>::iterator i = m_AdjacentList.begin();
+					i != m_AdjacentList.end(); ++i) {
+					const s32 neighbourIdx = FindInClosedList(*i, pMap);
+					if (neighbourIdx == -1) {
+						continue;
+					}
+
+					const cdNode<CELL>& neighbour = m_ClosedList[neighbourIdx];
+					f32 gValue = neighbour.GValue + pMap->MovementCost(neighbour.NodePos, node.NodePos);
+					if (node.ParentIdx == -1 || gValue < node.GValue) {
+						node.ParentIdx = neighbourIdx;
+						node.GValue = gValue;
+					}
+				}
 			}
 
 		public:
 
-			cdAStar() {
+			cdAStar()
+			: m_IndexClosed(false)
+			, m_NumExpansions(0) {
 				m_OpenList.reserve(ListSize);
 				m_ClosedList.reserve(ListSize);
 			}
@@ -112,17 +175,69 @@ namespace ceed::ai::path {
 				return false;
 			}
 
+			inline size_t GetNumExpansions() const {
+				return m_NumExpansions;
+			}
+
+			inline void SetQueryHook(QueryFunc hook) {
+				m_QueryHook = hook;
+			}
+
+			inline QueryFunc GetQueryHook() const {
+				return m_QueryHook;
+			}
+
 			bool FindPath(const CELL &start,
 				const std::vector<CELL>& endPts,
 				cdAStarMap<CELL>* pMap,
 				cdMovePath& resultPath) {
+				if (!m_QueryHook) {
+					return Search(start, endPts, pMap, resultPath);
+				}
+
+				auto begin = std::chrono::steady_clock::now();
+				auto found = Search(start, endPts, pMap, resultPath);
+				auto end = std::chrono::steady_clock::now();
+				m_QueryHook(this, start, endPts, pMap, found,
+					std::chrono::duration<f64, std::micro>(end - begin).count());
+				return found;
+			}
+
+			bool FindPath(const CELL& start,
+				const CELL& end,
+				cdAStarMap<CELL>* pMap,
+				cdMovePath& resultPath) {
+				m_EndList.clear();
+				m_EndList.push_back(end);
+
+				return FindPath(start, m_EndList, pMap, resultPath);
+			}
+
+		private:
+
+			bool Search(const CELL &start,
+				const std::vector<CELL>& endPts,
+				cdAStarMap<CELL>* pMap,
+				cdMovePath& resultPath) {
 
-				static std::vector<CELL> adjcentList;
+				auto& adjcentList = m_AdjacentList;
 				m_ClosedList.clear();
 				m_OpenList.clear();
+				m_NumExpansions = 0;
+				m_ClosedIndex.clear();
+				m_IndexClosed = pMap->AnyAngleLineOfSight && pMap->NodeKey;
 
 				auto compare = m_Compare;
 
+				// A clear straight line to a single goal is the answer already.
+				if (pMap->LineOfSight && endPts.size() == 1 && pMap->LineOfSight(start, endPts[0])) {
+					resultPath.push_back(endPts[0]);
+					if (!(start == endPts[0])) {
+						resultPath.push_back(start);
+					}
+					return true;
+				}
+
 				// Parent looking for his/her children...
 				m_OpenList.push_back(cdNode<CELL>(start, 0, 0));
 				push_heap(m_OpenList.begin(), m_OpenList.end(), compare);
@@ -135,6 +250,13 @@ namespace ceed::ai::path {
 					// Binary heap is good for A* so do the binary heap thing.
 					pop_heap(m_OpenList.begin(), m_OpenList.end(), compare);
 					m_OpenList.pop_back();
+					++m_NumExpansions;
+
+					if (pMap->AnyAngleLineOfSight && current.ParentIdx != -1 &&
+						!pMap->AnyAngleLineOfSight(m_ClosedList[current.ParentIdx].NodePos, current.NodePos)) {
+						current.ParentIdx = -1;
+						SetNeighbourParent(current, start, endPts, pMap);
+					}
 
 					// For each destination points check if the path is found...
 					for (typename std::vector<CELL>::const_iterator end = endPts.begin();
@@ -142,7 +264,7 @@ namespace ceed::ai::path {
 						// Path is found.
 						if (current == cdNode<CELL>((*end), 0, 0)) {
 							// Finally parent met his/her child.
-							m_ClosedList.push_back(current);
+							AddToClosedList(current, pMap);
 
 							// But children doesn't know where his/her parents are coming from...
 							// So here you do the search.
@@ -160,7 +282,7 @@ namespace ceed::ai::path {
 					}
 
 					// Move current node to the closed list.
-					m_ClosedList.push_back(current);
+					AddToClosedList(current, pMap);
 
 					// You want to get lists of adjcent nodes that are around the current guy.
 					adjcentList.clear();
@@ -170,7 +292,7 @@ namespace ceed::ai::path {
 							i != adjcentList.end(); ++i) {
 							// If there is no barrier in the position and if the node is not in the closed list.
 							// do the following.
-							if (!pMap->Collides(*i) && !IsInClosedList(cdNode<CELL>(*i, 0, 0))) {
+							if (!pMap->Collides(*i) && !IsInClosedList(cdNode<CELL>(*i, 0, 0), pMap)) {
 								// Makde new node. (one of the adjacent node)
 								cdNode<CELL> newNode;
 								newNode.NodePos = (*i); // Assign a position
@@ -180,6 +302,15 @@ namespace ceed::ai::path {
 								newNode.GValue =
 									current.GValue +
 									pMap->MovementCost(current.NodePos, newNode.NodePos);
+
+								// Any-angle searches skip straight to the current node's parent,
+								// checked for line of sight once the new node is expanded.
+								if (pMap->AnyAngleLineOfSight && current.ParentIdx != -1) {
+									const cdNode<CELL>& parent = m_ClosedList[current.ParentIdx];
+									newNode.ParentIdx = current.ParentIdx;
+									newNode.GValue = parent.GValue + pMap->MovementCost(parent.NodePos, newNode.NodePos);
+								}
+
 								// Calculate heruristics.
 								newNode.HValue = pMap->Heuristics(newNode.NodePos, start, endPts);
 
@@ -193,15 +324,11 @@ namespace ceed::ai::path {
 									push_heap(m_OpenList.begin(), m_OpenList.end(), compare);
 								} else {
 									// So if this path is better.
-									if (current.GValue +
-										m_ClosedList[current.ParentIdx].GValue <
-										newNodePos->GValue) {
+									if (newNode.GValue < newNodePos->GValue) {
 										// Then change the parent of the node to the current node and recalculate the
 										// G and F scores of the square.
-										newNodePos->ParentIdx = (int)m_ClosedList.size() - 1;
-										newNodePos->GValue = current.GValue +
-											pMap->MovementCost(current.NodePos,
-											newNodePos->NodePos);
+										newNodePos->ParentIdx = newNode.ParentIdx;
+										newNodePos->GValue = newNode.GValue;
 
 										// Finally do the binary heap thing to make thing sorted.
 										push_heap(m_OpenList.begin(), newNodePos + 1, compare);
@@ -214,16 +341,6 @@ namespace ceed::ai::path {
 
 				return false;
 			}
-
-			bool FindPath(const CELL& start,
-				const CELL& end,
-				cdAStarMap<CELL>* pMap,
-				cdMovePath& resultPath) {
-				m_EndList.clear();
-				m_EndList.push_back(end);
-
-				return FindPath(start, m_EndList, pMap, resultPath);
-			}
 	};
 }
 
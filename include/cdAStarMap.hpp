@@ -28,6 +28,13 @@ class cdAStarMap {
 		using MovementCostFunc = fastdelegate::FastDelegate2< const NODE&,
 			const NODE&,
 			f32 >;
+		// True when the straight line between the two is clear.
+		using LineOfSightFunc = fastdelegate::FastDelegate2< const NODE&,
+			const NODE&,
+			bool >;
+		// A number no other node shares.
+		using NodeKeyFunc = fastdelegate::FastDelegate1< const NODE&,
+			u64 >;
 
 	protected:
 		int m_TieType;
@@ -35,6 +42,15 @@ class cdAStarMap {
 		SucessorFunc GetSucessors;
 		HeuristicsFunc Heuristics;
 		MovementCostFunc MovementCost;
+		// Unset unless the map can answer straight line queries without a search, the line has to
+		// be as short as any path too.
+		LineOfSightFunc LineOfSight;
+		// Set for any-angle searches (Lazy Theta*). A node opened from another takes that one's
+		// parent instead, and the line between them is only checked once it is expanded.
+		LineOfSightFunc AnyAngleLineOfSight;
+		// Unset unless the map can number its nodes. Any-angle searches look the expanded nodes up
+		// by it, they go back to the expanded neighbours of every node without line of sight.
+		NodeKeyFunc NodeKey;
 
 	public:
 
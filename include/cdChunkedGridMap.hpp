@@ -0,0 +1,175 @@
+/*!
+ * \file cdChunkedGridMap.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDCHUNKEDGRIDMAP_HPP_
+#define _CDCHUNKEDGRIDMAP_HPP_
+
+#include <array>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "cdAStarMap.hpp"
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+	class cdMapFile;
+
+	// One resident square of the world.
+	struct cdMapChunk {
+		s32 ChunkIdx;
+		std::list<s32>::iterator LruPos; // Its entry in cdChunkedGridMap::m_Lru.
+		std::vector<u64> Occupancy; // Chunk rows, each a whole number of words, set when blocked.
+		std::vector<u8> Threat;     // Quantized, as in the file.
+	};
+
+	// Read only grid map for worlds too big to hold in memory. Fixed size chunks are copied out of
+	// a cdMapFile the first time a search touches them and the least recently used ones are
+	// dropped to stay within a memory budget, so a search can cross any number of chunks while
+	// only the ones near its frontier stay resident. Searches use plain 8-connected successors.
+	//
+	// Paging mutates the map, so only one search may run on it at a time.
+	class cdChunkedGridMap : public cdAStarMap<cdGridCoord> {
+		public:
+			static constexpr int k_DefaultChunkSize = 64;
+			static constexpr size_t k_DefaultMemoryBudget = 64 * 1024 * 1024;
+			// Never fewer than this many chunks resident, whatever the budget.
+			static constexpr size_t k_MinResidentChunks = 4;
+
+		private:
+			std::shared_ptr<const cdMapFile> m_File;
+			const u64* m_FileOccupancy;
+			const u8* m_FileThreat;
+			int m_FileStride;
+
+			int m_NumCols;
+			int m_NumRows;
+
+			// Chunks are square, a power of two and a whole number of occupancy words wide.
+			int m_ChunkSize;
+			int m_ChunkShift;
+			int m_ChunkWords;
+			int m_NumChunksX;
+			int m_NumChunksY;
+
+			size_t m_MemoryBudget;
+			size_t m_MaxResidentChunks;
+
+			// Per chunk in the world, its slot in m_Chunks or -1 when not resident.
+			std::vector<s32> m_ChunkSlots;
+			std::vector<cdMapChunk> m_Chunks;
+			// Slots in m_Chunks, most recently used first.
+			std::list<s32> m_Lru;
+
+			// Neighbouring lookups mostly hit the same chunk, skip the slot table for those.
+			s32 m_LastChunkIdx;
+			s32 m_LastSlot;
+
+			size_t m_NumLoads;
+			size_t m_NumEvictions;
+
+			cdCornerRule m_CornerRule;
+			cdCostMode m_CostMode;
+			f32 m_ThreatWeight;
+			std::array<f32, 256> m_ThreatCostTable;
+
+		private:
+
+			const cdMapChunk& GetChunk(int chunkX, int chunkY);
+			s32 LoadChunk(s32 chunkIdx);
+			void EvictChunk(s32 slot);
+			void BuildThreatCostTable();
+
+			inline size_t GetChunkBytes() const {
+				return sizeof(cdMapChunk) + static_cast<size_t>(m_ChunkSize) * m_ChunkWords * sizeof(u64) +
+					static_cast<size_t>(m_ChunkSize) * m_ChunkSize;
+			}
+
+		public:
+
+			// The chunk size is rounded up to a power of two of at least 64. A missing or closed file
+			// asserts and leaves the map empty, with no rows or columns.
+			explicit cdChunkedGridMap(std::shared_ptr<const cdMapFile> file,
+				int chunkSize = k_DefaultChunkSize,
+				size_t memoryBudget = k_DefaultMemoryBudget);
+
+			cdChunkedGridMap(const cdChunkedGridMap&) = delete;
+			cdChunkedGridMap& operator = (const cdChunkedGridMap&) = delete;
+
+			bool CellCollides(const cdGridCoord& cell);
+			bool IsBlocked(int x, int y);
+			u8 GetQuantizedThreat(const cdGridCoord& cell);
+
+			f32 GetHeuristics(const cdGridCoord&,
+				const cdGridCoord&,
+				const std::vector<cdGridCoord>&);
+			f32 GetMovementCost(const cdGridCoord&,
+				const cdGridCoord&);
+
+			bool GetGridSucessorList(const cdAStar<cdGridCoord>* astar,
+				const cdNode<cdGridCoord>& current,
+				const cdGridCoord& start,
+				const std::vector<cdGridCoord>& end,
+				std::vector<cdGridCoord>& adjcentList);
+
+			// Evicts down to the new budget straight away.
+			void SetMemoryBudget(size_t bytes);
+			inline size_t GetMemoryBudget() const {
+				return m_MemoryBudget;
+			}
+
+			inline size_t GetResidentBytes() const {
+				return m_Chunks.size() * GetChunkBytes();
+			}
+
+			inline size_t GetNumResidentChunks() const {
+				return m_Chunks.size();
+			}
+
+			inline size_t GetMaxResidentChunks() const {
+				return m_MaxResidentChunks;
+			}
+
+			inline size_t GetNumChunkLoads() const {
+				return m_NumLoads;
+			}
+
+			inline size_t GetNumChunkEvictions() const {
+				return m_NumEvictions;
+			}
+
+			inline void SetCornerRule(cdCornerRule rule) {
+				m_CornerRule = rule;
+			}
+			inline cdCornerRule GetCornerRule() const {
+				return m_CornerRule;
+			}
+
+			inline void SetCostMode(cdCostMode mode) {
+				m_CostMode = mode;
+			}
+			inline cdCostMode GetCostMode() const {
+				return m_CostMode;
+			}
+
+			void SetThreatWeight(f32 weight);
+			inline f32 GetThreatWeight() const {
+				return m_ThreatWeight;
+			}
+
+			inline int GetNumCols() const {
+				return m_NumCols;
+			}
+
+			inline int GetNumRows() const {
+				return m_NumRows;
+			}
+
+			inline int GetChunkSize() const {
+				return m_ChunkSize;
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,228 @@
+/*!
+ * \file cdConflictBasedSearch.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDCONFLICTBASEDSEARCH_HPP_
+#define _CDCONFLICTBASEDSEARCH_HPP_
+
+#include <memory>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include "cdAStar.hpp"
+#include "cdAStarMap.hpp"
+#include "cdFlowField.hpp"
+
+namespace ceed::ai::path {
+	struct cdSpaceTimeCoord {
+		int X, Y;
+		s32 Time;
+
+		inline cdSpaceTimeCoord(int x = 0, int y = 0, s32 time = 0) : X(x), Y(y), Time(time) { }
+
+		inline bool operator == (const cdSpaceTimeCoord& coord) const {
+			return X == coord.X && Y == coord.Y && Time == coord.Time;
+		}
+	};
+
+	// Keeps an agent off a cell at a tick, or off the step From -> Cell that lands at the tick.
+	struct cdCbsConstraint {
+		s32 Agent;
+		cdGridCoord Cell;
+		cdGridCoord From;
+		s32 Time;
+		bool IsEdge;
+	};
+
+	// The (cell, tick) map one agent is planned on by cdAStar, keeping out of its constraints. Past
+	// the last constrained tick every tick is alike, so time stops there and the space stays finite.
+	// The search ends on a node of its own that the goal leads to once no constraint can put the
+	// agent off it again. Steps and costs follow cdFlowField, waiting costs a straight step.
+	class cdConstrainedGridMap : public cdAStarMap<cdSpaceTimeCoord> {
+		public:
+			static constexpr s32 k_Arrived = -1;
+
+		private:
+			// The step along k_GridDirections[Dir] onto the cell that lands at the tick.
+			struct cdEdgeKey {
+				s32 Time;
+				u32 Cell;
+				u32 Dir;
+
+				inline bool operator == (const cdEdgeKey& key) const {
+					return Time == key.Time && Cell == key.Cell && Dir == key.Dir;
+				}
+			};
+
+			// Only spreads the keys, equal hashes are told apart by operator ==.
+			struct cdEdgeKeyHash {
+				inline size_t operator () (const cdEdgeKey& key) const {
+					return std::hash<u64>()((((static_cast<u64>(static_cast<u32>(key.Time)) << 32) | key.Cell) << 3) ^ key.Dir);
+				}
+			};
+
+			const cdGridMap& m_Map;
+			const cdFlowField* m_Field;
+			cdGridCoord m_Goal;
+			std::unordered_set<u64> m_Vertices; // Tick in the high half, cell in the low.
+			std::unordered_set<cdEdgeKey, cdEdgeKeyHash> m_Edges;
+			s32 m_LastGoalTime;
+			s32 m_TimeCap;
+
+		private:
+
+			inline u32 GetCellIndex(const cdGridCoord& cell) const {
+				return static_cast<u32>(cell.Y) * static_cast<u32>(m_Map.GetNumCols()) + static_cast<u32>(cell.X);
+			}
+
+			inline u64 GetKey(const cdGridCoord& cell, s32 time) const {
+				return (static_cast<u64>(time) << 32) | GetCellIndex(cell);
+			}
+
+		public:
+
+			explicit cdConstrainedGridMap(const cdGridMap& map);
+
+			// Takes the constraints of the agent out of the list. The field holds the distances to
+			// the goal and is the heuristic.
+			void SetConstraints(s32 agent, const cdGridCoord& goal, const cdFlowField& field,
+				const std::vector<cdCbsConstraint>& constraints);
+
+			inline cdSpaceTimeCoord GetArrivedNode(void) const {
+				return cdSpaceTimeCoord(m_Goal.X, m_Goal.Y, k_Arrived);
+			}
+
+			bool SpaceTimeCollides(const cdSpaceTimeCoord& node);
+			bool GetSpaceTimeSucessorList(const cdAStar<cdSpaceTimeCoord>* astar,
+				const cdNode<cdSpaceTimeCoord>& current,
+				const cdSpaceTimeCoord& start,
+				const std::vector<cdSpaceTimeCoord>& end,
+				std::vector<cdSpaceTimeCoord>& adjcentList);
+			f32 GetSpaceTimeHeuristics(const cdSpaceTimeCoord& node,
+				const cdSpaceTimeCoord&,
+				const std::vector<cdSpaceTimeCoord>&);
+			f32 GetSpaceTimeMovementCost(const cdSpaceTimeCoord& from,
+				const cdSpaceTimeCoord& to);
+	};
+
+	// Conflict-Based Search (CBS) for paths of many agents that never share a cell or swap places,
+	// with the least summed cost. The constraint tree splits on the first conflict of the cheapest
+	// node, and each child replans one agent with cdAStar on a cdConstrainedGridMap. With more than
+	// one thread the cheapest nodes are split a batch at a time, their replans spread over the
+	// threads.
+	//
+	// Once the budget is spent the tree is searched the ECBS way instead: any node within the
+	// suboptimality factor of the cheapest open node may be split, the one with the fewest
+	// conflicting pairs first, and the first one without conflicts is the answer. Its cost is then
+	// within that factor of the best, and IsOptimal tells which of the two it is. The low level
+	// stays optimal, so this is ECBS with a focal list on the high level only.
+	class cdConflictBasedSearch {
+		public:
+			static constexpr size_t k_DefaultMaxNodes = 100000;
+
+		private:
+			struct cdCbsPath {
+				std::vector<cdGridCoord> Cells; // A cell per tick, the agent stays on the last.
+				f32 Cost;
+			};
+
+			struct cdCbsNode {
+				s32 Parent;
+				cdCbsConstraint Constraint;
+				std::vector<std::shared_ptr<const cdCbsPath>> Paths;
+				f32 Cost;
+				s32 NumConflicts;
+			};
+
+			struct cdCbsWorker {
+				cdAStar<cdSpaceTimeCoord> AStar;
+				cdConstrainedGridMap Map;
+				std::vector<cdSpaceTimeCoord> Path;
+				std::vector<cdCbsConstraint> Constraints;
+
+				inline explicit cdCbsWorker(const cdGridMap& map) : Map(map) { }
+			};
+
+			// One agent replanned for a child node.
+			struct cdCbsJob {
+				s32 Node;
+				s32 Agent;
+				bool Found;
+			};
+
+			const cdGridMap& m_Map;
+			std::vector<std::unique_ptr<cdCbsWorker>> m_Workers;
+			size_t m_MaxNodes;
+
+			std::vector<cdGridCoord> m_Starts;
+			std::vector<cdGridCoord> m_Goals;
+			std::vector<std::unique_ptr<cdFlowField>> m_Fields;
+
+			std::vector<std::unique_ptr<cdCbsNode>> m_Nodes;
+			std::set<std::pair<f32, s32>> m_Open;
+			s32 m_Solution;
+			bool m_Optimal;
+			size_t m_NumLowLevelSearches;
+
+		private:
+
+			bool PlanAgent(cdCbsWorker& worker, s32 nodeIdx, s32 agent, std::shared_ptr<const cdCbsPath>& path);
+			void RunJobs(std::vector<cdCbsJob>& jobs);
+
+			inline const cdGridCoord& GetCell(const cdCbsPath& path, size_t time) const {
+				return time < path.Cells.size() ? path.Cells[time] : path.Cells.back();
+			}
+
+			// First conflict in time between two agents, false when there is none.
+			bool FindConflict(const cdCbsNode& node, cdCbsConstraint& first, cdCbsConstraint& second) const;
+			s32 CountConflicts(const cdCbsNode& node) const;
+
+		public:
+
+			explicit cdConflictBasedSearch(const cdGridMap& map, int numThreads = 1);
+
+			cdConflictBasedSearch(const cdConflictBasedSearch&) = delete;
+			cdConflictBasedSearch& operator = (const cdConflictBasedSearch&) = delete;
+
+			// Budget in microseconds before falling back on bounded suboptimal answers. False when
+			// some agent cannot reach its goal or the tree grows past the node limit.
+			bool Solve(const std::vector<cdGridCoord>& starts, const std::vector<cdGridCoord>& goals,
+				f64 budget, f32 suboptimality = 1.5f);
+
+			inline void SetMaxNodes(size_t maxNodes) {
+				m_MaxNodes = maxNodes;
+			}
+
+			// Start first, a cell per tick, the agent stays on the last one.
+			inline const std::vector<cdGridCoord>& GetPath(s32 agent) const {
+				return m_Nodes[m_Solution]->Paths[agent]->Cells;
+			}
+
+			inline f32 GetPathCost(s32 agent) const {
+				return m_Nodes[m_Solution]->Paths[agent]->Cost;
+			}
+
+			inline f32 GetCost(void) const {
+				return m_Nodes[m_Solution]->Cost;
+			}
+
+			inline bool IsOptimal(void) const {
+				return m_Optimal;
+			}
+
+			inline size_t GetNumNodes(void) const {
+				return m_Nodes.size();
+			}
+
+			inline size_t GetNumLowLevelSearches(void) const {
+				return m_NumLowLevelSearches;
+			}
+
+			inline int GetNumThreads(void) const {
+				return static_cast<int>(m_Workers.size());
+			}
+	};
+}
+
+#endif
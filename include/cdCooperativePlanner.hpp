@@ -0,0 +1,142 @@
+/*!
+ * \file cdCooperativePlanner.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDCOOPERATIVEPLANNER_HPP_
+#define _CDCOOPERATIVEPLANNER_HPP_
+
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "cdReservationTable.hpp"
+#include "cdReverseResumableSearch.hpp"
+
+namespace ceed::ai::path {
+	// Windowed Hierarchical Cooperative A* (WHCA*). Every agent plans the next window of ticks in
+	// (cell, tick) space around the cells other agents reserved, then reserves its own plan, so
+	// agents queue and pass each other instead of walking into one another. Past the window it
+	// falls back on the true distance to its goal, from a Reverse Resumable A* shared by every
+	// agent with that goal. Steps and costs follow cdFlowField, waiting costs a straight step
+	// unless the agent waits on its goal.
+	//
+	// Agents replan once half their window is used up. Update spends a time budget on them in turn,
+	// the ones it does not get to keep their plans, and an agent whose plan runs out stays parked
+	// on its last cell, which nobody else plans through. Agents on their goal stay there.
+	class cdCooperativePlanner {
+		public:
+			static constexpr int k_DefaultWindow = 16;
+
+		private:
+			struct cdAgent {
+				cdGridCoord Position;
+				cdGridCoord Goal;
+				std::vector<cdGridCoord> Plan; // Cell for every tick after the plan was made.
+				size_t PlanStep;
+				bool NeedsPlan;
+			};
+
+			struct cdSpaceTimeNode {
+				cdGridCoord Cell;
+				s32 Parent;
+				f32 GValue;
+				s32 Step;
+			};
+
+			using cdOpenEntry = std::pair<f32, s32>;
+			using cdOpenQueue = std::priority_queue<cdOpenEntry, std::vector<cdOpenEntry>, std::greater<cdOpenEntry>>;
+
+			const cdGridMap& m_Map;
+			u32 m_MapVersion;
+			int m_Window;
+			u32 m_Time;
+
+			cdReservationTable m_Reservations;
+			std::vector<cdAgent> m_Agents;
+			// One per goal cell, shared by the agents heading there.
+			std::unordered_map<s32, std::unique_ptr<cdReverseResumableSearch>> m_Heuristics;
+
+			size_t m_NextAgent;
+			size_t m_NumReplans;
+			size_t m_NumExpansions;
+
+			// Search scratch, kept to save the allocations.
+			std::vector<cdSpaceTimeNode> m_Nodes;
+			std::unordered_map<u64, f32> m_Visited;
+			cdOpenQueue m_Open;
+
+		private:
+
+			cdReverseResumableSearch& GetHeuristics(const cdAgent& agent);
+			void PlanAgent(s32 agentIdx);
+			void ReservePlan(s32 agentIdx);
+
+			inline bool NeedsPlan(const cdAgent& agent) const {
+				if (agent.NeedsPlan) {
+					return true;
+				}
+				const auto remaining = agent.Plan.size() - agent.PlanStep;
+				return agent.Position != agent.Goal && remaining < static_cast<size_t>(m_Window / 2);
+			}
+
+		public:
+
+			cdCooperativePlanner(const cdGridMap& map, int window = k_DefaultWindow);
+
+			cdCooperativePlanner(const cdCooperativePlanner&) = delete;
+			cdCooperativePlanner& operator = (const cdCooperativePlanner&) = delete;
+
+			// The agent parks on its cell straight away. -1 when the cell is blocked or held.
+			s32 AddAgent(const cdGridCoord& position, const cdGridCoord& goal);
+			void SetGoal(s32 agent, const cdGridCoord& goal);
+
+			// Replans agents in turn until the budget in microseconds is spent, at least one when
+			// any needs it. Returns how many were planned.
+			size_t Update(f64 budget);
+
+			// Moves every agent one tick along its plan.
+			void Step();
+
+			inline const cdGridCoord& GetPosition(s32 agent) const {
+				return m_Agents[agent].Position;
+			}
+
+			inline const cdGridCoord& GetGoal(s32 agent) const {
+				return m_Agents[agent].Goal;
+			}
+
+			// The cell the agent moves to on the next Step.
+			inline cdGridCoord GetNextCell(s32 agent) const {
+				const auto& state = m_Agents[agent];
+				return state.PlanStep < state.Plan.size() ? state.Plan[state.PlanStep] : state.Position;
+			}
+
+			inline size_t GetNumAgents(void) const {
+				return m_Agents.size();
+			}
+
+			inline u32 GetTime(void) const {
+				return m_Time;
+			}
+
+			inline int GetWindow(void) const {
+				return m_Window;
+			}
+
+			inline const cdReservationTable& GetReservations(void) const {
+				return m_Reservations;
+			}
+
+			inline size_t GetNumReplans(void) const {
+				return m_NumReplans;
+			}
+
+			// Space-time nodes taken off the open list by every replan so far.
+			inline size_t GetNumExpansions(void) const {
+				return m_NumExpansions;
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*!
+ * \file cdFlowField.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDFLOWFIELD_HPP_
+#define _CDFLOWFIELD_HPP_
+
+#include <float.h>
+#include <vector>
+
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+	// Distance to the nearest of a set of goals and the first step towards it, for every cell of a
+	// cdGridMap. One reverse Dijkstra from the goals replaces a FindPath per agent, after which an
+	// agent reads its next move in constant time. Steps and costs follow GRID mode: the map's corner
+	// rule, agent size and cost mode, so threat counts when the map is THREAT_WEIGHTED.
+	//
+	// With more than one thread the field is split into k_TileSize tiles. A tile runs Dijkstra over
+	// its own cells seeded from the distances around its border, and tiles whose border improved
+	// wake their neighbours, until nothing changes. Tiles are coloured in a 2 x 2 pattern and one
+	// colour runs at a time, so a running tile only reads cells no other running tile writes. The
+	// result is the same as the single threaded one.
+	class cdFlowField {
+		public:
+			static constexpr int k_TileSize = 32;
+			static constexpr u8 k_NoDirection = 0xFF;
+			static constexpr f32 k_Unreachable = FLT_MAX;
+
+		private:
+			int m_NumCols;
+			int m_NumRows;
+			int m_NumTileCols;
+			int m_NumTileRows;
+
+			std::vector<f32> m_Distance;
+			std::vector<u8> m_Direction; // Index into k_GridDirections.
+
+			// Per cell, filled from the map at the start of Build.
+			std::vector<u8> m_Moves;      // cdGridMap::GetCellMoves, 0 when blocked.
+			std::vector<f32> m_EnterCost; // cdGridMap::GetEnterCost.
+			f32 m_DiagonalStepLength;     // cdGridMap::GetDiagonalStepLength.
+
+			// Tile bookkeeping for the threaded build.
+			std::vector<u8> m_TilePending;
+			std::vector<u8> m_TileSeeded;
+			std::vector<u8> m_TileChanged;
+			size_t m_NumTileRuns;
+
+		private:
+
+			void PrepareCells(const cdGridMap& map);
+			bool SeedGoals(const cdGridMap& map, const std::vector<cdGridCoord>& goals);
+			void BuildDirections(int firstRow, int lastRow);
+
+			// Dijkstra over the cells of [x0, x1) x [y0, y1) only. Returns whether a cell on the
+			// border of the region got closer.
+			bool RelaxRegion(int x0, int y0, int x1, int y1, bool seedAll, bool seedFromRing);
+			void RunTile(int tileIdx);
+			void RunTiles(int numThreads);
+
+			inline f32 GetStepCost(int dir, int toIdx) const {
+				return (dir < 4 ? GetGridStepLength(dir) : m_DiagonalStepLength) * m_EnterCost[toIdx];
+			}
+
+		public:
+
+			cdFlowField();
+
+			// Goals that are blocked or off the map are skipped, returns false when none is left.
+			bool Build(const cdGridMap& map, const std::vector<cdGridCoord>& goals, int numThreads = 1);
+
+			inline bool IsReachable(const cdGridCoord& cell) const {
+				return m_Distance[cell.Y * m_NumCols + cell.X] != k_Unreachable;
+			}
+
+			// Cost of the cheapest path to a goal, k_Unreachable when there is none.
+			inline f32 GetDistance(const cdGridCoord& cell) const {
+				return m_Distance[cell.Y * m_NumCols + cell.X];
+			}
+
+			// k_NoDirection on goals and cells that cannot reach one.
+			inline u8 GetDirection(const cdGridCoord& cell) const {
+				return m_Direction[cell.Y * m_NumCols + cell.X];
+			}
+
+			// The cell itself when there is nowhere to go.
+			inline cdGridCoord GetNextCell(const cdGridCoord& cell) const {
+				auto dir = GetDirection(cell);
+				if (dir == k_NoDirection) {
+					return cell;
+				}
+				return cdGridCoord(cell.X + k_GridDirections[dir].X, cell.Y + k_GridDirections[dir].Y);
+			}
+
+			inline int GetNumCols(void) const {
+				return m_NumCols;
+			}
+
+			inline int GetNumRows(void) const {
+				return m_NumRows;
+			}
+
+			// Tile Dijkstra runs in the last threaded Build, 0 after a single threaded one.
+			inline size_t GetNumTileRuns(void) const {
+				return m_NumTileRuns;
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,109 @@
+/*!
+ * \file cdGridLayer.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDGRIDLAYER_HPP_
+#define _CDGRIDLAYER_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "cdTypes.h"
+
+namespace ceed::ai::path {
+	// Per cell storage for cdGridMap. The data is either owned, or a read only view of memory that
+	// lives somewhere else (caller buffer, shared buffer, mapped file). Views are copied into owned
+	// storage the first time someone writes to them.
+	template <typename T>
+	class cdGridLayer {
+		private:
+			const T* m_Data;
+			size_t m_Size;
+
+			std::vector<T> m_Owned;
+			// Keeps shared storage alive for as long as the view is around.
+			std::shared_ptr<const void> m_Keeper;
+
+		public:
+
+			inline cdGridLayer()
+			: m_Data(nullptr)
+			, m_Size(0) {}
+
+			inline cdGridLayer(cdGridLayer&& layer) noexcept
+			: m_Data(layer.m_Data)
+			, m_Size(layer.m_Size)
+			, m_Owned(std::move(layer.m_Owned))
+			, m_Keeper(std::move(layer.m_Keeper)) {
+				layer.m_Data = nullptr;
+				layer.m_Size = 0;
+			}
+
+			cdGridLayer(const cdGridLayer&) = delete;
+			cdGridLayer& operator = (const cdGridLayer&) = delete;
+
+			inline cdGridLayer& operator = (cdGridLayer&& layer) noexcept {
+				m_Data = layer.m_Data;
+				m_Size = layer.m_Size;
+				m_Owned = std::move(layer.m_Owned);
+				m_Keeper = std::move(layer.m_Keeper);
+				layer.m_Data = nullptr;
+				layer.m_Size = 0;
+				return *this;
+			}
+
+			inline void Own(std::vector<T>&& data) {
+				m_Owned = std::move(data);
+				m_Keeper.reset();
+				m_Data = m_Owned.data();
+				m_Size = m_Owned.size();
+			}
+
+			inline void Assign(size_t size, const T& value) {
+				m_Owned.assign(size, value);
+				m_Keeper.reset();
+				m_Data = m_Owned.data();
+				m_Size = size;
+			}
+
+			inline void View(const T* data, size_t size, std::shared_ptr<const void> keeper = nullptr) {
+				m_Owned.clear();
+				m_Owned.shrink_to_fit();
+				m_Keeper = std::move(keeper);
+				m_Data = data;
+				m_Size = size;
+			}
+
+			inline bool IsView() const {
+				return m_Data != nullptr && m_Data != m_Owned.data();
+			}
+
+			inline const T* Data() const {
+				return m_Data;
+			}
+
+			inline size_t Size() const {
+				return m_Size;
+			}
+
+			inline bool Empty() const {
+				return m_Size == 0;
+			}
+
+			inline const T& operator [] (size_t idx) const {
+				return m_Data[idx];
+			}
+
+			// Detaches from a view before handing out writable memory.
+			inline T* MutableData() {
+				if (IsView()) {
+					m_Owned.assign(m_Data, m_Data + m_Size);
+					m_Keeper.reset();
+					m_Data = m_Owned.data();
+				}
+				return m_Owned.data();
+			}
+	};
+}
+
+#endif
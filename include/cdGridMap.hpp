@@ -5,7 +5,11 @@
 #ifndef _CDGRIDMAP_HPP_
 #define _CDGRIDMAP_HPP_
 
+#include <array>
+#include <memory>
+#include <span>
 #include <vector>
+#include "cdGridLayer.hpp"
 #include "cdJumpStartMap.hpp"
 
 namespace ceed::ai::path {
@@ -97,30 +101,431 @@ struct cdGridCell {
 
 using cdGridCellList = std::vector<cdGridCell>;
 
+// Which successor generator the map hands to cdAStar.
+enum class cdSearchMode : char {
+    JUMP_POINT, // cdJumpStartMap::GetSucessorList, each jump costs the octile length of its leg.
+    GRID,       // Plain 8-connected neighbours, works with any cost.
+    ANY_ANGLE   // Lazy Theta* over the 8-connected neighbours, straight legs between any cells in
+                // line of sight and straight line costs. Uniform cost only, the cost mode is kept
+                // for the other modes but threat is not charged.
+};
+
+// When a diagonal move may squeeze past blocked orthogonal neighbours. ANY_ANGLE always takes
+// NEVER, JUMP_POINT takes ALWAYS as it is and ONE_OPEN as NEVER.
+enum class cdCornerRule : char {
+    ALWAYS,     // Only the diagonal cell has to be open.
+    ONE_OPEN,   // At least one of the two orthogonal cells has to be open.
+    NEVER       // Both orthogonal cells have to be open.
+};
+
+// What GetMovementCost charges for a step.
+enum class cdCostMode : char {
+    DISTANCE,       // Plain step distance.
+    THREAT_WEIGHTED // Step distance scaled by the destination threat, use with cdSearchMode::GRID.
+};
+
+// How the per cell layers are laid out in memory.
+enum class cdCellLayout : char {
+    ROW_MAJOR,  // idx = Y * cols + X, the map file layout.
+    TILED       // 8 x 8 tiles, a tile is one cache line of a byte layer and one occupancy word.
+};
+
+// Moves allowed from a cell under a corner rule, from the mask of its open neighbours. Bits
+// follow k_GridDirections in both.
+u8 GetAllowedMoves(u8 openMask, cdCornerRule rule);
+
+// Octile distance to the nearest goal, for JUMP_POINT and GRID searches. Shared by every grid map
+// flavour so they all find the same paths. Never above the real cost, so tieType 0 adds no tie
+// breaking and the paths stay optimal; tieType 1 adds the cross product one.
+f32 GetOctileHeuristics(int tieType, const cdGridCoord& cell, const cdGridCoord& start,
+    const std::vector<cdGridCoord>& goals, f32 diagonalLength = GetGridStepLength(4));
+
+// Straight line distance to the nearest goal, for ANY_ANGLE searches. Tie breaking as in
+// GetOctileHeuristics, so tieType 0 keeps the paths as short as Lazy Theta* finds them.
+f32 GetAnyAngleHeuristics(int tieType, const cdGridCoord& cell, const cdGridCoord& start,
+    const std::vector<cdGridCoord>& goals);
+
+// Visits every cell the segment between the two cell centres touches, both cells at a corner it
+// passes exactly through, from first to last. Stops early and returns false once visit does.
+template <typename FUNC>
+bool WalkSupercover(const cdGridCoord& from, const cdGridCoord& to, FUNC&& visit) {
+    const int dx = abs(to.X - from.X);
+    const int dy = abs(to.Y - from.Y);
+    const int sx = to.X > from.X ? 1 : -1;
+    const int sy = to.Y > from.Y ? 1 : -1;
+
+    // Sign says which cell border the line crosses next, zero is both at once.
+    int error = dx - dy;
+    cdGridCoord cell = from;
+    if (visit(cell) == false) {
+        return false;
+    }
+    while (cell != to) {
+        if (error > 0) {
+            cell.X += sx;
+            error -= 2 * dy;
+        } else if (error < 0) {
+            cell.Y += sy;
+            error += 2 * dx;
+        } else {
+            if (visit(cdGridCoord(cell.X + sx, cell.Y)) == false || visit(cdGridCoord(cell.X, cell.Y + sy)) == false) {
+                return false;
+            }
+            cell.X += sx;
+            cell.Y += sy;
+            error += 2 * (dx - dy);
+        }
+        if (visit(cell) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class cdMapFile;
+
 class cdGridMap : public cdJumpStartMap {
+    friend class cdMapFile;
+
     private:
 
         int m_ArraySize;
 
+        // Caller assigned id and an edit counter, so logged queries can name the map they ran on.
+        u32 m_MapId;
+        u32 m_Version;
+
+        cdSearchMode m_SearchMode;
+        cdCornerRule m_CornerRule;
+        cdCostMode m_CostMode;
+
+        cdCellLayout m_Layout;
+        int m_TilesPerRow;
+
+        // An agent of size N covers the (2N - 1) x (2N - 1) square centred on its cell, so a cell is
+        // open for it when the clearance is at least N. Size 1 is a plain single cell agent.
+        int m_AgentSize;
+
+        // The settings the goal bounds were built or loaded under, they only prune searches that
+        // step the same way.
+        int m_GoalBoundsAgentSize;
+        cdCornerRule m_GoalBoundsCornerRule;
+        f32 m_GoalBoundsDiagonalStepLength;
+
+        // Lets FindPath return a clear straight line without searching, JUMP_POINT with DISTANCE or ANY_ANGLE.
+        bool m_LineOfSightShortcut;
+
+        // Length of a diagonal step, GetGridStepLength(4) unless set.
+        f32 m_DiagonalStepLength;
+
+        // Threat values at or above the scale quantize to 255.
+        f32 m_ThreatScale;
+        f32 m_ThreatWeight;
+        // Cost multiplier per quantized threat value, 1 + weight * threat.
+        std::array<f32, 256> m_ThreatCostTable;
+
         cdPoint2f m_TileSize;
         cdPoint2f m_TileHalfSize;
         cdPoint2f m_MapDimension;
         cdPoint2f m_MapHalfDimension;
 
-        cdGridCellList m_Cells;
+        // Owned, or a read only view of cells owned elsewhere that is copied on the first edit.
+        // Empty for maps loaded from a cdMapFile, those only have the derived layers.
+        cdGridLayer<cdGridCell> m_Cells;
+
+        // One bit per cell, set when blocked. Rows start on a word boundary, or a word per tile.
+        cdGridLayer<u64> m_Occupancy;
+        int m_OccupancyStride;
+        // Per cell, bit N is set when the neighbour in k_GridDirections[N] is open.
+        cdGridLayer<u8> m_NeighbourMasks;
+        // Same, open for m_AgentSize. Built from the clearance for agents bigger than a cell only.
+        cdGridLayer<u8> m_AgentMasks;
+        // cdGridCell::Threat quantized to a byte so cost lookups stay in cache.
+        cdGridLayer<u8> m_ThreatLayer;
+        // Chebyshev distance to the nearest blocked cell or the map edge, 0 on blocked cells.
+        cdGridLayer<u8> m_Clearance;
+
+        // Scratch for the incremental clearance update. The buckets are by clearance value and
+        // left empty after each update, keeping their capacity.
+        std::vector<u8> m_ClearanceMarks;
+        std::vector<int> m_ClearanceQueue;
+        std::array<std::vector<int>, 256> m_ClearanceBuckets;
+
+        // Edit counter per square chunk of cells, row major.
+        std::vector<u32> m_ChunkVersions;
+        int m_NumChunkCols;
+
+    private:
+
+        // Settings and chunk versions only, the file constructor hands the layers over after it.
+        cdGridMap(int cols, int rows, const cdPoint2f& dimension);
+        cdGridMap(cdGridLayer<cdGridCell>&& cells, int cols, int rows, const cdPoint2f& dimension);
+
+        void BuildOccupancy();
+        void BuildNeighbourMasks();
+        void BuildAgentMasks();
+        void BuildThreatLayer();
+        void BuildThreatCostTable();
+        void BuildClearance();
+
+        inline void UpdateGoalBoundsEnabled() {
+            m_GoalBoundsEnabled = m_AgentSize == m_GoalBoundsAgentSize &&
+                m_CornerRule == m_GoalBoundsCornerRule && m_DiagonalStepLength == m_GoalBoundsDiagonalStepLength;
+        }
+
+        // Every layer below is addressed through these, whatever the layout.
+        inline int GetLayerIndex(int x, int y, cdCellLayout layout) const {
+            if (layout == cdCellLayout::ROW_MAJOR) {
+                return y * m_NumCols + x;
+            }
+            return (((y >> 3) * m_TilesPerRow + (x >> 3)) << 6) | ((y & 7) << 3) | (x & 7);
+        }
+        inline int GetLayerIndex(int x, int y) const {
+            return GetLayerIndex(x, y, m_Layout);
+        }
+
+        // Tiled layers are padded out to whole tiles.
+        inline size_t GetLayerSize(cdCellLayout layout) const {
+            return layout == cdCellLayout::ROW_MAJOR ? static_cast<size_t>(m_ArraySize) :
+                static_cast<size_t>(m_TilesPerRow) * ((m_NumRows + 7) >> 3) * 64;
+        }
+        inline size_t GetLayerSize(void) const {
+            return GetLayerSize(m_Layout);
+        }
+
+        inline size_t GetOccupancySize(cdCellLayout layout) const {
+            return layout == cdCellLayout::ROW_MAJOR ? static_cast<size_t>(m_OccupancyStride) * m_NumRows :
+                GetLayerSize(layout) / 64;
+        }
+
+        inline int GetOccupancyWord(int x, int y, cdCellLayout layout) const {
+            return layout == cdCellLayout::ROW_MAJOR ? y * m_OccupancyStride + (x >> 6) :
+                (y >> 3) * m_TilesPerRow + (x >> 3);
+        }
+        inline int GetOccupancyWord(int x, int y) const {
+            return GetOccupancyWord(x, y, m_Layout);
+        }
+
+        inline int GetOccupancyBit(int x, int y, cdCellLayout layout) const {
+            return layout == cdCellLayout::ROW_MAJOR ? (x & 63) : ((y & 7) << 3) | (x & 7);
+        }
+        inline int GetOccupancyBit(int x, int y) const {
+            return GetOccupancyBit(x, y, m_Layout);
+        }
+
+        bool CheckLineOfSightShortcut(const cdGridCoord& start, const cdGridCoord& goal);
+
+        inline bool IsOnMap(const cdGridCoord& cell) const {
+            return static_cast<unsigned>(cell.X) < static_cast<unsigned>(m_NumCols) &&
+                static_cast<unsigned>(cell.Y) < static_cast<unsigned>(m_NumRows);
+        }
+
+        // Off the map counts as blocked for rays.
+        inline bool IsRayBlocked(int x, int y) const {
+            return IsOnMap(cdGridCoord(x, y)) == false || IsBlocked(x, y);
+        }
+
+        size_t CastRayRange(std::span<const cdGridCoord> from, std::span<const cdGridCoord> to,
+            std::span<u8> hits, std::span<cdGridCoord> firstHits, size_t first, size_t last) const;
+
+        void MarkChunksEdited(int minX, int minY, int maxX, int maxY);
+        void UpdateNeighbourMasks(const cdGridCoord& cell, bool open);
+        // Agent mask bits pointing at the cells the last clearance update queued.
+        void UpdateAgentMasks();
+        void LowerClearance(const cdGridCoord& cell);
+        void RaiseClearance(const cdGridCoord& cell);
+
+        inline int GetBorderClearance(int x, int y) const {
+            return std::min(std::min(x + 1, m_NumCols - x), std::min(y + 1, m_NumRows - y));
+        }
+
+    public:
+
+        // Cells per side of the chunks edits are counted in, as a shift.
+        static constexpr int k_ChunkShift = 5;
 
     public:
 
+        // The cells are row major and have to fill the grid, cols * rows of them. Any other count
+        // asserts and leaves the map empty, with no rows or columns.
+
+        // Copies the cells.
         cdGridMap(cdGridCellList& cells, int cols, int rows, cdPoint2f& dimension);
+        // Takes the cells over without copying them.
+        cdGridMap(cdGridCellList&& cells, int cols, int rows, const cdPoint2f& dimension);
+        // Reads the caller's cells in place, they have to outlive the map.
+        cdGridMap(std::span<const cdGridCell> cells, int cols, int rows, const cdPoint2f& dimension);
+        // Shares one immutable cell buffer between any number of maps. nullptr is a list of no cells.
+        cdGridMap(std::shared_ptr<const cdGridCellList> cells, int cols, int rows, const cdPoint2f& dimension);
+        // Reads the layers straight out of an open map file, tables it lacks are rebuilt. A missing or
+        // closed file asserts and leaves the map empty, with no rows or columns.
+        explicit cdGridMap(std::shared_ptr<const cdMapFile> file);
+
+        cdGridMap(const cdGridMap&) = delete;
+        cdGridMap& operator = (const cdGridMap&) = delete;
 
         bool CellCollides(const cdGridCoord &) const;
 
+        // Edits one cell and incrementally updates the derived layers. Goal bounds are dropped
+        // since they only describe static maps.
+        void SetCell(const cdGridCoord& cell, const cdGridCell& value);
+        // Maps without cells rebuild the cell from the occupancy and the quantized threat.
+        cdGridCell GetCell(const cdGridCoord& cell) const;
+
+        inline const cdGridCell* GetCells(void) const {
+            return m_Cells.Data();
+        }
+
+        inline bool IsBlocked(int x, int y) const {
+            return ((m_Occupancy[GetOccupancyWord(x, y)] >> GetOccupancyBit(x, y)) & 1) != 0;
+        }
+
+        // Rebuilds goal bounds for the current agent size, other sizes search without them.
+        void BuildGoalBounds() override;
+
         f32 GetHeuristics(const cdGridCoord &,
             const cdGridCoord &,
             const std::vector<cdGridCoord> &);
         f32 GetMovementCost(const cdGridCoord &,
             const cdGridCoord &);
 
+        bool GetGridSucessorList(const cdAStar<cdGridCoord>* astar,
+            const cdNode<cdGridCoord>& current,
+            const cdGridCoord& start,
+            const std::vector<cdGridCoord>& end,
+            std::vector<cdGridCoord>& adjcentList);
+
+        // The steps a GRID search may take from an open cell under the current agent size and
+        // corner rule. Bits follow k_GridDirections.
+        u8 GetCellMoves(const cdGridCoord& cell) const;
+
+        void SetSearchMode(cdSearchMode mode);
+        inline cdSearchMode GetSearchMode(void) const {
+            return m_SearchMode;
+        }
+
+        inline void SetCornerRule(cdCornerRule rule) {
+            m_CornerRule = rule;
+            m_CutCorners = rule == cdCornerRule::ALWAYS;
+            UpdateGoalBoundsEnabled();
+            ++m_Version;
+        }
+        inline cdCornerRule GetCornerRule(void) const {
+            return m_CornerRule;
+        }
+
+        inline void SetCostMode(cdCostMode mode) {
+            m_CostMode = mode;
+            ++m_Version;
+        }
+        inline cdCostMode GetCostMode(void) const {
+            return m_CostMode;
+        }
+
+        // On by default. A straight line is as short as any path when every step costs its length,
+        // so the shortcut only applies to ANY_ANGLE, and to JUMP_POINT with DISTANCE when the line
+        // is straight or exactly diagonal, a single jump point leg. GRID paths list every cell and
+        // never take it.
+        inline void SetLineOfSightShortcut(bool enabled) {
+            m_LineOfSightShortcut = enabled;
+        }
+        inline bool GetLineOfSightShortcut(void) const {
+            return m_LineOfSightShortcut;
+        }
+
+        // True when every cell the segment between the cell centres touches is open for the agent
+        // size, read straight from the occupancy bits for single cell agents.
+        bool HasLineOfSight(const cdGridCoord& from, const cdGridCoord& to) const;
+
+        // Finds the first blocked cell the segment touches, in the order HasLineOfSight walks them
+        // but on the occupancy bits alone whatever the agent size, cells off the map blocked too.
+        // firstHit is the end cell when nothing is in the way.
+        bool CastRay(const cdGridCoord& from, const cdGridCoord& to, cdGridCoord& firstHit) const;
+
+        // CastRay for every from and to pair, as many rays as the shortest of the four spans, split
+        // over the threads. Returns how many hit.
+        size_t CastRays(std::span<const cdGridCoord> from, std::span<const cdGridCoord> to,
+            std::span<u8> hits, std::span<cdGridCoord> firstHits, int numThreads = 1) const;
+
+        inline f32 GetThreatCost(u8 threat) const {
+            return m_ThreatCostTable[threat];
+        }
+
+        // Multiplier for stepping onto the cell, its threat cost when THREAT_WEIGHTED, 1 otherwise.
+        inline f32 GetEnterCost(const cdGridCoord& cell) const {
+            return m_CostMode == cdCostMode::THREAT_WEIGHTED ? m_ThreatCostTable[GetQuantizedThreat(cell)] : 1.0f;
+        }
+
+        // Cost of one step onto the cell along k_GridDirections[dir].
+        inline f32 GetStepCost(int dir, const cdGridCoord& cell) const {
+            return GetStepLength(dir) * GetEnterCost(cell);
+        }
+
+        // Every search, flow field and heuristic on the map charges diagonals this much. The
+        // MovingAI benchmarks measure them as sqrt(2). Goal bounds built for another length are left
+        // unused until rebuilt.
+        void SetDiagonalStepLength(f32 length);
+        inline f32 GetDiagonalStepLength(void) const {
+            return m_DiagonalStepLength;
+        }
+
+        inline f32 GetStepLength(int dir) const {
+            return dir < 4 ? GetGridStepLength(dir) : m_DiagonalStepLength;
+        }
+
+        void SetThreatWeight(f32 weight);
+        inline f32 GetThreatWeight(void) const {
+            return m_ThreatWeight;
+        }
+
+        // Requantizes the threat layer, editing the chunks whose quantized threat changes.
+        void SetThreatScale(f32 scale);
+        inline f32 GetThreatScale(void) const {
+            return m_ThreatScale;
+        }
+
+        // Writes cdGridCell::Threat and the quantized layer together.
+        void SetThreat(const cdGridCoord& cell, f32 threat);
+        void SetThreatRow(int x, int y, int count, const f32* threat);
+
+        inline u8 GetQuantizedThreat(const cdGridCoord& cell) const {
+            return m_ThreatLayer[GetLayerIndex(cell.X, cell.Y)];
+        }
+
+        // Builds the agent's neighbour masks when it changes to more than a cell, a pass over the map.
+        void SetAgentSize(int size);
+        inline int GetAgentSize(void) const {
+            return m_AgentSize;
+        }
+        // The agent size the goal bounds were built or loaded for.
+        inline int GetGoalBoundsAgentSize(void) const {
+            return m_GoalBoundsAgentSize;
+        }
+        // True when the goal bounds match the agent size, corner rule and diagonal length and
+        // searches use them.
+        inline bool GetGoalBoundsEnabled(void) const {
+            return m_GoalBoundsEnabled && HasGoalBounds();
+        }
+
+        inline u8 GetClearance(const cdGridCoord& cell) const {
+            return m_Clearance[GetLayerIndex(cell.X, cell.Y)];
+        }
+
+        inline u8 GetNeighbourMask(const cdGridCoord& cell) const {
+            return m_NeighbourMasks[GetLayerIndex(cell.X, cell.Y)];
+        }
+
+        // GetNeighbourMask for the agent size, the neighbours open to it.
+        inline u8 GetAgentNeighbourMask(const cdGridCoord& cell) const {
+            return m_AgentSize > 1 ? m_AgentMasks[GetLayerIndex(cell.X, cell.Y)] : GetNeighbourMask(cell);
+        }
+
+        // Relays the layers out, copying any that are still read from a map file.
+        void SetCellLayout(cdCellLayout layout);
+        inline cdCellLayout GetCellLayout(void) const {
+            return m_Layout;
+        }
+
         cdGridCoord GetCellCoord(const cdPoint2f& position);
         cdPoint2f GetCellPosition(const cdGridCoord& coord);
         void ComputeWorldPaths(const std::vector<cdGridCoord>& cellPaths,
@@ -137,6 +542,50 @@ class cdGridMap : public cdJumpStartMap {
         inline const cdPoint2f& GetDimension(void) const {
             return m_MapDimension;
         }
+
+        inline void SetMapId(u32 id) {
+            m_MapId = id;
+        }
+        inline u32 GetMapId(void) const {
+            return m_MapId;
+        }
+
+        // Bumped by every edit to the cells or the threat, and by the settings that change step
+        // costs or moves: cost mode, threat weight and scale, diagonal length, corner rule and agent
+        // size.
+        inline u32 GetVersion(void) const {
+            return m_Version;
+        }
+
+        inline int GetNumChunks(void) const {
+            return static_cast<int>(m_ChunkVersions.size());
+        }
+
+        inline int GetNumChunkCols(void) const {
+            return m_NumChunkCols;
+        }
+
+        inline int GetChunkIndex(const cdGridCoord& cell) const {
+            return (cell.Y >> k_ChunkShift) * m_NumChunkCols + (cell.X >> k_ChunkShift);
+        }
+
+        // Bumped by every edit that changes the chunk's cell data, the collision, moves and quantized
+        // threat of its cells. Settings like the threat weight or diagonal length only move
+        // GetVersion, whoever caches costs compares them as well.
+        inline u32 GetChunkVersion(int chunk) const {
+            return m_ChunkVersions[chunk];
+        }
+
+        // True while the cells are still read in place, false once owned or copied by an edit.
+        inline bool IsCellStorageShared(void) const {
+            return m_Cells.IsView();
+        }
+
+        // True while at least one derived layer is still read from a map file.
+        inline bool IsLayerStorageShared(void) const {
+            return m_Occupancy.IsView() || m_NeighbourMasks.IsView() ||
+                m_ThreatLayer.IsView() || m_Clearance.IsView();
+        }
 };
 }
 
@@ -19,6 +19,15 @@ namespace ceed::ai::path {
 		return std::max(abs(p_iSrcX - p_iDstX), abs(p_iSrcY - p_iDstY));
 	}
 
+	// Shortest 8-connected distance, with the grid maps' 1.5 diagonal steps unless told otherwise.
+	template <typename T>
+	inline T OctileDistance(const T p_iSrcX, const T p_iSrcY, const T p_iDstX, const T p_iDstY,
+		const T p_diagonal = T(1.5)) {
+		const T dx = abs(p_iSrcX - p_iDstX);
+		const T dy = abs(p_iSrcY - p_iDstY);
+		return std::max(dx, dy) + std::min(dx, dy) * (p_diagonal - 1);
+	}
+
 	template <typename T>
 	inline T EuclideanDistance(const T p_iSrcX, const T p_iSrcY, const T p_iDstX, const T p_iDstY) {
 		return (T)sqrt((p_iSrcX - p_iDstX)*(p_iSrcX - p_iDstX) + (p_iSrcY - p_iDstY)*(p_iSrcY - p_iDstY));
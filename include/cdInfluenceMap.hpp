@@ -0,0 +1,96 @@
+/*!
+ * \file cdInfluenceMap.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDINFLUENCEMAP_HPP_
+#define _CDINFLUENCEMAP_HPP_
+
+#include <vector>
+
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+	// Influence map laid out like cdGridMap (row major, one float per cell). Every Propagate
+	// decays the previous values, adds this tick's sources and runs a separable blur. Work is
+	// tracked per tile so only tiles that hold influence, or are next to one, get recomputed,
+	// and Apply only pushes those tiles into the map's threat layer.
+	class cdInfluenceMap {
+		private:
+			int m_NumCols;
+			int m_NumRows;
+			int m_TileSize;
+			int m_NumTileCols;
+			int m_NumTileRows;
+
+			f32 m_Decay;
+			f32 m_Cutoff;
+			std::vector<f32> m_Kernel; // Odd length, used for both blur passes.
+
+			std::vector<f32> m_Values;
+			std::vector<f32> m_Sources; // Stamped by AddSource, consumed by Propagate.
+			std::vector<f32> m_Scratch; // Horizontal pass output, kept zero outside dirty tiles.
+
+			std::vector<u8> m_ActiveTiles; // Tiles holding a value above the cutoff.
+			std::vector<u8> m_SourceTiles; // Tiles that got a source since the last Propagate.
+			std::vector<u8> m_DirtyTiles;  // Tiles recomputed by the last Propagate.
+			std::vector<int> m_DirtyList;
+
+		private:
+
+			void CollectDirtyTiles();
+			void DecayTile(int tileIdx);
+			void BlurTileRows(int tileIdx);
+			void BlurTileColumns(int tileIdx);
+			void RefreshTileActivity(int tileIdx);
+
+		public:
+
+			cdInfluenceMap(int cols, int rows, int tileSize = 16);
+			explicit cdInfluenceMap(const cdGridMap& map, int tileSize = 16);
+
+			// Fraction of the previous value kept every tick.
+			inline void SetDecay(f32 decay) {
+				m_Decay = decay;
+			}
+			inline f32 GetDecay(void) const {
+				return m_Decay;
+			}
+
+			// Tiles whose values all drop below the cutoff are zeroed and go to sleep.
+			inline void SetCutoff(f32 cutoff) {
+				m_Cutoff = cutoff;
+			}
+
+			// 1D kernel applied along rows then columns. Needs an odd length and a radius no wider
+			// than a tile, returns false otherwise.
+			bool SetKernel(const std::vector<f32>& kernel);
+
+			void AddSource(const cdGridCoord& cell, f32 strength);
+
+			// Runs one tick.
+			void Propagate();
+
+			// Copies the tiles recomputed by the last Propagate into the map's threat values.
+			void Apply(cdGridMap& map) const;
+
+			void Clear();
+
+			inline f32 GetValue(const cdGridCoord& cell) const {
+				return m_Values[cell.Y * m_NumCols + cell.X];
+			}
+
+			inline bool IsTileDirty(const cdGridCoord& cell) const {
+				return m_DirtyTiles[(cell.Y / m_TileSize) * m_NumTileCols + cell.X / m_TileSize] != 0;
+			}
+
+			inline int GetNumDirtyTiles(void) const {
+				return static_cast<int>(m_DirtyList.size());
+			}
+
+			inline int GetTileSize(void) const {
+				return m_TileSize;
+			}
+	};
+}
+
+#endif
@@ -5,8 +5,13 @@
 #ifndef _CDJUMPSTARTMAP_HPP_
 #define _CDJUMPSTARTMAP_HPP_
 
+#include <algorithm>
+#include <array>
+#include <stdlib.h>
+
 #include "cdAStarMap.hpp"
 #include "cdAStar.hpp"
+#include "cdGridLayer.hpp"
 
 namespace ceed::ai::path {
 	enum atlGridCellType : char {
@@ -30,12 +35,91 @@ namespace ceed::ai::path {
 		}
 	};
 
+	struct cdGridDirection {
+		int X, Y;
+		constexpr cdGridDirection(int x = 0, int y = 0)
+			: X(x), Y(y) {}
+	};
+
+	// The 8 grid directions. Orthogonal first, then diagonal. Anything that stores per direction
+	// data (goal bounds, neighbour masks) uses this order.
+	constexpr std::array<cdGridDirection, 8> k_GridDirections = {{
+		{0, 1},
+		{1, 0},
+		{0, -1},
+		{-1, 0},
+		{1, 1},
+		{1, -1},
+		{-1, -1},
+		{-1, 1}
+	}};
+
+	// Length of one step along k_GridDirections[dir], diagonals cost 1.5. Every grid search charges
+	// steps by this, times the cost of entering the cell in threat weighted searches. A cdGridMap
+	// can be given another diagonal length, see cdGridMap::SetDiagonalStepLength.
+	constexpr f32 GetGridStepLength(int dir) {
+		return dir < 4 ? 1.0f : 1.5f;
+	}
+
+	// Length of a leg along one of the 8 directions, or of the shortest way between the two cells
+	// made of min(|dx|, |dy|) diagonal steps and the rest straight ones.
+	inline f32 GetOctileLegLength(const cdGridCoord& from, const cdGridCoord& to,
+		f32 diagonalLength = GetGridStepLength(4)) {
+		const int dx = abs(to.X - from.X);
+		const int dy = abs(to.Y - from.Y);
+		const int diagonal = std::min(dx, dy);
+		return static_cast<f32>(std::max(dx, dy) - diagonal) * GetGridStepLength(0) +
+			static_cast<f32>(diagonal) * diagonalLength;
+	}
+
+	// Index into k_GridDirections from a unit step, -1 for (0, 0).
+	constexpr int GetGridDirectionIndex(int xDir, int yDir) {
+		constexpr int lookup[9] = { 6, 2, 5, 3, -1, 1, 7, 0, 4 };
+		return lookup[(yDir + 1) * 3 + (xDir + 1)];
+	}
+
+	// Bounding box of every cell that is reached optimally by leaving a cell through one direction.
+	struct cdGoalBounds {
+		s32 MinX, MinY, MaxX, MaxY;
+
+		inline cdGoalBounds()
+		: MinX(1), MinY(1), MaxX(0), MaxY(0) {}
+
+		inline bool IsEmpty() const {
+			return MinX > MaxX;
+		}
+
+		inline bool Contains(const cdGridCoord& cell) const {
+			return cell.X >= MinX && cell.X <= MaxX && cell.Y >= MinY && cell.Y <= MaxY;
+		}
+
+		inline void Extend(const cdGridCoord& cell) {
+			if (IsEmpty()) {
+				MinX = MaxX = cell.X;
+				MinY = MaxY = cell.Y;
+				return;
+			}
+			MinX = std::min(MinX, cell.X);
+			MinY = std::min(MinY, cell.Y);
+			MaxX = std::max(MaxX, cell.X);
+			MaxY = std::max(MaxY, cell.Y);
+		}
+	};
+
 	class cdJumpStartMap : public cdAStarMap<cdGridCoord> {
 		protected:
 			int m_NumCols;
 			int m_NumRows;
 			int m_ArraySize;
 
+			// 8 boxes per cell, indexed by cell * 8 + direction. Empty when goal bounding is off.
+			cdGridLayer<cdGoalBounds> m_GoalBounds;
+			// Lets a derived map keep the table around while it does not apply, e.g. another agent size.
+			bool m_GoalBoundsEnabled;
+			// Jumps and goal bounds take diagonal steps past blocked corners. When off a diagonal step
+			// needs both orthogonal neighbours open, and the pruning follows that rule instead.
+			bool m_CutCorners;
+
 		protected:
 
 			cdJumpStartMap(CellColFunc cellFunc,
@@ -47,6 +131,16 @@ namespace ceed::ai::path {
 
 			inline virtual ~cdJumpStartMap() override {}
 
+			// The step onto the neighbour in k_GridDirections[dir] is open, corners included.
+			bool CanStep(const cdGridCoord& cell, int dir);
+
+			// Natural and forced neighbours of a cell reached along (xDir, yDir) when corners may not be cut.
+			void PruneWithoutCornerCutting(const cdGridCoord& pos, int xDir, int yDir,
+				std::vector<cdGridCoord>& result);
+
+			// A straight move along (xDir, yDir) has a forced neighbour at the cell.
+			bool IsForcedStraight(const cdGridCoord& pos, int xDir, int yDir);
+
 			void Prune(const cdAStar<cdGridCoord>* astar,
 				const cdNode<cdGridCoord> & current,
 				std::vector<cdGridCoord> & result);
@@ -59,11 +153,27 @@ namespace ceed::ai::path {
 
 		public:
 
+			// The cell's coordinates packed together, for cdAStarMap::NodeKey.
+			inline u64 GetNodeKey(const cdGridCoord& cell) {
+				return (static_cast<u64>(static_cast<u32>(cell.Y)) << 32) | static_cast<u32>(cell.X);
+			}
+
 			bool GetSucessorList(const cdAStar<cdGridCoord>* astar,
 				const cdNode<cdGridCoord>& current,
 				const cdGridCoord& start,
 				const std::vector<cdGridCoord>& end,
 				std::vector<cdGridCoord>& adjcentList);
+
+			// Goal bounding precomputation. Runs a Dijkstra from every open cell so it is meant
+			// for static maps, and has to be rebuilt whenever the map or the cost model changes.
+			virtual void BuildGoalBounds();
+			void ClearGoalBounds();
+
+			inline bool HasGoalBounds() const {
+				return !m_GoalBounds.Empty();
+			}
+
+			const cdGoalBounds& GetGoalBounds(const cdGridCoord& cell, int direction) const;
 	};
 }
 
@@ -0,0 +1,146 @@
+/*!
+ * \file cdMapFile.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDMAPFILE_HPP_
+#define _CDMAPFILE_HPP_
+
+#include <functional>
+#include <vector>
+
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+	struct cdMapFileSection {
+		u32 Type;
+		u32 Param;  // Type specific, see SectionType. 0 when the type takes none.
+		u32 Param2; // Same.
+		f32 ParamF; // Same, a float one.
+		u64 Offset; // From the start of the file, 64 byte aligned.
+		u64 Size;   // In bytes.
+	};
+
+	constexpr u32 k_MapFileMagic = 0x4D504443; // "CDPM"
+	constexpr u32 k_MapFileVersion = 2;
+	constexpr u32 k_MapFileMaxSections = 8;
+
+	struct cdMapFileHeader {
+		u32 Magic;
+		u32 Version;
+		s32 NumCols;
+		s32 NumRows;
+		f32 DimensionX;
+		f32 DimensionY;
+		f32 ThreatScale;
+		u32 NumSections;
+		cdMapFileSection Sections[k_MapFileMaxSections];
+	};
+
+	// Versioned binary map. The file is memory mapped read only, so opening it only costs the page
+	// ins and every process mapping the same file shares the pages. Layers of a cdGridMap built from
+	// it read the mapping directly until the map gets edited.
+	//
+	// The same image can live in a named POSIX shared memory segment instead of a file, for hosts
+	// running many server processes on the same maps: a loader process builds the segment once with
+	// CreateShared and every server attaches it read only with OpenShared. Shared segments are not
+	// supported on Windows.
+	class cdMapFile {
+		public:
+			// Occupancy and threat are always there, the rest is optional precomputation. Unknown
+			// section types are skipped so newer files still open.
+			enum SectionType : u32 {
+				SECTION_OCCUPANCY = 1,    // u64 words, one bit per cell, rows padded to a word.
+				SECTION_THREAT,           // u8 per cell, scaled by cdMapFileHeader::ThreatScale.
+				SECTION_NEIGHBOUR_MASKS,  // u8 per cell.
+				SECTION_CLEARANCE,        // u8 per cell.
+				SECTION_GOAL_BOUNDS       // cdGoalBounds x 8 per cell, Param is the agent size they were
+				                          // built for, Param2 the cdCornerRule and ParamF the diagonal
+				                          // step length. Sections without a size or length are rejected.
+			};
+
+			enum WriteFlags : u32 {
+				WRITE_NEIGHBOUR_MASKS = 1 << 0,
+				WRITE_CLEARANCE = 1 << 1,
+				WRITE_GOAL_BOUNDS = 1 << 2, // Only when the map has them built.
+				WRITE_ALL_TABLES = WRITE_NEIGHBOUR_MASKS | WRITE_CLEARANCE | WRITE_GOAL_BOUNDS
+			};
+
+		private:
+			// A map laid out for writing, the row major copies only when the map is tiled.
+			struct cdImage {
+				cdMapFileHeader Header;
+				const void* SectionData[k_MapFileMaxSections];
+				u64 Size;
+				std::vector<u64> Occupancy;
+				std::vector<u8> Threat;
+				std::vector<u8> Masks;
+				std::vector<u8> Clearance;
+			};
+
+			const u8* m_Data;
+			size_t m_Size;
+
+#ifdef _WIN32
+			void* m_File;
+			void* m_Mapping;
+#else
+			int m_File;
+#endif
+
+		private:
+
+			bool Validate() const;
+#ifndef _WIN32
+			void MapView();
+#endif
+
+			static void BuildImage(const cdGridMap& map, u32 flags, cdImage& image);
+
+		public:
+
+			// Fills the cells of one row.
+			using RowFunc = std::function<void(int row, cdGridCell* cells)>;
+
+		public:
+
+			cdMapFile();
+			~cdMapFile();
+
+			cdMapFile(const cdMapFile&) = delete;
+			cdMapFile& operator = (const cdMapFile&) = delete;
+
+			bool Open(const char* path);
+			// Attaches a segment made by CreateShared, read only. The name follows shm_open, "/name".
+			bool OpenShared(const char* name);
+			void Close();
+
+			inline bool IsOpen() const {
+				return m_Data != nullptr;
+			}
+
+			inline const cdMapFileHeader* GetHeader() const {
+				return reinterpret_cast<const cdMapFileHeader*>(m_Data);
+			}
+
+			// The header of an open file. A missing or closed one gets an all zero header, that of an
+			// empty map.
+			static const cdMapFileHeader& GetOpenHeader(const cdMapFile* file);
+
+			// nullptr when the file does not have the section.
+			const cdMapFileSection* FindSection(u32 type) const;
+			const void* GetSection(u32 type, size_t& size) const;
+
+			static bool Write(const char* path, const cdGridMap& map, u32 flags = WRITE_ALL_TABLES);
+			// Writes occupancy and threat a row at a time, for worlds too big to hold as a cdGridMap.
+			// Every row is asked for twice, once per section.
+			static bool Write(const char* path, int cols, int rows, const cdPoint2f& dimension,
+				f32 threatScale, const RowFunc& getRow);
+
+			// Builds the segment, replacing any segment of that name. It outlives the loader, until
+			// RemoveShared. Processes attached to a replaced segment keep reading the old one.
+			static bool CreateShared(const char* name, const cdGridMap& map, u32 flags = WRITE_ALL_TABLES);
+			static bool RemoveShared(const char* name);
+	};
+}
+
+#endif
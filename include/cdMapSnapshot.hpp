@@ -0,0 +1,209 @@
+/*!
+ * \file cdMapSnapshot.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDMAPSNAPSHOT_HPP_
+#define _CDMAPSNAPSHOT_HPP_
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+	// The layers of one square chunk of 1 << cdGridMap::k_ChunkShift cells a side, row major, and
+	// the chunk version they were copied at. The neighbour masks are for the snapshot's agent size.
+	// Cells past the map edge stay zero.
+	struct cdMapSnapshotChunk {
+		static constexpr size_t k_NumCells = size_t(1) << (cdGridMap::k_ChunkShift * 2);
+
+		u32 Version;
+		std::array<u8, k_NumCells> Clearance;
+		std::array<u8, k_NumCells> NeighbourMasks;
+		std::array<u8, k_NumCells> Threat;
+	};
+
+	// Immutable, searchable copy of a cdGridMap at one version. Chunks whose cdGridMap chunk version
+	// did not move since the previous snapshot are shared with it, so publishing only copies what
+	// the edits touched. A new agent size copies every chunk.
+	// Search settings (mode, corner rule, cost mode and table, diagonal length, agent size) are the
+	// map's at publish time and live in the snapshot itself, not in the chunks. Goal bounds are not
+	// carried over.
+	class cdMapSnapshot : public cdJumpStartMap {
+		friend class cdSnapshotPublisher;
+
+		private:
+			u32 m_Version;
+			int m_AgentSize;
+			cdSearchMode m_SearchMode;
+			cdCornerRule m_CornerRule;
+			cdCostMode m_CostMode;
+			f32 m_DiagonalStepLength;
+			std::array<f32, 256> m_ThreatCostTable;
+
+			std::vector<std::shared_ptr<const cdMapSnapshotChunk>> m_Chunks;
+			int m_NumChunkCols;
+
+			// Publisher epoch the snapshot was replaced in.
+			u64 m_RetireEpoch;
+
+		private:
+
+			cdMapSnapshot(const cdGridMap& map, const cdMapSnapshot* previous);
+
+			inline int GetChunkCellIndex(int x, int y) const {
+				constexpr int mask = (1 << cdGridMap::k_ChunkShift) - 1;
+				return ((y & mask) << cdGridMap::k_ChunkShift) | (x & mask);
+			}
+
+			inline const cdMapSnapshotChunk& GetChunk(int x, int y) const {
+				return *m_Chunks[(y >> cdGridMap::k_ChunkShift) * m_NumChunkCols + (x >> cdGridMap::k_ChunkShift)];
+			}
+
+		public:
+
+			cdMapSnapshot(const cdMapSnapshot&) = delete;
+			cdMapSnapshot& operator = (const cdMapSnapshot&) = delete;
+
+			bool CellCollides(const cdGridCoord& cell) const;
+			// Same walk as cdGridMap::HasLineOfSight, on the clearance for the agent size.
+			bool HasLineOfSight(const cdGridCoord& from, const cdGridCoord& to) const;
+
+			f32 GetHeuristics(const cdGridCoord&,
+				const cdGridCoord&,
+				const std::vector<cdGridCoord>&);
+			f32 GetMovementCost(const cdGridCoord&,
+				const cdGridCoord&);
+
+			bool GetGridSucessorList(const cdAStar<cdGridCoord>* astar,
+				const cdNode<cdGridCoord>& current,
+				const cdGridCoord& start,
+				const std::vector<cdGridCoord>& end,
+				std::vector<cdGridCoord>& adjcentList);
+
+			// cdGridMap::GetVersion when the snapshot was taken.
+			inline u32 GetVersion() const {
+				return m_Version;
+			}
+
+			inline cdSearchMode GetSearchMode() const {
+				return m_SearchMode;
+			}
+
+			inline int GetNumCols() const {
+				return m_NumCols;
+			}
+
+			inline int GetNumRows() const {
+				return m_NumRows;
+			}
+
+			inline u8 GetClearance(const cdGridCoord& cell) const {
+				return GetChunk(cell.X, cell.Y).Clearance[GetChunkCellIndex(cell.X, cell.Y)];
+			}
+
+			inline u8 GetQuantizedThreat(const cdGridCoord& cell) const {
+				return GetChunk(cell.X, cell.Y).Threat[GetChunkCellIndex(cell.X, cell.Y)];
+			}
+
+			// For checking which chunks two snapshots share, indexed as cdGridMap::GetChunkIndex.
+			inline const cdMapSnapshotChunk* GetChunkData(int chunk) const {
+				return m_Chunks[chunk].get();
+			}
+	};
+
+	// Publishes cdMapSnapshots of a cdGridMap for searches on other threads. The owning thread
+	// edits the map as usual and calls Publish, readers pin the current snapshot for the length of
+	// their search. Neither side takes a lock: the current snapshot is swapped atomically and the
+	// replaced ones are freed by epoch based reclamation once no reader can still be on them.
+	//
+	// Publish, Reclaim and the destructor belong to the writer. Acquire and Release belong to the
+	// thread that owns the reader slot, AddReader and RemoveReader are safe from any thread.
+	class cdSnapshotPublisher {
+		public:
+			static constexpr int k_MaxReaders = 64;
+
+		private:
+			static constexpr u64 k_IdleEpoch = ~u64(0);
+
+			// Own cache line each, readers only ever write their own.
+			struct alignas(64) cdReaderSlot {
+				std::atomic<u64> Epoch;
+				std::atomic<bool> InUse;
+			};
+
+			cdGridMap& m_Map;
+			std::atomic<cdMapSnapshot*> m_Current;
+			std::atomic<u64> m_Epoch;
+			std::array<cdReaderSlot, k_MaxReaders> m_Readers;
+
+			// Replaced snapshots waiting for their readers, writer only.
+			std::vector<std::unique_ptr<cdMapSnapshot>> m_Retired;
+			size_t m_NumPublished;
+
+		public:
+
+			// Publishes the first snapshot straight away.
+			explicit cdSnapshotPublisher(cdGridMap& map);
+			// Every reader has to be released by now.
+			~cdSnapshotPublisher();
+
+			cdSnapshotPublisher(const cdSnapshotPublisher&) = delete;
+			cdSnapshotPublisher& operator = (const cdSnapshotPublisher&) = delete;
+
+			// Snapshots the map's current state, copying only the edited chunks, then reclaims.
+			void Publish();
+			// Frees the replaced snapshots no reader can see any more. Returns how many.
+			size_t Reclaim();
+
+			// -1 when every slot is taken.
+			int AddReader();
+			void RemoveReader(int reader);
+
+			// The snapshot stays valid until the reader's next Release.
+			cdMapSnapshot* Acquire(int reader);
+			void Release(int reader);
+
+			inline size_t GetNumRetired() const {
+				return m_Retired.size();
+			}
+
+			inline size_t GetNumPublished() const {
+				return m_NumPublished;
+			}
+	};
+
+	// Pins the current snapshot for a scope.
+	class cdSnapshotGuard {
+		private:
+			cdSnapshotPublisher& m_Publisher;
+			int m_Reader;
+			cdMapSnapshot* m_Snapshot;
+
+		public:
+
+			inline cdSnapshotGuard(cdSnapshotPublisher& publisher, int reader)
+			: m_Publisher(publisher)
+			, m_Reader(reader)
+			, m_Snapshot(publisher.Acquire(reader)) {}
+
+			inline ~cdSnapshotGuard() {
+				m_Publisher.Release(m_Reader);
+			}
+
+			cdSnapshotGuard(const cdSnapshotGuard&) = delete;
+			cdSnapshotGuard& operator = (const cdSnapshotGuard&) = delete;
+
+			inline cdMapSnapshot* Get() const {
+				return m_Snapshot;
+			}
+
+			inline cdMapSnapshot* operator -> () const {
+				return m_Snapshot;
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,51 @@
+/*!
+ * \file cdMovingAI.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDMOVINGAI_HPP_
+#define _CDMOVINGAI_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+	// One line of a MovingAI .scen file. Coordinates are column / row, same as cdGridCoord.
+	struct cdMovingAIScenario {
+		int Bucket;
+		std::string MapName;
+		int MapWidth;
+		int MapHeight;
+		cdGridCoord Start;
+		cdGridCoord Goal;
+		f64 OptimalLength;
+	};
+
+	// Reads a MovingAI "type octile" .map file. '.', 'G' and 'S' are open, everything else
+	// ('@', 'O', 'T', 'W') is blocked. Each cell is one world unit.
+	bool LoadMovingAIMap(const char* path, cdGridCellList& cells, int& cols, int& rows);
+	std::unique_ptr<cdGridMap> LoadMovingAIMap(const char* path);
+
+	// Reads a "version 1" .scen file.
+	bool LoadMovingAIScenarios(const char* path, std::vector<cdMovingAIScenario>& scenarios);
+
+	// Octile length of a path (1 straight, sqrt(2) diagonal), the metric the MovingAI optimal
+	// lengths are given in. Works on JPS jump point paths as well as cell by cell ones.
+	f64 GetOctilePathLength(const std::vector<cdGridCoord>& path);
+
+	// Diagonal step length the MovingAI optimal lengths are measured in.
+	constexpr f32 k_MovingAIDiagonalLength = 1.41421356f;
+
+	// Sets the search mode together with the movement rules the MovingAI optimal lengths assume: no
+	// squeezing past blocked corners and sqrt(2) diagonals. Returns false for ANY_ANGLE, whose legs
+	// are not grid moves, so its lengths can come out under the reference.
+	bool SetMovingAISearchMode(cdGridMap& map, cdSearchMode mode);
+
+	// Relative length error of a path against a scenario's optimal length, (length - optimal) / optimal.
+	// Zero up to float rounding for paths found with SetMovingAISearchMode() returning true.
+	f64 GetPathLengthError(const std::vector<cdGridCoord>& path, f64 optimalLength);
+}
+
+#endif
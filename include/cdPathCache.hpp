@@ -0,0 +1,123 @@
+/*!
+ * \file cdPathCache.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDPATHCACHE_HPP_
+#define _CDPATHCACHE_HPP_
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "cdAStar.hpp"
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+	// Remembers the paths cdAStar found on a cdGridMap by start and goal cell, for the queries that
+	// keep coming back, spawn points to objectives and the like. Each path is tagged with the edit
+	// version of every chunk it crosses, corner cells of its diagonal steps included, and is only
+	// handed out again while those are unchanged, so an edit throws away just the paths through
+	// its chunks. Paths found under other search settings, cost table and diagonal length included,
+	// never match.
+	//
+	// A path stays valid through edits elsewhere but can stop being the cheapest once one opens a
+	// shorter way. Failed searches are not cached. The least recently used paths are dropped to
+	// stay within the memory budget.
+	class cdPathCache {
+		public:
+			static constexpr size_t k_DefaultMemoryBudget = 4 * 1024 * 1024;
+
+		private:
+			struct cdChunkTag {
+				s32 Chunk;
+				u32 Version;
+			};
+
+			struct cdCachedPath {
+				u64 Key;
+				std::vector<cdGridCoord> Path;
+				std::vector<cdChunkTag> Tags;
+				cdSearchMode SearchMode;
+				cdCornerRule CornerRule;
+				cdCostMode CostMode;
+				int AgentSize;
+				f32 ThreatWeight;
+				f32 ThreatScale;
+				f32 DiagonalStepLength;
+			};
+
+			cdGridMap& m_Map;
+			size_t m_MemoryBudget;
+			size_t m_MemoryUsage;
+
+			// Most recently used first.
+			std::list<cdCachedPath> m_Paths;
+			std::unordered_map<u64, std::list<cdCachedPath>::iterator> m_Lookup;
+
+			size_t m_NumHits;
+			size_t m_NumMisses;
+			size_t m_NumInvalidations;
+
+			std::vector<s32> m_Chunks;
+
+		private:
+
+			inline u64 GetKey(const cdGridCoord& start, const cdGridCoord& goal) const {
+				const auto numCells = static_cast<u64>(m_Map.GetNumCols()) * m_Map.GetNumRows();
+				return (start.Y * m_Map.GetNumCols() + start.X) * numCells + goal.Y * m_Map.GetNumCols() + goal.X;
+			}
+
+			static size_t GetMemoryUsage(const cdCachedPath& cached);
+
+			bool IsValid(const cdCachedPath& cached) const;
+			void Erase(std::list<cdCachedPath>::iterator cached);
+			void TagPath(cdCachedPath& cached);
+
+		public:
+
+			explicit cdPathCache(cdGridMap& map, size_t memoryBudget = k_DefaultMemoryBudget);
+
+			cdPathCache(const cdPathCache&) = delete;
+			cdPathCache& operator = (const cdPathCache&) = delete;
+
+			// Same as cdAStar::FindPath, goal first, searching only on a miss.
+			bool FindPath(cdAStar<cdGridCoord>& aStar, const cdGridCoord& start, const cdGridCoord& goal,
+				std::vector<cdGridCoord>& path);
+
+			void SetMemoryBudget(size_t memoryBudget);
+			void Clear();
+
+			inline size_t GetNumPaths(void) const {
+				return m_Paths.size();
+			}
+
+			// Bytes held by the cached paths and their tags.
+			inline size_t GetMemoryUsage(void) const {
+				return m_MemoryUsage;
+			}
+
+			inline size_t GetMemoryBudget(void) const {
+				return m_MemoryBudget;
+			}
+
+			inline size_t GetNumHits(void) const {
+				return m_NumHits;
+			}
+
+			inline size_t GetNumMisses(void) const {
+				return m_NumMisses;
+			}
+
+			// Cached paths found stale by an edit, each of them also counted as a miss.
+			inline size_t GetNumInvalidations(void) const {
+				return m_NumInvalidations;
+			}
+
+			inline f32 GetHitRate(void) const {
+				const auto total = m_NumHits + m_NumMisses;
+				return total == 0 ? 0.0f : static_cast<f32>(m_NumHits) / static_cast<f32>(total);
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,116 @@
+/*!
+ * \file cdQueryRecorder.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDQUERYRECORDER_HPP_
+#define _CDQUERYRECORDER_HPP_
+
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <vector>
+
+#include "cdAStar.hpp"
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+	constexpr u32 k_QueryLogMagic = 0x4C514443; // "CDQL"
+	constexpr u32 k_QueryLogVersion = 3;
+
+	struct cdQueryLogHeader {
+		u32 Magic;
+		u32 Version;
+	};
+
+	// One FindPath call as it sits in the log, followed by NumGoals x (s32 X, s32 Y).
+	struct cdQueryLogEntry {
+		u32 MapId;
+		u32 MapVersion;
+		s32 StartX;
+		s32 StartY;
+		f32 LatencyUs;
+		u32 Expansions;
+		f32 ThreatWeight;
+		f32 ThreatScale;
+		f32 DiagonalStepLength;
+		u16 NumGoals;
+		u8 SearchMode;  // cdSearchMode
+		u8 CostMode;    // cdCostMode
+		u8 CornerRule;  // cdCornerRule
+		u8 AgentSize;
+		u8 Found;
+		u8 LineOfSightShortcut;
+	};
+
+	static_assert(sizeof(cdQueryLogEntry) == 44, "query log entries are written as is");
+
+	struct cdQueryRecord {
+		u32 MapId;
+		u32 MapVersion;
+		cdGridCoord Start;
+		std::vector<cdGridCoord> Goals;
+		cdSearchMode SearchMode;
+		cdCostMode CostMode;
+		cdCornerRule CornerRule;
+		int AgentSize;
+		f32 ThreatWeight;
+		f32 ThreatScale;
+		f32 DiagonalStepLength;
+		bool LineOfSightShortcut;
+		bool Found;
+		u32 Expansions;
+		f32 LatencyUs;
+	};
+
+	// Opt in log of the queries run through any cdAStar it is attached to. Entries are buffered and
+	// written in blocks, one recorder can be shared by searches on several threads.
+	class cdQueryRecorder {
+		private:
+			FILE* m_File;
+			std::vector<u8> m_Buffer;
+			std::atomic<size_t> m_NumRecords; // Written under m_Mutex, read without it.
+			std::mutex m_Mutex;
+
+		private:
+
+			void Flush();
+
+			void OnQuery(const cdAStar<cdGridCoord>* aStar,
+				const cdGridCoord& start,
+				const std::vector<cdGridCoord>& goals,
+				const cdAStarMap<cdGridCoord>* map,
+				bool found,
+				f64 latencyUs);
+
+		public:
+
+			cdQueryRecorder();
+			~cdQueryRecorder();
+
+			cdQueryRecorder(const cdQueryRecorder&) = delete;
+			cdQueryRecorder& operator = (const cdQueryRecorder&) = delete;
+
+			// Truncates the file.
+			bool Open(const char* path);
+			void Close();
+
+			inline bool IsOpen() const {
+				return m_File != nullptr;
+			}
+
+			inline size_t GetNumRecords() const {
+				return m_NumRecords;
+			}
+
+			// Maps that are not a cdGridMap are logged with id 0, DISTANCE / JUMP_POINT modes and the
+			// default threat weight, scale, diagonal length and line of sight shortcut.
+			void Attach(cdAStar<cdGridCoord>& aStar);
+			static void Detach(cdAStar<cdGridCoord>& aStar);
+
+			void Record(const cdQueryRecord& record);
+
+			static bool Load(const char* path, std::vector<cdQueryRecord>& records);
+	};
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*!
+ * \file cdReservationTable.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDRESERVATIONTABLE_HPP_
+#define _CDRESERVATIONTABLE_HPP_
+
+#include <unordered_map>
+#include <vector>
+
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+	// Who holds which cell at which tick, shared by agents planning in space-time. Besides single
+	// ticks an agent can park on a cell, holding it from a tick on with no end, which is where it
+	// waits once its plan runs out.
+	class cdReservationTable {
+		public:
+			static constexpr s32 k_NoAgent = -1;
+
+		private:
+			struct cdParking {
+				s32 Agent;
+				u32 FromTime;
+			};
+
+			// What an agent holds, so dropping it does not walk the whole table.
+			struct cdAgentHolds {
+				std::vector<u64> Keys; // Into m_Reservations.
+				s32 ParkedCell = -1;
+			};
+
+			int m_NumCols;
+			std::unordered_map<u64, s32> m_Reservations; // Tick in the high half, cell in the low.
+			std::unordered_map<s32, cdParking> m_Parking; // By cell.
+			std::unordered_map<s32, cdAgentHolds> m_Agents;
+
+		private:
+
+			inline s32 GetCellIndex(const cdGridCoord& cell) const {
+				return cell.Y * m_NumCols + cell.X;
+			}
+
+			inline u64 GetKey(const cdGridCoord& cell, u32 time) const {
+				return (static_cast<u64>(time) << 32) | static_cast<u32>(GetCellIndex(cell));
+			}
+
+		public:
+
+			explicit cdReservationTable(int numCols);
+
+			// False when another agent holds the cell at that tick.
+			bool Reserve(const cdGridCoord& cell, u32 time, s32 agent);
+			// Holds the cell from the tick on. Replaces the agent's previous parking spot.
+			bool Park(const cdGridCoord& cell, u32 fromTime, s32 agent);
+
+			// k_NoAgent when free.
+			s32 GetOwner(const cdGridCoord& cell, u32 time) const;
+
+			inline bool IsFree(const cdGridCoord& cell, u32 time, s32 agent) const {
+				auto owner = GetOwner(cell, time);
+				return owner == k_NoAgent || owner == agent;
+			}
+
+			// True when moving from -> to between time and time + 1 swaps places with another agent.
+			bool IsSwap(const cdGridCoord& from, const cdGridCoord& to, u32 time, s32 agent) const;
+
+			// Drops every tick and the parking spot of the agent.
+			void Release(s32 agent);
+			// Drops ticks before the given one, parking stays.
+			void Purge(u32 beforeTime);
+			void Clear();
+
+			inline size_t GetNumReservations(void) const {
+				return m_Reservations.size();
+			}
+	};
+}
+
+#endif
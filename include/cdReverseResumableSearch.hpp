@@ -0,0 +1,54 @@
+/*!
+ * \file cdReverseResumableSearch.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDREVERSERESUMABLESEARCH_HPP_
+#define _CDREVERSERESUMABLESEARCH_HPP_
+
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+	// Reverse Resumable A* (RRA*). Searches from a goal towards an origin over the static map and
+	// keeps its lists between calls, so asking for the true distance of a cell only resumes the
+	// search until that cell is closed. Used as the exact heuristic of the space-time searches,
+	// which ask for cells near the origin over and over. Steps and costs follow cdFlowField.
+	class cdReverseResumableSearch {
+		private:
+			using cdOpenEntry = std::pair<f32, s32>;
+			using cdOpenQueue = std::priority_queue<cdOpenEntry, std::vector<cdOpenEntry>, std::greater<cdOpenEntry>>;
+
+			const cdGridMap& m_Map;
+			cdGridCoord m_Goal;
+			cdGridCoord m_Origin;
+
+			cdOpenQueue m_Open;
+			std::unordered_map<s32, f32> m_Best;   // Best known distance of open cells.
+			std::unordered_map<s32, f32> m_Closed; // Exact distances.
+			size_t m_NumExpansions;
+
+		private:
+
+			f32 GetOriginHeuristics(const cdGridCoord& cell) const;
+
+		public:
+
+			cdReverseResumableSearch(const cdGridMap& map, const cdGridCoord& goal, const cdGridCoord& origin);
+
+			// Exact cost from the cell to the goal, cdFlowField::k_Unreachable when there is none.
+			f32 GetDistance(const cdGridCoord& cell);
+
+			inline const cdGridCoord& GetGoal(void) const {
+				return m_Goal;
+			}
+
+			inline size_t GetNumExpansions(void) const {
+				return m_NumExpansions;
+			}
+	};
+}
+
+#endif
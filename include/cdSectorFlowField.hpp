@@ -0,0 +1,185 @@
+/*!
+ * \file cdSectorFlowField.hpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#ifndef _CDSECTORFLOWFIELD_HPP_
+#define _CDSECTORFLOWFIELD_HPP_
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "cdAStar.hpp"
+#include "cdFlowField.hpp"
+
+namespace ceed::ai::path {
+	// One connected piece of a sector, the node of the coarse search.
+	struct cdSectorRegion {
+		s32 Sector;
+		s32 Region;
+
+		inline cdSectorRegion()
+		: Sector(-1)
+		, Region(-1) {}
+
+		inline cdSectorRegion(s32 sector, s32 region)
+		: Sector(sector)
+		, Region(region) {}
+
+		inline bool operator ==(const cdSectorRegion& other) const {
+			return Sector == other.Sector && Region == other.Region;
+		}
+	};
+
+	// Square sectors of a cdGridMap, each split into the regions its open cells form when moves
+	// stay inside the sector. Two regions of neighbouring sectors are linked when a GRID step
+	// crosses from one into the other, so a coarse path over regions always has a fine path under
+	// it. Regions are found the first time a sector is looked at.
+	class cdSectorGraph : public cdAStarMap<cdSectorRegion> {
+		public:
+			static constexpr u16 k_NoRegion = 0xFFFF;
+
+		private:
+			struct cdSectorRegions {
+				std::vector<u16> Labels; // Per cell of the sector, k_NoRegion when blocked.
+				int NumRegions;
+			};
+
+			const cdGridMap& m_Map;
+			int m_SectorSize;
+			int m_NumSectorCols;
+			int m_NumSectorRows;
+			std::vector<std::unique_ptr<cdSectorRegions>> m_Sectors;
+
+		private:
+
+			const cdSectorRegions& GetRegions(int sector);
+
+		public:
+
+			cdSectorGraph(const cdGridMap& map, int sectorSize);
+
+			// Forgets every region, for when the map changed.
+			void Clear();
+
+			// Region -1 for blocked cells.
+			cdSectorRegion GetRegion(const cdGridCoord& cell);
+			int GetNumRegions(int sector);
+
+			bool RegionCollides(const cdSectorRegion& region);
+			bool GetRegionSucessorList(const cdAStar<cdSectorRegion>* astar,
+				const cdNode<cdSectorRegion>& current,
+				const cdSectorRegion& start,
+				const std::vector<cdSectorRegion>& end,
+				std::vector<cdSectorRegion>& adjcentList);
+			f32 GetRegionHeuristics(const cdSectorRegion&,
+				const cdSectorRegion&,
+				const std::vector<cdSectorRegion>&);
+			f32 GetRegionMovementCost(const cdSectorRegion&,
+				const cdSectorRegion&);
+
+			inline int GetSectorIndex(const cdGridCoord& cell) const {
+				return (cell.Y / m_SectorSize) * m_NumSectorCols + cell.X / m_SectorSize;
+			}
+
+			inline int GetSectorSize(void) const {
+				return m_SectorSize;
+			}
+
+			inline int GetNumSectors(void) const {
+				return m_NumSectorCols * m_NumSectorRows;
+			}
+
+			inline int GetNumSectorCols(void) const {
+				return m_NumSectorCols;
+			}
+	};
+
+	// Flow fields that are only worked out where agents go. Prepare first finds the chain of sector
+	// regions from the agent to the goal, then integrates fine fields for those sectors alone,
+	// starting at the goal, each one seeded from the fields of its neighbours. Fields are cached per
+	// goal and sector, so later groups heading to the same goal only integrate the sectors their
+	// coarse path adds.
+	//
+	// Distances are costs within the integrated sectors, so they can be above the full map value
+	// of cdFlowField, but following the directions always ends on the goal. Steps and costs are the
+	// ones cdFlowField uses. Editing the map drops every cached field on the next Prepare.
+	class cdSectorFlowField {
+		public:
+			static constexpr int k_DefaultSectorSize = 32;
+
+		private:
+			struct cdSectorField {
+				std::vector<f32> Distance;
+				std::vector<u8> Direction;
+				std::vector<u8> ReachedRegions;
+			};
+
+			const cdGridMap& m_Map;
+			u32 m_MapVersion;
+			cdSectorGraph m_Graph;
+			cdAStar<cdSectorRegion> m_AStar;
+			std::vector<cdSectorRegion> m_SectorPath;
+
+			// Keyed by goal cell index in the high half and sector in the low half.
+			std::unordered_map<u64, std::unique_ptr<cdSectorField>> m_Fields;
+			size_t m_NumIntegrations;
+
+		private:
+
+			void Refresh();
+			void IntegrateSector(const cdGridCoord& goal, int sector, cdSectorField& field);
+			const cdSectorField* FindField(const cdGridCoord& goal, int sector) const;
+
+			inline u64 GetFieldKey(const cdGridCoord& goal, int sector) const {
+				return (static_cast<u64>(goal.Y * m_Map.GetNumCols() + goal.X) << 32) | static_cast<u32>(sector);
+			}
+
+			inline int GetLocalIndex(const cdGridCoord& cell) const {
+				const int size = m_Graph.GetSectorSize();
+				return (cell.Y % size) * size + cell.X % size;
+			}
+
+		public:
+
+			explicit cdSectorFlowField(const cdGridMap& map, int sectorSize = k_DefaultSectorSize);
+
+			cdSectorFlowField(const cdSectorFlowField&) = delete;
+			cdSectorFlowField& operator = (const cdSectorFlowField&) = delete;
+
+			// Makes sure the cells from start to goal have their field. False when either is blocked
+			// or the goal cannot be reached.
+			bool Prepare(const cdGridCoord& start, const cdGridCoord& goal);
+
+			void Clear();
+
+			// cdFlowField::k_Unreachable when the cell's sector has no field for the goal yet.
+			f32 GetDistance(const cdGridCoord& cell, const cdGridCoord& goal) const;
+			// cdFlowField::k_NoDirection on the goal and cells without a field.
+			u8 GetDirection(const cdGridCoord& cell, const cdGridCoord& goal) const;
+
+			// The cell itself when there is nowhere to go.
+			inline cdGridCoord GetNextCell(const cdGridCoord& cell, const cdGridCoord& goal) const {
+				auto dir = GetDirection(cell, goal);
+				if (dir == cdFlowField::k_NoDirection) {
+					return cell;
+				}
+				return cdGridCoord(cell.X + k_GridDirections[dir].X, cell.Y + k_GridDirections[dir].Y);
+			}
+
+			inline size_t GetNumCachedSectors(void) const {
+				return m_Fields.size();
+			}
+
+			// Sector integrations since construction.
+			inline size_t GetNumIntegrations(void) const {
+				return m_NumIntegrations;
+			}
+
+			inline const cdSectorGraph& GetGraph(void) const {
+				return m_Graph;
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,247 @@
+/*!
+ * \file cdChunkedGridMap.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#include <assert.h>
+#include <bit>
+#include <string.h>
+
+#include "cdChunkedGridMap.hpp"
+#include "cdMapFile.hpp"
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdChunkedGridMap::cdChunkedGridMap(std::shared_ptr<const cdMapFile> file, int chunkSize, size_t memoryBudget)
+		: cdAStarMap<cdGridCoord>(fastdelegate::MakeDelegate(this, &cdChunkedGridMap::CellCollides)
+		, fastdelegate::MakeDelegate(this, &cdChunkedGridMap::GetGridSucessorList)
+		, fastdelegate::MakeDelegate(this, &cdChunkedGridMap::GetHeuristics)
+		, fastdelegate::MakeDelegate(this, &cdChunkedGridMap::GetMovementCost), 0)
+		, m_File(std::move(file))
+		, m_FileOccupancy(nullptr)
+		, m_FileThreat(nullptr)
+		, m_NumCols(cdMapFile::GetOpenHeader(m_File.get()).NumCols)
+		, m_NumRows(cdMapFile::GetOpenHeader(m_File.get()).NumRows)
+		, m_ChunkSize(static_cast<int>(std::bit_ceil(static_cast<unsigned>(std::max(chunkSize, 64)))))
+		, m_ChunkShift(std::countr_zero(static_cast<unsigned>(m_ChunkSize)))
+		, m_ChunkWords(m_ChunkSize / 64)
+		, m_NumChunksX((m_NumCols + m_ChunkSize - 1) / m_ChunkSize)
+		, m_NumChunksY((m_NumRows + m_ChunkSize - 1) / m_ChunkSize)
+		, m_MemoryBudget(0)
+		, m_MaxResidentChunks(0)
+		, m_LastChunkIdx(-1)
+		, m_LastSlot(-1)
+		, m_NumLoads(0)
+		, m_NumEvictions(0)
+		, m_CornerRule(cdCornerRule::ALWAYS)
+		, m_CostMode(cdCostMode::DISTANCE)
+		, m_ThreatWeight(1.0f) {
+		// A missing or closed file leaves the map empty, every cell is off it.
+		assert(m_File != nullptr && m_File->IsOpen());
+
+		size_t size = 0;
+		if (m_File != nullptr) {
+			m_FileOccupancy = static_cast<const u64*>(m_File->GetSection(cdMapFile::SECTION_OCCUPANCY, size));
+			m_FileThreat = static_cast<const u8*>(m_File->GetSection(cdMapFile::SECTION_THREAT, size));
+		}
+		m_FileStride = (m_NumCols + 63) / 64;
+
+		m_ChunkSlots.assign(static_cast<size_t>(m_NumChunksX) * m_NumChunksY, -1);
+		SetMemoryBudget(memoryBudget);
+		BuildThreatCostTable();
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdChunkedGridMap::BuildThreatCostTable() {
+		const auto scale = cdMapFile::GetOpenHeader(m_File.get()).ThreatScale;
+		for (int i = 0; i < 256; ++i) {
+			m_ThreatCostTable[i] = 1.0f + m_ThreatWeight * scale * (static_cast<f32>(i) / 255.0f);
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdChunkedGridMap::SetThreatWeight(f32 weight) {
+		m_ThreatWeight = weight;
+		BuildThreatCostTable();
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdChunkedGridMap::SetMemoryBudget(size_t bytes) {
+		m_MemoryBudget = bytes;
+		m_MaxResidentChunks = std::max(bytes / GetChunkBytes(), k_MinResidentChunks);
+
+		while (m_Chunks.size() > m_MaxResidentChunks) {
+			const s32 oldest = m_Lru.back();
+			EvictChunk(oldest);
+			m_Lru.pop_back();
+
+			// Fill the hole with the last chunk so the slots stay packed.
+			auto last = static_cast<s32>(m_Chunks.size()) - 1;
+			if (oldest != last) {
+				m_Chunks[oldest] = std::move(m_Chunks[last]);
+				m_ChunkSlots[m_Chunks[oldest].ChunkIdx] = oldest;
+				*m_Chunks[oldest].LruPos = oldest;
+			}
+			m_Chunks.pop_back();
+		}
+		m_LastChunkIdx = -1;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdChunkedGridMap::EvictChunk(s32 slot) {
+		auto& chunk = m_Chunks[slot];
+		m_ChunkSlots[chunk.ChunkIdx] = -1;
+		if (chunk.ChunkIdx == m_LastChunkIdx) {
+			m_LastChunkIdx = -1;
+		}
+		chunk.ChunkIdx = -1;
+		++m_NumEvictions;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	s32 cdChunkedGridMap::LoadChunk(s32 chunkIdx) {
+		s32 slot;
+		if (m_Chunks.size() < m_MaxResidentChunks) {
+			slot = static_cast<s32>(m_Chunks.size());
+			m_Chunks.emplace_back();
+			m_Chunks[slot].Occupancy.resize(static_cast<size_t>(m_ChunkSize) * m_ChunkWords);
+			m_Chunks[slot].Threat.resize(static_cast<size_t>(m_ChunkSize) * m_ChunkSize);
+			m_Lru.push_front(slot);
+			m_Chunks[slot].LruPos = m_Lru.begin();
+		} else {
+			slot = m_Lru.back();
+			EvictChunk(slot);
+		}
+
+		auto& chunk = m_Chunks[slot];
+		chunk.ChunkIdx = chunkIdx;
+		m_ChunkSlots[chunkIdx] = slot;
+		++m_NumLoads;
+
+		const int x0 = (chunkIdx % m_NumChunksX) << m_ChunkShift;
+		const int y0 = (chunkIdx / m_NumChunksX) << m_ChunkShift;
+		const int firstWord = x0 >> 6;
+		const int numWords = std::min(m_ChunkWords, m_FileStride - firstWord);
+		const int numCols = std::min(m_ChunkSize, m_NumCols - x0);
+
+		for (int row = 0; row < m_ChunkSize; ++row) {
+			auto occupancy = chunk.Occupancy.data() + static_cast<size_t>(row) * m_ChunkWords;
+			auto threat = chunk.Threat.data() + static_cast<size_t>(row) * m_ChunkSize;
+			const int y = y0 + row;
+
+			// Past the edge of the world is blocked.
+			if (y >= m_NumRows) {
+				std::fill(occupancy, occupancy + m_ChunkWords, ~u64(0));
+				std::fill(threat, threat + m_ChunkSize, u8(0));
+				continue;
+			}
+
+			memcpy(occupancy, m_FileOccupancy + static_cast<size_t>(y) * m_FileStride + firstWord,
+				numWords * sizeof(u64));
+			std::fill(occupancy + numWords, occupancy + m_ChunkWords, ~u64(0));
+			memcpy(threat, m_FileThreat + static_cast<size_t>(y) * m_NumCols + x0, numCols);
+			std::fill(threat + numCols, threat + m_ChunkSize, u8(0));
+		}
+
+		return slot;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	const cdMapChunk& cdChunkedGridMap::GetChunk(int chunkX, int chunkY) {
+		const s32 chunkIdx = chunkY * m_NumChunksX + chunkX;
+		if (chunkIdx == m_LastChunkIdx) {
+			return m_Chunks[m_LastSlot];
+		}
+
+		auto slot = m_ChunkSlots[chunkIdx];
+		if (slot < 0) {
+			slot = LoadChunk(chunkIdx);
+		}
+
+		m_Lru.splice(m_Lru.begin(), m_Lru, m_Chunks[slot].LruPos);
+		m_LastChunkIdx = chunkIdx;
+		m_LastSlot = slot;
+		return m_Chunks[slot];
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdChunkedGridMap::IsBlocked(int x, int y) {
+		const auto& chunk = GetChunk(x >> m_ChunkShift, y >> m_ChunkShift);
+		const int localX = x & (m_ChunkSize - 1);
+		const int localY = y & (m_ChunkSize - 1);
+		return ((chunk.Occupancy[localY * m_ChunkWords + (localX >> 6)] >> (localX & 63)) & 1) != 0;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdChunkedGridMap::CellCollides(const cdGridCoord& cell) {
+		if (cell.X < 0 || cell.Y < 0 || cell.X >= m_NumCols || cell.Y >= m_NumRows) {
+			return true;
+		}
+		return IsBlocked(cell.X, cell.Y);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	u8 cdChunkedGridMap::GetQuantizedThreat(const cdGridCoord& cell) {
+		const auto& chunk = GetChunk(cell.X >> m_ChunkShift, cell.Y >> m_ChunkShift);
+		const int localX = cell.X & (m_ChunkSize - 1);
+		const int localY = cell.Y & (m_ChunkSize - 1);
+		return chunk.Threat[localY * m_ChunkSize + localX];
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f32 cdChunkedGridMap::GetHeuristics(const cdGridCoord& cell1,
+		const cdGridCoord& cell2, const std::vector<cdGridCoord>& cellList) {
+		return GetOctileHeuristics(m_TieType, cell1, cell2, cellList);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f32 cdChunkedGridMap::GetMovementCost(const cdGridCoord& c1, const cdGridCoord& c2) {
+		f32 distance = GetGridStepLength(GetGridDirectionIndex(c2.X - c1.X, c2.Y - c1.Y));
+
+		if (m_CostMode == cdCostMode::THREAT_WEIGHTED) {
+			distance *= m_ThreatCostTable[GetQuantizedThreat(c2)];
+		}
+
+		return distance;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdChunkedGridMap::GetGridSucessorList(const cdAStar<cdGridCoord>* astar,
+		const cdNode<cdGridCoord>& current,
+		const cdGridCoord& start,
+		const std::vector<cdGridCoord>& end,
+		std::vector<cdGridCoord>& adjcentList) {
+		const auto& pos = current.NodePos;
+
+		u8 mask = 0;
+		for (int dir = 0; dir < 8; ++dir) {
+			if (CellCollides(cdGridCoord(pos.X + k_GridDirections[dir].X, pos.Y + k_GridDirections[dir].Y)) == false) {
+				mask |= static_cast<u8>(1u << dir);
+			}
+		}
+
+		unsigned moves = GetAllowedMoves(mask, m_CornerRule);
+		while (moves != 0) {
+			auto dir = std::countr_zero(moves);
+			moves &= moves - 1;
+			adjcentList.push_back(cdGridCoord(pos.X + k_GridDirections[dir].X, pos.Y + k_GridDirections[dir].Y));
+		}
+
+		return adjcentList.empty() == false;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
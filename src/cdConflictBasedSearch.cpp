@@ -0,0 +1,401 @@
+/*!
+ * \file cdConflictBasedSearch.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <thread>
+
+#include "cdConflictBasedSearch.hpp"
+
+namespace ceed::ai::path {
+	namespace {
+		u32 GetStepIndex(const cdGridCoord& from, const cdGridCoord& to) {
+			for (u32 dir = 0; dir < 8; ++dir) {
+				if (from.X + k_GridDirections[dir].X == to.X && from.Y + k_GridDirections[dir].Y == to.Y) {
+					return dir;
+				}
+			}
+			return 0;
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdConstrainedGridMap::cdConstrainedGridMap(const cdGridMap& map)
+		: cdAStarMap<cdSpaceTimeCoord>(fastdelegate::MakeDelegate(this, &cdConstrainedGridMap::SpaceTimeCollides)
+		, fastdelegate::MakeDelegate(this, &cdConstrainedGridMap::GetSpaceTimeSucessorList)
+		, fastdelegate::MakeDelegate(this, &cdConstrainedGridMap::GetSpaceTimeHeuristics)
+		, fastdelegate::MakeDelegate(this, &cdConstrainedGridMap::GetSpaceTimeMovementCost), 0)
+		, m_Map(map)
+		, m_Field(nullptr)
+		, m_LastGoalTime(-1)
+		, m_TimeCap(1) {
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdConstrainedGridMap::SetConstraints(s32 agent, const cdGridCoord& goal, const cdFlowField& field,
+		const std::vector<cdCbsConstraint>& constraints) {
+		m_Field = &field;
+		m_Goal = goal;
+		m_Vertices.clear();
+		m_Edges.clear();
+		m_LastGoalTime = -1;
+		m_TimeCap = 1;
+
+		for (const auto& constraint : constraints) {
+			if (constraint.Agent != agent) {
+				continue;
+			}
+
+			m_TimeCap = std::max(m_TimeCap, constraint.Time + 1);
+			if (constraint.IsEdge) {
+				m_Edges.insert({ constraint.Time, GetCellIndex(constraint.Cell),
+					GetStepIndex(constraint.From, constraint.Cell) });
+			} else {
+				m_Vertices.insert(GetKey(constraint.Cell, constraint.Time));
+				if (constraint.Cell == goal) {
+					m_LastGoalTime = std::max(m_LastGoalTime, constraint.Time);
+				}
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdConstrainedGridMap::SpaceTimeCollides(const cdSpaceTimeCoord& node) {
+		return node.Time != k_Arrived && m_Map.CellCollides(cdGridCoord(node.X, node.Y));
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdConstrainedGridMap::GetSpaceTimeSucessorList(const cdAStar<cdSpaceTimeCoord>*,
+		const cdNode<cdSpaceTimeCoord>& current,
+		const cdSpaceTimeCoord&,
+		const std::vector<cdSpaceTimeCoord>&,
+		std::vector<cdSpaceTimeCoord>& adjcentList) {
+		const auto& node = current.NodePos;
+		cdGridCoord cell(node.X, node.Y);
+		if (cell == m_Goal && node.Time > m_LastGoalTime) {
+			adjcentList.push_back(GetArrivedNode());
+		}
+
+		// Constraints are checked on the true tick, which only differs once past all of them.
+		const s32 time = node.Time + 1;
+		const s32 nextTime = std::min(time, m_TimeCap);
+		if (m_Vertices.count(GetKey(cell, time)) == 0) {
+			adjcentList.push_back(cdSpaceTimeCoord(cell.X, cell.Y, nextTime));
+		}
+
+		unsigned moves = m_Map.GetCellMoves(cell);
+		while (moves != 0) {
+			auto dir = std::countr_zero(moves);
+			moves &= moves - 1;
+			cdGridCoord next(cell.X + k_GridDirections[dir].X, cell.Y + k_GridDirections[dir].Y);
+			if (m_Vertices.count(GetKey(next, time)) != 0 ||
+				m_Edges.count({ time, GetCellIndex(next), static_cast<u32>(dir) }) != 0) {
+				continue;
+			}
+			adjcentList.push_back(cdSpaceTimeCoord(next.X, next.Y, nextTime));
+		}
+
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f32 cdConstrainedGridMap::GetSpaceTimeHeuristics(const cdSpaceTimeCoord& node,
+		const cdSpaceTimeCoord&,
+		const std::vector<cdSpaceTimeCoord>&) {
+		return node.Time == k_Arrived ? 0.0f : m_Field->GetDistance(cdGridCoord(node.X, node.Y));
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f32 cdConstrainedGridMap::GetSpaceTimeMovementCost(const cdSpaceTimeCoord& from,
+		const cdSpaceTimeCoord& to) {
+		if (to.Time == k_Arrived) {
+			return 0.0f;
+		}
+		if (from.X == to.X && from.Y == to.Y) {
+			return 1.0f;
+		}
+
+		return m_Map.GetStepCost(GetGridDirectionIndex(to.X - from.X, to.Y - from.Y), cdGridCoord(to.X, to.Y));
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdConflictBasedSearch::cdConflictBasedSearch(const cdGridMap& map, int numThreads)
+		: m_Map(map)
+		, m_MaxNodes(k_DefaultMaxNodes)
+		, m_Solution(-1)
+		, m_Optimal(false)
+		, m_NumLowLevelSearches(0) {
+		for (int i = 0; i < std::max(numThreads, 1); ++i) {
+			m_Workers.push_back(std::make_unique<cdCbsWorker>(map));
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdConflictBasedSearch::PlanAgent(cdCbsWorker& worker, s32 nodeIdx, s32 agent,
+		std::shared_ptr<const cdCbsPath>& path) {
+		worker.Constraints.clear();
+		for (auto idx = nodeIdx; m_Nodes[idx]->Parent >= 0; idx = m_Nodes[idx]->Parent) {
+			if (m_Nodes[idx]->Constraint.Agent == agent) {
+				worker.Constraints.push_back(m_Nodes[idx]->Constraint);
+			}
+		}
+		worker.Map.SetConstraints(agent, m_Goals[agent], *m_Fields[agent], worker.Constraints);
+
+		// Comes back goal first, from the arrival node.
+		worker.Path.clear();
+		const auto& start = m_Starts[agent];
+		if (worker.AStar.FindPath(cdSpaceTimeCoord(start.X, start.Y, 0), worker.Map.GetArrivedNode(),
+			&worker.Map, worker.Path) == false) {
+			return false;
+		}
+
+		auto result = std::make_shared<cdCbsPath>();
+		result->Cost = 0.0f;
+		for (auto i = worker.Path.rbegin(); i + 1 != worker.Path.rend(); ++i) {
+			if (i != worker.Path.rbegin()) {
+				result->Cost += worker.Map.GetSpaceTimeMovementCost(*(i - 1), *i);
+			}
+			result->Cells.push_back(cdGridCoord(i->X, i->Y));
+		}
+		path = std::move(result);
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdConflictBasedSearch::RunJobs(std::vector<cdCbsJob>& jobs) {
+		m_NumLowLevelSearches += jobs.size();
+		auto runJob = [this](cdCbsWorker& worker, cdCbsJob& job) {
+			job.Found = PlanAgent(worker, job.Node, job.Agent, m_Nodes[job.Node]->Paths[job.Agent]);
+		};
+
+		const size_t numThreads = std::min(m_Workers.size(), jobs.size());
+		if (numThreads <= 1) {
+			for (auto& job : jobs) {
+				runJob(*m_Workers[0], job);
+			}
+			return;
+		}
+
+		// Jobs only read the tree above their node and write their own path.
+		std::atomic<size_t> nextJob = 0;
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < numThreads; ++i) {
+			threads.emplace_back([&, i]() {
+				for (auto jobIdx = nextJob++; jobIdx < jobs.size(); jobIdx = nextJob++) {
+					runJob(*m_Workers[i], jobs[jobIdx]);
+				}
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdConflictBasedSearch::FindConflict(const cdCbsNode& node, cdCbsConstraint& first,
+		cdCbsConstraint& second) const {
+		size_t length = 0;
+		for (const auto& path : node.Paths) {
+			length = std::max(length, path->Cells.size());
+		}
+
+		const auto numAgents = static_cast<s32>(node.Paths.size());
+		for (size_t time = 0; time < length; ++time) {
+			for (s32 a = 0; a < numAgents; ++a) {
+				const auto& cellA = GetCell(*node.Paths[a], time);
+				for (s32 b = a + 1; b < numAgents; ++b) {
+					const auto& cellB = GetCell(*node.Paths[b], time);
+					if (cellA == cellB) {
+						first = { a, cellA, cellA, static_cast<s32>(time), false };
+						second = { b, cellB, cellB, static_cast<s32>(time), false };
+						return true;
+					}
+
+					if (time == 0) {
+						continue;
+					}
+					const auto& fromA = GetCell(*node.Paths[a], time - 1);
+					const auto& fromB = GetCell(*node.Paths[b], time - 1);
+					if (fromA != cellA && fromA == cellB && fromB == cellA) {
+						first = { a, cellA, fromA, static_cast<s32>(time), true };
+						second = { b, cellB, fromB, static_cast<s32>(time), true };
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	s32 cdConflictBasedSearch::CountConflicts(const cdCbsNode& node) const {
+		const auto numAgents = static_cast<s32>(node.Paths.size());
+		s32 numConflicts = 0;
+		for (s32 a = 0; a < numAgents; ++a) {
+			const auto& pathA = *node.Paths[a];
+			for (s32 b = a + 1; b < numAgents; ++b) {
+				const auto& pathB = *node.Paths[b];
+				const size_t length = std::max(pathA.Cells.size(), pathB.Cells.size());
+				for (size_t time = 0; time < length; ++time) {
+					const auto& cellA = GetCell(pathA, time);
+					const auto& cellB = GetCell(pathB, time);
+					if (cellA == cellB || (time > 0 && cellA != cellB &&
+						GetCell(pathA, time - 1) == cellB && GetCell(pathB, time - 1) == cellA)) {
+						++numConflicts;
+						break;
+					}
+				}
+			}
+		}
+		return numConflicts;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdConflictBasedSearch::Solve(const std::vector<cdGridCoord>& starts, const std::vector<cdGridCoord>& goals,
+		f64 budget, f32 suboptimality) {
+		auto begin = std::chrono::steady_clock::now();
+		m_Nodes.clear();
+		m_Open.clear();
+		m_Solution = -1;
+		m_Optimal = false;
+		m_NumLowLevelSearches = 0;
+		if (starts.size() != goals.size() || starts.empty()) {
+			return false;
+		}
+
+		// Two agents can never share a start, nor both stay on one goal.
+		const auto numAgents = static_cast<s32>(starts.size());
+		for (s32 a = 0; a < numAgents; ++a) {
+			for (s32 b = a + 1; b < numAgents; ++b) {
+				if (starts[a] == starts[b] || goals[a] == goals[b]) {
+					return false;
+				}
+			}
+		}
+
+		m_Starts = starts;
+		m_Goals = goals;
+		m_Fields.resize(numAgents);
+		for (s32 agent = 0; agent < numAgents; ++agent) {
+			if (m_Fields[agent] == nullptr) {
+				m_Fields[agent] = std::make_unique<cdFlowField>();
+			}
+			if (m_Fields[agent]->Build(m_Map, { goals[agent] }) == false ||
+				m_Map.CellCollides(starts[agent]) || m_Fields[agent]->IsReachable(starts[agent]) == false) {
+				return false;
+			}
+		}
+
+		auto root = std::make_unique<cdCbsNode>();
+		root->Parent = -1;
+		root->Paths.resize(numAgents);
+		m_Nodes.push_back(std::move(root));
+
+		std::vector<cdCbsJob> jobs;
+		for (s32 agent = 0; agent < numAgents; ++agent) {
+			jobs.push_back({ 0, agent, false });
+		}
+		RunJobs(jobs);
+		for (const auto& job : jobs) {
+			if (job.Found == false) {
+				return false;
+			}
+		}
+
+		m_Nodes[0]->Cost = 0.0f;
+		for (const auto& path : m_Nodes[0]->Paths) {
+			m_Nodes[0]->Cost += path->Cost;
+		}
+		m_Nodes[0]->NumConflicts = CountConflicts(*m_Nodes[0]);
+		m_Open.insert({ m_Nodes[0]->Cost, 0 });
+
+		const size_t batchSize = std::max<size_t>(1, (m_Workers.size() + 1) / 2);
+		std::vector<s32> batch;
+		while (m_Open.empty() == false && m_Nodes.size() < m_MaxNodes) {
+			const f32 lowerBound = m_Open.begin()->first;
+			auto elapsed = std::chrono::duration<f64, std::micro>(std::chrono::steady_clock::now() - begin).count();
+
+			batch.clear();
+			if (elapsed < budget) {
+				// Cheapest first, the head is the answer once it has no conflicts.
+				while (batch.size() < batchSize && m_Open.empty() == false) {
+					batch.push_back(m_Open.begin()->second);
+					m_Open.erase(m_Open.begin());
+				}
+				if (m_Nodes[batch[0]]->NumConflicts == 0) {
+					m_Solution = batch[0];
+					m_Optimal = true;
+					return true;
+				}
+			} else {
+				// Focal list, everything within the bound by fewest conflicts.
+				std::vector<std::pair<s32, s32>> focal;
+				const f32 bound = lowerBound * suboptimality;
+				for (auto i = m_Open.begin(); i != m_Open.end() && i->first <= bound; ++i) {
+					focal.push_back({ m_Nodes[i->second]->NumConflicts, i->second });
+				}
+				const auto count = std::min(batchSize, focal.size());
+				std::partial_sort(focal.begin(), focal.begin() + count, focal.end());
+				for (size_t i = 0; i < count; ++i) {
+					batch.push_back(focal[i].second);
+					m_Open.erase({ m_Nodes[focal[i].second]->Cost, focal[i].second });
+				}
+				if (m_Nodes[batch[0]]->NumConflicts == 0) {
+					m_Solution = batch[0];
+					m_Optimal = m_Nodes[batch[0]]->Cost <= lowerBound;
+					return true;
+				}
+			}
+
+			jobs.clear();
+			for (auto nodeIdx : batch) {
+				const auto& node = *m_Nodes[nodeIdx];
+				cdCbsConstraint constraints[2];
+				if (FindConflict(node, constraints[0], constraints[1]) == false) {
+					m_Open.insert({ node.Cost, nodeIdx });
+					continue;
+				}
+
+				for (const auto& constraint : constraints) {
+					auto child = std::make_unique<cdCbsNode>();
+					child->Parent = nodeIdx;
+					child->Constraint = constraint;
+					child->Paths = node.Paths;
+					jobs.push_back({ static_cast<s32>(m_Nodes.size()), constraint.Agent, false });
+					m_Nodes.push_back(std::move(child));
+				}
+			}
+			RunJobs(jobs);
+
+			for (const auto& job : jobs) {
+				if (job.Found == false) {
+					continue;
+				}
+				auto& child = *m_Nodes[job.Node];
+				const auto& parent = *m_Nodes[child.Parent];
+				child.Cost = parent.Cost - parent.Paths[job.Agent]->Cost + child.Paths[job.Agent]->Cost;
+				child.NumConflicts = CountConflicts(child);
+				m_Open.insert({ child.Cost, job.Node });
+			}
+		}
+
+		return false;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
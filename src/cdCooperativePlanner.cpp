@@ -0,0 +1,211 @@
+/*!
+ * \file cdCooperativePlanner.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#include <algorithm>
+#include <bit>
+#include <chrono>
+
+#include "cdCooperativePlanner.hpp"
+#include "cdFlowField.hpp"
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdCooperativePlanner::cdCooperativePlanner(const cdGridMap& map, int window)
+		: m_Map(map)
+		, m_MapVersion(map.GetVersion())
+		, m_Window(std::max(window, 2))
+		, m_Time(0)
+		, m_Reservations(map.GetNumCols())
+		, m_NextAgent(0)
+		, m_NumReplans(0)
+		, m_NumExpansions(0) {
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	s32 cdCooperativePlanner::AddAgent(const cdGridCoord& position, const cdGridCoord& goal) {
+		if (m_Map.CellCollides(position)) {
+			return -1;
+		}
+
+		// Nobody may hold the cell now or plan to within the window.
+		const auto agentIdx = static_cast<s32>(m_Agents.size());
+		for (u32 time = m_Time; time <= m_Time + m_Window; ++time) {
+			if (m_Reservations.IsFree(position, time, agentIdx) == false) {
+				return -1;
+			}
+		}
+		if (m_Reservations.Park(position, m_Time, agentIdx) == false) {
+			return -1;
+		}
+
+		m_Agents.push_back({ position, goal, {}, 0, true });
+		return agentIdx;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdCooperativePlanner::SetGoal(s32 agent, const cdGridCoord& goal) {
+		m_Agents[agent].Goal = goal;
+		m_Agents[agent].NeedsPlan = true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdReverseResumableSearch& cdCooperativePlanner::GetHeuristics(const cdAgent& agent) {
+		auto& search = m_Heuristics[agent.Goal.Y * m_Map.GetNumCols() + agent.Goal.X];
+		if (search == nullptr) {
+			search = std::make_unique<cdReverseResumableSearch>(m_Map, agent.Goal, agent.Position);
+		}
+		return *search;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdCooperativePlanner::PlanAgent(s32 agentIdx) {
+		auto& agent = m_Agents[agentIdx];
+		m_Reservations.Release(agentIdx);
+		agent.Plan.clear();
+		agent.PlanStep = 0;
+		agent.NeedsPlan = false;
+		++m_NumReplans;
+
+		// The rest of the old plan followed by waiting on its last cell is still free, everyone else
+		// planned around it, so the search always reaches the end of the window. With no way to the
+		// goal the agent only keeps out of the way.
+		auto& heuristics = GetHeuristics(agent);
+		const bool goalReachable = heuristics.GetDistance(agent.Position) != cdFlowField::k_Unreachable;
+
+		const int numCols = m_Map.GetNumCols();
+		m_Nodes.clear();
+		m_Visited.clear();
+		m_Open = cdOpenQueue();
+
+		m_Nodes.push_back({ agent.Position, -1, 0.0f, 0 });
+		m_Open.push({ 0.0f, 0 });
+
+		s32 found = -1;
+		while (m_Open.empty() == false) {
+			const auto nodeIdx = m_Open.top().second;
+			m_Open.pop();
+			const auto node = m_Nodes[nodeIdx];
+			++m_NumExpansions;
+
+			if (node.Step == m_Window) {
+				found = nodeIdx;
+				break;
+			}
+
+			const u32 time = m_Time + static_cast<u32>(node.Step);
+			auto tryCell = [&](const cdGridCoord& next, f32 cost) {
+				if (m_Reservations.IsFree(next, time + 1, agentIdx) == false ||
+					(next != node.Cell && m_Reservations.IsSwap(node.Cell, next, time, agentIdx))) {
+					return;
+				}
+
+				const f32 h = goalReachable ? heuristics.GetDistance(next) : 0.0f;
+				if (h == cdFlowField::k_Unreachable) {
+					return;
+				}
+
+				const f32 g = node.GValue + cost;
+				const u64 key = (static_cast<u64>(node.Step + 1) << 32) | static_cast<u32>(next.Y * numCols + next.X);
+				auto visited = m_Visited.find(key);
+				if (visited != m_Visited.end() && visited->second <= g) {
+					return;
+				}
+				m_Visited[key] = g;
+
+				m_Nodes.push_back({ next, nodeIdx, g, node.Step + 1 });
+				m_Open.push({ g + h, static_cast<s32>(m_Nodes.size()) - 1 });
+			};
+
+			tryCell(node.Cell, node.Cell == agent.Goal ? 0.0f : 1.0f);
+
+			unsigned moves = m_Map.GetCellMoves(node.Cell);
+			while (moves != 0) {
+				auto dir = std::countr_zero(moves);
+				moves &= moves - 1;
+				cdGridCoord next(node.Cell.X + k_GridDirections[dir].X, node.Cell.Y + k_GridDirections[dir].Y);
+				tryCell(next, m_Map.GetStepCost(dir, next));
+			}
+		}
+
+		if (found >= 0) {
+			agent.Plan.resize(m_Window);
+			for (auto nodeIdx = found; m_Nodes[nodeIdx].Parent >= 0; nodeIdx = m_Nodes[nodeIdx].Parent) {
+				agent.Plan[m_Nodes[nodeIdx].Step - 1] = m_Nodes[nodeIdx].Cell;
+			}
+		}
+
+		ReservePlan(agentIdx);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdCooperativePlanner::ReservePlan(s32 agentIdx) {
+		const auto& agent = m_Agents[agentIdx];
+		m_Reservations.Reserve(agent.Position, m_Time, agentIdx);
+		for (size_t i = 0; i < agent.Plan.size(); ++i) {
+			m_Reservations.Reserve(agent.Plan[i], m_Time + static_cast<u32>(i) + 1, agentIdx);
+		}
+
+		const auto& last = agent.Plan.empty() ? agent.Position : agent.Plan.back();
+		m_Reservations.Park(last, m_Time + static_cast<u32>(agent.Plan.size()), agentIdx);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	size_t cdCooperativePlanner::Update(f64 budget) {
+		// Distances from before an edit are no good as heuristics.
+		if (m_Map.GetVersion() != m_MapVersion) {
+			m_MapVersion = m_Map.GetVersion();
+			m_Heuristics.clear();
+			for (auto& agent : m_Agents) {
+				agent.NeedsPlan = true;
+			}
+		}
+
+		if (m_Agents.empty()) {
+			return 0;
+		}
+
+		auto begin = std::chrono::steady_clock::now();
+		size_t planned = 0;
+		const size_t numAgents = m_Agents.size();
+		for (size_t i = 0; i < numAgents; ++i) {
+			const auto agentIdx = (m_NextAgent + i) % numAgents;
+			if (NeedsPlan(m_Agents[agentIdx]) == false) {
+				continue;
+			}
+
+			PlanAgent(static_cast<s32>(agentIdx));
+			++planned;
+
+			auto elapsed = std::chrono::duration<f64, std::micro>(std::chrono::steady_clock::now() - begin).count();
+			if (elapsed >= budget) {
+				m_NextAgent = agentIdx + 1;
+				return planned;
+			}
+		}
+
+		return planned;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdCooperativePlanner::Step() {
+		++m_Time;
+		for (auto& agent : m_Agents) {
+			if (agent.PlanStep < agent.Plan.size()) {
+				agent.Position = agent.Plan[agent.PlanStep++];
+			}
+		}
+		m_Reservations.Purge(m_Time);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
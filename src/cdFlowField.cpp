@@ -0,0 +1,327 @@
+/*!
+ * \file cdFlowField.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <bit>
+#include <functional>
+#include <queue>
+#include <thread>
+
+#include "cdFlowField.hpp"
+
+namespace {
+using cdOpenEntry = std::pair<f32, s32>;
+
+// Min heap on distance. Entries are not updated in place, stale ones are skipped when popped.
+struct cdOpenQueue : std::priority_queue<cdOpenEntry, std::vector<cdOpenEntry>, std::greater<cdOpenEntry>> {
+    inline void Reset() {
+        c.clear();
+    }
+};
+}
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdFlowField::cdFlowField()
+		: m_NumCols(0)
+		, m_NumRows(0)
+		, m_NumTileCols(0)
+		, m_NumTileRows(0)
+		, m_DiagonalStepLength(GetGridStepLength(4))
+		, m_NumTileRuns(0) {
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdFlowField::PrepareCells(const cdGridMap& map) {
+		m_NumCols = map.GetNumCols();
+		m_NumRows = map.GetNumRows();
+		m_DiagonalStepLength = map.GetDiagonalStepLength();
+		const size_t numCells = static_cast<size_t>(m_NumCols) * m_NumRows;
+
+		m_Distance.assign(numCells, k_Unreachable);
+		m_Direction.assign(numCells, k_NoDirection);
+		m_Moves.resize(numCells);
+		m_EnterCost.resize(numCells);
+
+		for (int y = 0; y < m_NumRows; ++y) {
+			for (int x = 0; x < m_NumCols; ++x) {
+				cdGridCoord cell(x, y);
+				const auto idx = y * m_NumCols + x;
+				m_EnterCost[idx] = map.GetEnterCost(cell);
+				m_Moves[idx] = map.CellCollides(cell) ? 0 : map.GetCellMoves(cell);
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdFlowField::SeedGoals(const cdGridMap& map, const std::vector<cdGridCoord>& goals) {
+		bool seeded = false;
+		for (const auto& goal : goals) {
+			if (map.CellCollides(goal)) {
+				continue;
+			}
+
+			m_Distance[goal.Y * m_NumCols + goal.X] = 0.0f;
+			seeded = true;
+		}
+		return seeded;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdFlowField::RelaxRegion(int x0, int y0, int x1, int y1, bool seedAll, bool seedFromRing) {
+		// Per thread so tiles can run side by side.
+		thread_local cdOpenQueue open;
+		open.Reset();
+
+		bool borderChanged = false;
+		auto isBorder = [x0, y0, x1, y1](int x, int y) {
+			return x == x0 || y == y0 || x == x1 - 1 || y == y1 - 1;
+		};
+
+		if (seedAll) {
+			for (int y = y0; y < y1; ++y) {
+				for (int x = x0; x < x1; ++x) {
+					const auto idx = y * m_NumCols + x;
+					if (m_Distance[idx] != k_Unreachable) {
+						open.push({ m_Distance[idx], idx });
+						borderChanged |= isBorder(x, y);
+					}
+				}
+			}
+		}
+
+		// Pull in what the neighbouring tiles found since this one last ran.
+		auto relaxFromRing = [&](int x, int y) {
+			const auto idx = y * m_NumCols + x;
+			unsigned moves = m_Moves[idx];
+			while (moves != 0) {
+				auto dir = std::countr_zero(moves);
+				moves &= moves - 1;
+				const int nx = x + k_GridDirections[dir].X;
+				const int ny = y + k_GridDirections[dir].Y;
+				const auto nIdx = ny * m_NumCols + nx;
+				if ((nx >= x0 && ny >= y0 && nx < x1 && ny < y1) || m_Distance[nIdx] == k_Unreachable) {
+					continue;
+				}
+
+				const f32 distance = m_Distance[nIdx] + GetStepCost(dir, nIdx);
+				if (distance < m_Distance[idx]) {
+					m_Distance[idx] = distance;
+					open.push({ distance, idx });
+					borderChanged = true;
+				}
+			}
+		};
+
+		if (seedFromRing) {
+			for (int y = y0; y < y1; ++y) {
+				const int step = (y == y0 || y == y1 - 1) ? 1 : std::max(x1 - 1 - x0, 1);
+				for (int x = x0; x < x1; x += step) {
+					relaxFromRing(x, y);
+				}
+			}
+		}
+
+		while (open.empty() == false) {
+			const auto [distance, idx] = open.top();
+			open.pop();
+			if (distance > m_Distance[idx]) {
+				continue;
+			}
+
+			// Moves are symmetric, so the cells this one can step to are the ones that can step here.
+			const int x = idx % m_NumCols;
+			const int y = idx / m_NumCols;
+			unsigned moves = m_Moves[idx];
+			while (moves != 0) {
+				auto dir = std::countr_zero(moves);
+				moves &= moves - 1;
+				const int nx = x + k_GridDirections[dir].X;
+				const int ny = y + k_GridDirections[dir].Y;
+				if (nx < x0 || ny < y0 || nx >= x1 || ny >= y1) {
+					continue;
+				}
+
+				const auto nIdx = ny * m_NumCols + nx;
+				const f32 nDistance = distance + GetStepCost(dir, idx);
+				if (nDistance < m_Distance[nIdx]) {
+					m_Distance[nIdx] = nDistance;
+					open.push({ nDistance, nIdx });
+					borderChanged |= isBorder(nx, ny);
+				}
+			}
+		}
+
+		return borderChanged;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdFlowField::RunTile(int tileIdx) {
+		const int x0 = (tileIdx % m_NumTileCols) * k_TileSize;
+		const int y0 = (tileIdx / m_NumTileCols) * k_TileSize;
+		const int x1 = std::min(x0 + k_TileSize, m_NumCols);
+		const int y1 = std::min(y0 + k_TileSize, m_NumRows);
+
+		// The first run picks up the goals in the tile, later ones only what came in over the border.
+		const bool seedAll = m_TileSeeded[tileIdx] == 0;
+		m_TileSeeded[tileIdx] = 1;
+		m_TileChanged[tileIdx] = RelaxRegion(x0, y0, x1, y1, seedAll, true) ? 1 : 0;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdFlowField::RunTiles(int numThreads) {
+		const size_t numTiles = static_cast<size_t>(m_NumTileCols) * m_NumTileRows;
+		m_TilePending.assign(numTiles, 0);
+		m_TileSeeded.assign(numTiles, 0);
+		m_TileChanged.assign(numTiles, 0);
+		for (int y = 0; y < m_NumRows; ++y) {
+			for (int x = 0; x < m_NumCols; ++x) {
+				if (m_Distance[y * m_NumCols + x] == 0.0f) {
+					m_TilePending[(y / k_TileSize) * m_NumTileCols + x / k_TileSize] = 1;
+				}
+			}
+		}
+
+		std::vector<int> active;
+		std::atomic<size_t> nextActive(0);
+		int colour = 0;
+		bool done = false;
+
+		// Moves on to the next colour with pending tiles, done after a full cycle without one.
+		auto collectActive = [&]() {
+			active.clear();
+			for (int tries = 0; tries < 4 && active.empty(); ++tries, colour = (colour + 1) & 3) {
+				for (int ty = colour >> 1; ty < m_NumTileRows; ty += 2) {
+					for (int tx = colour & 1; tx < m_NumTileCols; tx += 2) {
+						const int tileIdx = ty * m_NumTileCols + tx;
+						if (m_TilePending[tileIdx] != 0) {
+							m_TilePending[tileIdx] = 0;
+							active.push_back(tileIdx);
+						}
+					}
+				}
+			}
+			done = active.empty();
+			nextActive.store(0, std::memory_order_relaxed);
+			m_NumTileRuns += active.size();
+		};
+
+		// Runs alone between rounds, the barrier orders it against the tile runs on either side.
+		auto finishRound = [&]() noexcept {
+			for (auto tileIdx : active) {
+				if (m_TileChanged[tileIdx] == 0) {
+					continue;
+				}
+				const int tx = tileIdx % m_NumTileCols;
+				const int ty = tileIdx / m_NumTileCols;
+				for (int ny = std::max(ty - 1, 0); ny <= std::min(ty + 1, m_NumTileRows - 1); ++ny) {
+					for (int nx = std::max(tx - 1, 0); nx <= std::min(tx + 1, m_NumTileCols - 1); ++nx) {
+						if (nx != tx || ny != ty) {
+							m_TilePending[ny * m_NumTileCols + nx] = 1;
+						}
+					}
+				}
+			}
+			collectActive();
+		};
+
+		collectActive();
+		std::barrier roundEnd(numThreads, finishRound);
+		auto worker = [&]() {
+			while (done == false) {
+				for (auto i = nextActive.fetch_add(1); i < active.size(); i = nextActive.fetch_add(1)) {
+					RunTile(active[i]);
+				}
+				roundEnd.arrive_and_wait();
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (int i = 1; i < numThreads; ++i) {
+			threads.emplace_back(worker);
+		}
+		worker();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdFlowField::BuildDirections(int firstRow, int lastRow) {
+		for (int y = firstRow; y < lastRow; ++y) {
+			for (int x = 0; x < m_NumCols; ++x) {
+				const auto idx = y * m_NumCols + x;
+				if (m_Distance[idx] == 0.0f || m_Distance[idx] == k_Unreachable) {
+					continue;
+				}
+
+				// Lowest direction index wins ties so every build picks the same step.
+				f32 best = k_Unreachable;
+				unsigned moves = m_Moves[idx];
+				while (moves != 0) {
+					auto dir = std::countr_zero(moves);
+					moves &= moves - 1;
+					const auto nIdx = (y + k_GridDirections[dir].Y) * m_NumCols + x + k_GridDirections[dir].X;
+					if (m_Distance[nIdx] == k_Unreachable) {
+						continue;
+					}
+					const f32 distance = m_Distance[nIdx] + GetStepCost(dir, nIdx);
+					if (distance < best) {
+						best = distance;
+						m_Direction[idx] = static_cast<u8>(dir);
+					}
+				}
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdFlowField::Build(const cdGridMap& map, const std::vector<cdGridCoord>& goals, int numThreads) {
+		PrepareCells(map);
+		m_NumTileCols = (m_NumCols + k_TileSize - 1) / k_TileSize;
+		m_NumTileRows = (m_NumRows + k_TileSize - 1) / k_TileSize;
+		m_NumTileRuns = 0;
+
+		if (SeedGoals(map, goals) == false) {
+			return false;
+		}
+
+		numThreads = std::max(numThreads, 1);
+		if (numThreads == 1 || m_NumTileCols * m_NumTileRows == 1) {
+			RelaxRegion(0, 0, m_NumCols, m_NumRows, true, false);
+			BuildDirections(0, m_NumRows);
+			return true;
+		}
+
+		RunTiles(numThreads);
+
+		// Every cell only reads distances here, so rows split freely.
+		std::vector<std::thread> threads;
+		const int rowsPerThread = (m_NumRows + numThreads - 1) / numThreads;
+		for (int i = 1; i < numThreads; ++i) {
+			const int firstRow = std::min(i * rowsPerThread, m_NumRows);
+			const int lastRow = std::min(firstRow + rowsPerThread, m_NumRows);
+			threads.emplace_back(&cdFlowField::BuildDirections, this, firstRow, lastRow);
+		}
+		BuildDirections(0, std::min(rowsPerThread, m_NumRows));
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
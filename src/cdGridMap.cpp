@@ -3,32 +3,755 @@
  * \file cdGridMap.cpp
  * Copyright (c) Punch First 2014 - 2016 All rights reserved.
  */
+#include <assert.h>
+#include <bit>
 #include <float.h>
+#include <math.h>
+#include <thread>
 
 #include "cdHeuristics.hpp"
 #include "cdGridMap.hpp"
+#include "cdMapFile.hpp"
 
 namespace {
 constexpr f32 kPTMRatio = 32;
+
+// Fewer rays than this per thread are not worth starting one for.
+constexpr size_t kMinRaysPerThread = 256;
+
+using ceed::ai::path::cdCornerRule;
+
+// Maps an open neighbour mask to the moves allowed under a corner rule. Diagonal N sits between
+// the two orthogonal directions listed in kDiagonalSides[N - 4].
+constexpr int kDiagonalSides[4][2] = { {0, 1}, {2, 1}, {2, 3}, {0, 3} };
+
+constexpr std::array<u8, 256> BuildMoveTable(cdCornerRule rule) {
+    std::array<u8, 256> table = {};
+    for (int mask = 0; mask < 256; ++mask) {
+        int moves = mask & 0x0F;
+        for (int diag = 0; diag < 4; ++diag) {
+            if ((mask & (1 << (diag + 4))) == 0) {
+                continue;
+            }
+            bool side1 = (mask & (1 << kDiagonalSides[diag][0])) != 0;
+            bool side2 = (mask & (1 << kDiagonalSides[diag][1])) != 0;
+            if (rule == cdCornerRule::ALWAYS ||
+                (rule == cdCornerRule::ONE_OPEN && (side1 || side2)) ||
+                (rule == cdCornerRule::NEVER && side1 && side2)) {
+                moves |= 1 << (diag + 4);
+            }
+        }
+        table[mask] = static_cast<u8>(moves);
+    }
+    return table;
+}
+
+// Indexed by cdCornerRule.
+constexpr std::array<std::array<u8, 256>, 3> kMoveTables = {{
+    BuildMoveTable(cdCornerRule::ALWAYS),
+    BuildMoveTable(cdCornerRule::ONE_OPEN),
+    BuildMoveTable(cdCornerRule::NEVER)
+}};
+
+static_assert(kMoveTables[2][0xFF] == 0xFF, "all open means every move");
+static_assert(kMoveTables[2][0xF0] == 0x00, "no diagonal past two closed sides");
+static_assert(kMoveTables[0][0xF0] == 0xF0, "corner cutting keeps the diagonals");
+
+inline u8 QuantizeThreat(f32 threat, f32 toQuantized) {
+    auto value = threat * toQuantized + 0.5f;
+    return static_cast<u8>(std::min(std::max(value, 0.0f), 255.0f));
+}
+
+inline bool CellsFillGrid(size_t numCells, int cols, int rows) {
+    return cols >= 0 && rows >= 0 && numCells == static_cast<size_t>(cols) * static_cast<size_t>(rows);
+}
 }
 
 namespace ceed::ai::path {
 
 //------------------------------------------------------------------------------------------------//
 
-cdGridMap::cdGridMap(cdGridCellList& cells, int cols, int rows, cdPoint2f& dimension)
+u8 GetAllowedMoves(u8 openMask, cdCornerRule rule) {
+	return kMoveTables[static_cast<int>(rule)][openMask];
+}
+
+//------------------------------------------------------------------------------------------------//
+
+f32 GetOctileHeuristics(int tieType, const cdGridCoord& cell1,
+	const cdGridCoord& cell2, const std::vector<cdGridCoord>& cellList, f32 diagonalLength) {
+	f32 bestSolution = FLT_MAX;
+
+	for (const auto& cell : cellList) {
+		f32 result =
+			OctileDistance(static_cast<f32>(cell1.X),
+			static_cast<f32>(cell1.Y),
+			static_cast<f32>(cell.X),
+			static_cast<f32>(cell.Y),
+			diagonalLength);
+
+		if (tieType != 0) {
+			result += CrossProduct(static_cast<f32>(cell2.X),
+				static_cast<f32>(cell2.Y),
+				static_cast<f32>(cell1.X),
+				static_cast<f32>(cell1.Y),
+				static_cast<f32>(cell.X),
+				static_cast<f32>(cell.Y)) * f32(0.001f);
+		}
+
+		bestSolution = std::min(bestSolution, result);
+	}
+
+	return bestSolution;
+}
+
+//------------------------------------------------------------------------------------------------//
+
+f32 GetAnyAngleHeuristics(int tieType, const cdGridCoord& cell1,
+	const cdGridCoord& cell2, const std::vector<cdGridCoord>& cellList) {
+	f32 bestSolution = FLT_MAX;
+
+	for (const auto& cell : cellList) {
+		f32 result =
+			EuclideanDistance(static_cast<f32>(cell1.X),
+			static_cast<f32>(cell1.Y),
+			static_cast<f32>(cell.X),
+			static_cast<f32>(cell.Y));
+
+		if (tieType != 0) {
+			result += CrossProduct(static_cast<f32>(cell2.X),
+				static_cast<f32>(cell2.Y),
+				static_cast<f32>(cell1.X),
+				static_cast<f32>(cell1.Y),
+				static_cast<f32>(cell.X),
+				static_cast<f32>(cell.Y)) * f32(0.001f);
+		}
+
+		bestSolution = std::min(bestSolution, result);
+	}
+
+	return bestSolution;
+}
+
+//------------------------------------------------------------------------------------------------//
+
+cdGridMap::cdGridMap(int cols, int rows, const cdPoint2f& dimension)
 	: cdJumpStartMap(fastdelegate::MakeDelegate(this, &cdGridMap::CellCollides)
 	, fastdelegate::MakeDelegate(this, &cdGridMap::GetHeuristics)
 	, fastdelegate::MakeDelegate(this, &cdGridMap::GetMovementCost), 0, rows, cols)
 	, m_ArraySize(cols * rows)
+	, m_MapId(0)
+	, m_Version(0)
+	, m_SearchMode(cdSearchMode::JUMP_POINT)
+	, m_CornerRule(cdCornerRule::ALWAYS)
+	, m_CostMode(cdCostMode::DISTANCE)
+	, m_Layout(cdCellLayout::ROW_MAJOR)
+	, m_TilesPerRow((cols + 7) / 8)
+	, m_AgentSize(1)
+	, m_GoalBoundsAgentSize(1)
+	, m_GoalBoundsCornerRule(cdCornerRule::ALWAYS)
+	, m_GoalBoundsDiagonalStepLength(GetGridStepLength(4))
+	, m_LineOfSightShortcut(true)
+	, m_DiagonalStepLength(GetGridStepLength(4))
+	, m_ThreatScale(1.0f)
+	, m_ThreatWeight(1.0f)
 	, m_MapDimension(dimension)
 	, m_MapHalfDimension(dimension)
-	, m_Cells(cells) {
+	, m_OccupancyStride((cols + 63) / 64)
+	, m_NumChunkCols((cols + (1 << k_ChunkShift) - 1) >> k_ChunkShift) {
+	m_ChunkVersions.resize(static_cast<size_t>(m_NumChunkCols) * ((rows + (1 << k_ChunkShift) - 1) >> k_ChunkShift), 0);
 	m_MapHalfDimension /= 2;
 	m_TileSize.x = m_MapDimension.x / m_NumCols;
 	m_TileSize.y = m_MapDimension.y / m_NumRows;
 	m_TileHalfSize = m_TileSize;
 	m_TileHalfSize /= 2;
+
+	LineOfSight = fastdelegate::MakeDelegate(this, &cdGridMap::CheckLineOfSightShortcut);
+
+	BuildThreatCostTable();
+}
+
+//------------------------------------------------------------------------------------------------//
+
+cdGridMap::cdGridMap(cdGridLayer<cdGridCell>&& cells, int cols, int rows, const cdPoint2f& dimension)
+	: cdGridMap(CellsFillGrid(cells.Size(), cols, rows) ? cols : 0,
+		CellsFillGrid(cells.Size(), cols, rows) ? rows : 0, dimension) {
+	// Cells that do not fill the grid are rejected, the map stays empty.
+	assert(CellsFillGrid(cells.Size(), cols, rows));
+	if (CellsFillGrid(cells.Size(), cols, rows) == false) {
+		return;
+	}
+
+	m_Cells = std::move(cells);
+	BuildOccupancy();
+	BuildNeighbourMasks();
+	BuildThreatLayer();
+	BuildClearance();
+}
+
+//------------------------------------------------------------------------------------------------//
+
+cdGridMap::cdGridMap(cdGridCellList& cells, int cols, int rows, cdPoint2f& dimension)
+	: cdGridMap(cdGridCellList(cells), cols, rows, dimension) {
+}
+
+//------------------------------------------------------------------------------------------------//
+
+cdGridMap::cdGridMap(cdGridCellList&& cells, int cols, int rows, const cdPoint2f& dimension)
+	: cdGridMap([&cells]() {
+		cdGridLayer<cdGridCell> layer;
+		layer.Own(std::move(cells));
+		return layer;
+	}(), cols, rows, dimension) {
+}
+
+//------------------------------------------------------------------------------------------------//
+
+cdGridMap::cdGridMap(std::span<const cdGridCell> cells, int cols, int rows, const cdPoint2f& dimension)
+	: cdGridMap([&cells]() {
+		cdGridLayer<cdGridCell> layer;
+		layer.View(cells.data(), cells.size());
+		return layer;
+	}(), cols, rows, dimension) {
+}
+
+//------------------------------------------------------------------------------------------------//
+
+cdGridMap::cdGridMap(std::shared_ptr<const cdGridCellList> cells, int cols, int rows, const cdPoint2f& dimension)
+	: cdGridMap([&cells]() {
+		cdGridLayer<cdGridCell> layer;
+		if (cells != nullptr) {
+			layer.View(cells->data(), cells->size(), cells);
+		}
+		return layer;
+	}(), cols, rows, dimension) {
+}
+
+//------------------------------------------------------------------------------------------------//
+
+cdGridMap::cdGridMap(std::shared_ptr<const cdMapFile> file)
+	: cdGridMap(cdMapFile::GetOpenHeader(file.get()).NumCols,
+		cdMapFile::GetOpenHeader(file.get()).NumRows,
+		cdPoint2f(cdMapFile::GetOpenHeader(file.get()).DimensionX, cdMapFile::GetOpenHeader(file.get()).DimensionY)) {
+	// Nothing to read from a missing or closed file, the map stays empty.
+	assert(file != nullptr && file->IsOpen());
+	if (file == nullptr || file->IsOpen() == false) {
+		return;
+	}
+
+	const auto header = file->GetHeader();
+	m_ThreatScale = header->ThreatScale;
+	BuildThreatCostTable();
+
+	// The layers point into the mapping, the shared pointer keeps it open for as long as they do.
+	size_t size = 0;
+	auto data = file->GetSection(cdMapFile::SECTION_OCCUPANCY, size);
+	m_Occupancy.View(static_cast<const u64*>(data), size / sizeof(u64), file);
+	data = file->GetSection(cdMapFile::SECTION_THREAT, size);
+	m_ThreatLayer.View(static_cast<const u8*>(data), size, file);
+
+	if ((data = file->GetSection(cdMapFile::SECTION_NEIGHBOUR_MASKS, size)) != nullptr) {
+		m_NeighbourMasks.View(static_cast<const u8*>(data), size, file);
+	} else {
+		BuildNeighbourMasks();
+	}
+
+	if ((data = file->GetSection(cdMapFile::SECTION_CLEARANCE, size)) != nullptr) {
+		m_Clearance.View(static_cast<const u8*>(data), size, file);
+	} else {
+		BuildClearance();
+	}
+
+	if ((data = file->GetSection(cdMapFile::SECTION_GOAL_BOUNDS, size)) != nullptr) {
+		m_GoalBounds.View(static_cast<const cdGoalBounds*>(data), size / sizeof(cdGoalBounds), file);
+		auto section = file->FindSection(cdMapFile::SECTION_GOAL_BOUNDS);
+		m_GoalBoundsAgentSize = static_cast<int>(section->Param);
+		m_GoalBoundsCornerRule = static_cast<cdCornerRule>(section->Param2);
+		m_GoalBoundsDiagonalStepLength = section->ParamF;
+		UpdateGoalBoundsEnabled();
+	}
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::BuildOccupancy() {
+	std::vector<u64> occupancy(GetOccupancySize(m_Layout), 0);
+
+	for (int y = 0; y < m_NumRows; ++y) {
+		for (int x = 0; x < m_NumCols; ++x) {
+			if (m_Cells[y * m_NumCols + x].Type == cdGridCell::CellType::BLOCKED) {
+				occupancy[GetOccupancyWord(x, y)] |= u64(1) << GetOccupancyBit(x, y);
+			}
+		}
+	}
+
+	m_Occupancy.Own(std::move(occupancy));
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::BuildNeighbourMasks() {
+	std::vector<u8> masks(GetLayerSize(), 0);
+
+	for (int y = 0; y < m_NumRows; ++y) {
+		for (int x = 0; x < m_NumCols; ++x) {
+			u8 mask = 0;
+			for (int dir = 0; dir < 8; ++dir) {
+				auto nx = x + k_GridDirections[dir].X;
+				auto ny = y + k_GridDirections[dir].Y;
+				if (nx >= 0 && ny >= 0 && nx < m_NumCols && ny < m_NumRows && IsBlocked(nx, ny) == false) {
+					mask |= u8(1 << dir);
+				}
+			}
+			masks[GetLayerIndex(x, y)] = mask;
+		}
+	}
+
+	m_NeighbourMasks.Own(std::move(masks));
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::BuildAgentMasks() {
+	if (m_AgentSize == 1) {
+		m_AgentMasks.Own(std::vector<u8>());
+		return;
+	}
+
+	std::vector<u8> masks(GetLayerSize(), 0);
+	for (int y = 0; y < m_NumRows; ++y) {
+		for (int x = 0; x < m_NumCols; ++x) {
+			u8 mask = 0;
+			for (int dir = 0; dir < 8; ++dir) {
+				if (CellCollides(cdGridCoord(x + k_GridDirections[dir].X, y + k_GridDirections[dir].Y)) == false) {
+					mask |= u8(1 << dir);
+				}
+			}
+			masks[GetLayerIndex(x, y)] = mask;
+		}
+	}
+
+	m_AgentMasks.Own(std::move(masks));
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::BuildThreatLayer() {
+	std::vector<u8> threat(GetLayerSize(), 0);
+
+	const f32 toQuantized = m_ThreatScale > 0 ? 255.0f / m_ThreatScale : 0.0f;
+	for (int y = 0; y < m_NumRows; ++y) {
+		for (int x = 0; x < m_NumCols; ++x) {
+			threat[GetLayerIndex(x, y)] = QuantizeThreat(m_Cells[y * m_NumCols + x].Threat, toQuantized);
+		}
+	}
+
+	m_ThreatLayer.Own(std::move(threat));
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::BuildThreatCostTable() {
+	for (int i = 0; i < 256; ++i) {
+		m_ThreatCostTable[i] = 1.0f + m_ThreatWeight * m_ThreatScale * (static_cast<f32>(i) / 255.0f);
+	}
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::SetThreatWeight(f32 weight) {
+	// The cost table is a search setting, not chunk data.
+	m_ThreatWeight = weight;
+	BuildThreatCostTable();
+	++m_Version;
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::SetThreatScale(f32 scale) {
+	std::vector<u8> previous(m_ThreatLayer.Data(), m_ThreatLayer.Data() + m_ThreatLayer.Size());
+
+	// Without cells the only threat left is the quantized one, rescale that.
+	if (m_Cells.Empty()) {
+		const f32 toQuantized = scale > 0 ? 255.0f / scale : 0.0f;
+		auto threat = m_ThreatLayer.MutableData();
+		for (size_t idx = 0; idx < m_ThreatLayer.Size(); ++idx) {
+			threat[idx] = QuantizeThreat(threat[idx] * m_ThreatScale / 255.0f, toQuantized);
+		}
+		m_ThreatScale = scale;
+	} else {
+		m_ThreatScale = scale;
+		BuildThreatLayer();
+	}
+	BuildThreatCostTable();
+
+	// Only the chunks whose quantized threat moved are edited.
+	std::vector<bool> edited(m_ChunkVersions.size(), false);
+	for (int y = 0; y < m_NumRows; ++y) {
+		for (int x = 0; x < m_NumCols; ++x) {
+			const auto idx = GetLayerIndex(x, y);
+			if (previous[idx] != m_ThreatLayer[idx]) {
+				edited[GetChunkIndex(cdGridCoord(x, y))] = true;
+			}
+		}
+	}
+	for (size_t chunk = 0; chunk < edited.size(); ++chunk) {
+		if (edited[chunk]) {
+			++m_ChunkVersions[chunk];
+		}
+	}
+	++m_Version;
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::SetDiagonalStepLength(f32 length) {
+	m_DiagonalStepLength = length;
+	UpdateGoalBoundsEnabled();
+	++m_Version;
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::BuildClearance() {
+	std::vector<u8> clearance(m_ArraySize);
+
+	// Brushfire as a two pass chamfer, exact for the chessboard distance. The map edge counts as
+	// an obstacle so the border distance is the starting value.
+	for (int y = 0; y < m_NumRows; ++y) {
+		for (int x = 0; x < m_NumCols; ++x) {
+			auto idx = y * m_NumCols + x;
+			if (IsBlocked(x, y)) {
+				clearance[idx] = 0;
+				continue;
+			}
+			int value = std::min(GetBorderClearance(x, y), 255);
+			if (x > 0) {
+				value = std::min(value, clearance[idx - 1] + 1);
+			}
+			if (y > 0) {
+				value = std::min(value, clearance[idx - m_NumCols] + 1);
+				if (x > 0) {
+					value = std::min(value, clearance[idx - m_NumCols - 1] + 1);
+				}
+				if (x < m_NumCols - 1) {
+					value = std::min(value, clearance[idx - m_NumCols + 1] + 1);
+				}
+			}
+			clearance[idx] = static_cast<u8>(value);
+		}
+	}
+
+	for (int y = m_NumRows - 1; y >= 0; --y) {
+		for (int x = m_NumCols - 1; x >= 0; --x) {
+			auto idx = y * m_NumCols + x;
+			int value = clearance[idx];
+			if (x < m_NumCols - 1) {
+				value = std::min(value, clearance[idx + 1] + 1);
+			}
+			if (y < m_NumRows - 1) {
+				value = std::min(value, clearance[idx + m_NumCols] + 1);
+				if (x > 0) {
+					value = std::min(value, clearance[idx + m_NumCols - 1] + 1);
+				}
+				if (x < m_NumCols - 1) {
+					value = std::min(value, clearance[idx + m_NumCols + 1] + 1);
+				}
+			}
+			clearance[idx] = static_cast<u8>(value);
+		}
+	}
+
+	// The passes run row major, tiled maps scatter the result afterwards.
+	if (m_Layout != cdCellLayout::ROW_MAJOR) {
+		std::vector<u8> tiled(GetLayerSize(), 0);
+		for (int y = 0; y < m_NumRows; ++y) {
+			for (int x = 0; x < m_NumCols; ++x) {
+				tiled[GetLayerIndex(x, y)] = clearance[y * m_NumCols + x];
+			}
+		}
+		clearance.swap(tiled);
+	}
+
+	m_Clearance.Own(std::move(clearance));
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::MarkChunksEdited(int minX, int minY, int maxX, int maxY) {
+	for (int y = minY >> k_ChunkShift; y <= (maxY >> k_ChunkShift); ++y) {
+		for (int x = minX >> k_ChunkShift; x <= (maxX >> k_ChunkShift); ++x) {
+			++m_ChunkVersions[y * m_NumChunkCols + x];
+		}
+	}
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::UpdateNeighbourMasks(const cdGridCoord& cell, bool open) {
+	// Each neighbour sees the cell in the opposite direction, flip that bit.
+	for (int dir = 0; dir < 8; ++dir) {
+		cdGridCoord next(cell.X + k_GridDirections[dir].X, cell.Y + k_GridDirections[dir].Y);
+		if (next.X < 0 || next.Y < 0 || next.X >= m_NumCols || next.Y >= m_NumRows) {
+			continue;
+		}
+		auto bit = u8(1 << GetGridDirectionIndex(-k_GridDirections[dir].X, -k_GridDirections[dir].Y));
+		auto& mask = m_NeighbourMasks.MutableData()[GetLayerIndex(next.X, next.Y)];
+		mask = open ? u8(mask | bit) : u8(mask & ~bit);
+	}
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::UpdateAgentMasks() {
+	auto masks = m_AgentMasks.MutableData();
+	for (auto idx : m_ClearanceQueue) {
+		int x = idx % m_NumCols;
+		int y = idx / m_NumCols;
+		const bool open = m_Clearance[GetLayerIndex(x, y)] >= m_AgentSize;
+
+		for (int dir = 0; dir < 8; ++dir) {
+			int nx = x + k_GridDirections[dir].X;
+			int ny = y + k_GridDirections[dir].Y;
+			if (nx < 0 || ny < 0 || nx >= m_NumCols || ny >= m_NumRows) {
+				continue;
+			}
+			auto bit = u8(1 << GetGridDirectionIndex(-k_GridDirections[dir].X, -k_GridDirections[dir].Y));
+			auto& mask = masks[GetLayerIndex(nx, ny)];
+			mask = open ? u8(mask | bit) : u8(mask & ~bit);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::LowerClearance(const cdGridCoord& cell) {
+	auto clearance = m_Clearance.MutableData();
+
+	// New obstacle, spread it outward until it stops beating the existing values. The queue holds
+	// row major indices whatever the layout.
+	m_ClearanceQueue.clear();
+	clearance[GetLayerIndex(cell.X, cell.Y)] = 0;
+	m_ClearanceQueue.push_back(cell.Y * m_NumCols + cell.X);
+
+	for (size_t head = 0; head < m_ClearanceQueue.size(); ++head) {
+		auto idx = m_ClearanceQueue[head];
+		int x = idx % m_NumCols;
+		int y = idx / m_NumCols;
+		int value = clearance[GetLayerIndex(x, y)] + 1;
+
+		for (int dir = 0; dir < 8; ++dir) {
+			int nx = x + k_GridDirections[dir].X;
+			int ny = y + k_GridDirections[dir].Y;
+			if (nx < 0 || ny < 0 || nx >= m_NumCols || ny >= m_NumRows) {
+				continue;
+			}
+			auto& next = clearance[GetLayerIndex(nx, ny)];
+			if (next > value) {
+				next = static_cast<u8>(value);
+				m_ClearanceQueue.push_back(ny * m_NumCols + nx);
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::RaiseClearance(const cdGridCoord& cell) {
+	auto clearance = m_Clearance.MutableData();
+
+	// Cleared obstacle. First collect every cell whose clearance came from it, those are the cells
+	// sitting exactly their chessboard distance away, and the set is connected back to the cell.
+	// Queue, marks and buckets use row major indices whatever the layout.
+	m_ClearanceQueue.clear();
+	m_ClearanceMarks.resize(m_ArraySize, 0);
+	auto cellIdx = cell.Y * m_NumCols + cell.X;
+	m_ClearanceMarks[cellIdx] = 1;
+	m_ClearanceQueue.push_back(cellIdx);
+
+	for (size_t head = 0; head < m_ClearanceQueue.size(); ++head) {
+		auto idx = m_ClearanceQueue[head];
+		int x = idx % m_NumCols;
+		int y = idx / m_NumCols;
+
+		for (int dir = 0; dir < 8; ++dir) {
+			int nx = x + k_GridDirections[dir].X;
+			int ny = y + k_GridDirections[dir].Y;
+			if (nx < 0 || ny < 0 || nx >= m_NumCols || ny >= m_NumRows) {
+				continue;
+			}
+			auto nextIdx = ny * m_NumCols + nx;
+			auto distance = std::max(abs(nx - cell.X), abs(ny - cell.Y));
+			if (m_ClearanceMarks[nextIdx] == 0 && clearance[GetLayerIndex(nx, ny)] == distance) {
+				m_ClearanceMarks[nextIdx] = 1;
+				m_ClearanceQueue.push_back(nextIdx);
+			}
+		}
+	}
+
+	// Then refill them from the untouched cells around the region, smallest value first.
+	auto& buckets = m_ClearanceBuckets;
+	for (auto idx : m_ClearanceQueue) {
+		int x = idx % m_NumCols;
+		int y = idx / m_NumCols;
+		int value = std::min(GetBorderClearance(x, y), 255);
+
+		for (int dir = 0; dir < 8; ++dir) {
+			int nx = x + k_GridDirections[dir].X;
+			int ny = y + k_GridDirections[dir].Y;
+			if (nx < 0 || ny < 0 || nx >= m_NumCols || ny >= m_NumRows) {
+				continue;
+			}
+			auto nextIdx = ny * m_NumCols + nx;
+			if (m_ClearanceMarks[nextIdx] == 0) {
+				value = std::min(value, clearance[GetLayerIndex(nx, ny)] + 1);
+			}
+		}
+
+		clearance[GetLayerIndex(x, y)] = static_cast<u8>(value);
+		buckets[value].push_back(idx);
+	}
+
+	for (int value = 0; value < 256; ++value) {
+		for (size_t i = 0; i < buckets[value].size(); ++i) {
+			auto idx = buckets[value][i];
+			int x = idx % m_NumCols;
+			int y = idx / m_NumCols;
+			if (m_ClearanceMarks[idx] == 0 || clearance[GetLayerIndex(x, y)] != value) {
+				continue;
+			}
+			m_ClearanceMarks[idx] = 0;
+
+			for (int dir = 0; dir < 8 && value < 255; ++dir) {
+				int nx = x + k_GridDirections[dir].X;
+				int ny = y + k_GridDirections[dir].Y;
+				if (nx < 0 || ny < 0 || nx >= m_NumCols || ny >= m_NumRows) {
+					continue;
+				}
+				auto nextIdx = ny * m_NumCols + nx;
+				auto& next = clearance[GetLayerIndex(nx, ny)];
+				if (m_ClearanceMarks[nextIdx] != 0 && next > value + 1) {
+					next = static_cast<u8>(value + 1);
+					buckets[value + 1].push_back(nextIdx);
+				}
+			}
+		}
+		buckets[value].clear();
+	}
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::SetCell(const cdGridCoord& cell, const cdGridCell& value) {
+	auto wasBlocked = IsBlocked(cell.X, cell.Y);
+	auto isBlocked = value.Type == cdGridCell::CellType::BLOCKED;
+
+	if (m_Cells.Empty() == false) {
+		m_Cells.MutableData()[cell.Y * m_NumCols + cell.X] = value;
+	}
+	SetThreat(cell, value.Threat);
+
+	if (wasBlocked == isBlocked) {
+		return;
+	}
+
+	auto& word = m_Occupancy.MutableData()[GetOccupancyWord(cell.X, cell.Y)];
+	word ^= u64(1) << GetOccupancyBit(cell.X, cell.Y);
+
+	UpdateNeighbourMasks(cell, !isBlocked);
+	if (isBlocked) {
+		LowerClearance(cell);
+	} else {
+		RaiseClearance(cell);
+	}
+	if (m_AgentSize > 1) {
+		UpdateAgentMasks();
+	}
+
+	// The queue still holds every cell the clearance update looked at. Their neighbours lost or
+	// gained a move.
+	int minX = cell.X;
+	int maxX = cell.X;
+	int minY = cell.Y;
+	int maxY = cell.Y;
+	for (auto idx : m_ClearanceQueue) {
+		minX = std::min(minX, idx % m_NumCols);
+		maxX = std::max(maxX, idx % m_NumCols);
+		minY = std::min(minY, idx / m_NumCols);
+		maxY = std::max(maxY, idx / m_NumCols);
+	}
+	MarkChunksEdited(std::max(minX - 1, 0), std::max(minY - 1, 0),
+		std::min(maxX + 1, m_NumCols - 1), std::min(maxY + 1, m_NumRows - 1));
+	++m_Version;
+
+	ClearGoalBounds();
+}
+
+//------------------------------------------------------------------------------------------------//
+
+cdGridCell cdGridMap::GetCell(const cdGridCoord& cell) const {
+	auto idx = cell.Y * m_NumCols + cell.X;
+	if (m_Cells.Empty() == false) {
+		return m_Cells[idx];
+	}
+
+	cdGridCell result(IsBlocked(cell.X, cell.Y) ? cdGridCell::CellType::BLOCKED : cdGridCell::CellType::EMPTY);
+	result.Threat = m_ThreatLayer[GetLayerIndex(cell.X, cell.Y)] * m_ThreatScale / 255.0f;
+	return result;
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::BuildGoalBounds() {
+	m_GoalBoundsAgentSize = m_AgentSize;
+	m_GoalBoundsCornerRule = m_CornerRule;
+	m_GoalBoundsDiagonalStepLength = m_DiagonalStepLength;
+	m_GoalBoundsEnabled = true;
+	cdJumpStartMap::BuildGoalBounds();
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::SetAgentSize(int size) {
+	size = std::max(size, 1);
+	if (size != m_AgentSize) {
+		m_AgentSize = size;
+		BuildAgentMasks();
+	}
+	UpdateGoalBoundsEnabled();
+	++m_Version;
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::SetThreat(const cdGridCoord& cell, f32 threat) {
+	SetThreatRow(cell.X, cell.Y, 1, &threat);
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::SetThreatRow(int x, int y, int count, const f32* threat) {
+	const f32 toQuantized = m_ThreatScale > 0 ? 255.0f / m_ThreatScale : 0.0f;
+	auto cells = m_Cells.Empty() ? nullptr : m_Cells.MutableData();
+	auto idx = y * m_NumCols + x;
+	// Searches only read the quantized threat, cells that keep their byte leave the chunks as they were.
+	int first = count;
+	int last = -1;
+	for (int i = 0; i < count; ++i, ++idx) {
+		if (cells != nullptr) {
+			cells[idx].Threat = threat[i];
+		}
+		auto layerIdx = GetLayerIndex(x + i, y);
+		auto quantized = QuantizeThreat(threat[i], toQuantized);
+		if (m_ThreatLayer[layerIdx] != quantized) {
+			m_ThreatLayer.MutableData()[layerIdx] = quantized;
+			first = std::min(first, i);
+			last = i;
+		}
+	}
+	if (last >= 0) {
+		MarkChunksEdited(x + first, y, x + last, y);
+		++m_Version;
+	}
 }
 
 //------------------------------------------------------------------------------------------------//
@@ -37,63 +760,225 @@ bool cdGridMap::CellCollides(const cdGridCoord &cell) const {
 	if (cell.X < 0 || cell.Y < 0 || cell.X >= m_NumCols || cell.Y >= m_NumRows)
 		return true;
 
-	auto idx = cell.Y * m_NumCols + cell.X;
+	// Blocked cells have 0 clearance so this covers the single cell agent too.
+	return m_Clearance[GetLayerIndex(cell.X, cell.Y)] < m_AgentSize;
+}
 
-	if (idx >= m_ArraySize || idx < 0)
-	{
+//------------------------------------------------------------------------------------------------//
+
+bool cdGridMap::HasLineOfSight(const cdGridCoord& from, const cdGridCoord& to) const {
+	// The segment stays in the box of its ends.
+	if (CellCollides(from) || CellCollides(to)) {
+		return false;
+	}
+
+	if (m_AgentSize == 1) {
+		return WalkSupercover(from, to, [this](const cdGridCoord& cell) {
+			return IsBlocked(cell.X, cell.Y) == false;
+		});
+	}
+	return WalkSupercover(from, to, [this](const cdGridCoord& cell) {
+		return CellCollides(cell) == false;
+	});
+}
+
+//------------------------------------------------------------------------------------------------//
+
+bool cdGridMap::CastRay(const cdGridCoord& from, const cdGridCoord& to, cdGridCoord& firstHit) const {
+	firstHit = to;
+	// The segment stays in the box of its ends, with both on the map every cell is.
+	if (IsOnMap(from) && IsOnMap(to)) {
+		return WalkSupercover(from, to, [this, &firstHit](const cdGridCoord& cell) {
+			if (IsBlocked(cell.X, cell.Y)) {
+				firstHit = cell;
+				return false;
+			}
+			return true;
+		}) == false;
+	}
+	return WalkSupercover(from, to, [this, &firstHit](const cdGridCoord& cell) {
+		if (IsRayBlocked(cell.X, cell.Y)) {
+			firstHit = cell;
+			return false;
+		}
 		return true;
+	}) == false;
+}
+
+//------------------------------------------------------------------------------------------------//
+
+size_t cdGridMap::CastRayRange(std::span<const cdGridCoord> from, std::span<const cdGridCoord> to,
+	std::span<u8> hits, std::span<cdGridCoord> firstHits, size_t first, size_t last) const {
+	size_t numHits = 0;
+	for (size_t ray = first; ray < last; ++ray) {
+		const bool hit = CastRay(from[ray], to[ray], firstHits[ray]);
+		hits[ray] = hit ? 1 : 0;
+		numHits += hit ? 1 : 0;
+	}
+	return numHits;
+}
+
+//------------------------------------------------------------------------------------------------//
+
+size_t cdGridMap::CastRays(std::span<const cdGridCoord> from, std::span<const cdGridCoord> to,
+	std::span<u8> hits, std::span<cdGridCoord> firstHits, int numThreads) const {
+	const size_t numRays = std::min(std::min(from.size(), to.size()), std::min(hits.size(), firstHits.size()));
+	numThreads = static_cast<int>(std::min<size_t>(std::max(numThreads, 1), std::max<size_t>(numRays / kMinRaysPerThread, 1)));
+	if (numThreads == 1) {
+		return CastRayRange(from, to, hits, firstHits, 0, numRays);
 	}
 
-	return m_Cells[idx].Type == cdGridCell::CellType::BLOCKED ? true : false;
+	// Rays only read the map, so they split freely.
+	std::vector<size_t> numHits(numThreads, 0);
+	std::vector<std::thread> threads;
+	const size_t raysPerThread = (numRays + numThreads - 1) / numThreads;
+	for (int i = 1; i < numThreads; ++i) {
+		const size_t firstRay = std::min(i * raysPerThread, numRays);
+		const size_t lastRay = std::min(firstRay + raysPerThread, numRays);
+		threads.emplace_back([&, i, firstRay, lastRay]() {
+			numHits[i] = CastRayRange(from, to, hits, firstHits, firstRay, lastRay);
+		});
+	}
+	numHits[0] = CastRayRange(from, to, hits, firstHits, 0, std::min(raysPerThread, numRays));
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	size_t total = 0;
+	for (auto count : numHits) {
+		total += count;
+	}
+	return total;
+}
+
+//------------------------------------------------------------------------------------------------//
+
+bool cdGridMap::CheckLineOfSightShortcut(const cdGridCoord& start, const cdGridCoord& goal) {
+	if (m_LineOfSightShortcut == false || m_SearchMode == cdSearchMode::GRID) {
+		return false;
+	}
+	// Jump point paths are made of octile legs, only a straight or exact diagonal line is one.
+	if (m_SearchMode == cdSearchMode::JUMP_POINT) {
+		const int dx = abs(goal.X - start.X);
+		const int dy = abs(goal.Y - start.Y);
+		if (m_CostMode != cdCostMode::DISTANCE || (dx != 0 && dy != 0 && dx != dy)) {
+			return false;
+		}
+	}
+	return HasLineOfSight(start, goal);
 }
 
 //------------------------------------------------------------------------------------------------//
 
 f32 cdGridMap::GetHeuristics(const cdGridCoord& cell1,
 	const cdGridCoord& cell2, const std::vector<cdGridCoord>& cellList) {
-	f32 bestSolution = FLT_MAX;
+	if (m_SearchMode == cdSearchMode::ANY_ANGLE) {
+		return GetAnyAngleHeuristics(m_TieType, cell1, cell2, cellList);
+	}
+	return GetOctileHeuristics(m_TieType, cell1, cell2, cellList, m_DiagonalStepLength);
+}
 
-	for (auto i = cellList.begin(); i != cellList.end(); ++i) {
-		auto cell = &(*i);
-		f32 result =
-			ManhattanDistance(static_cast<f32>(cell1.X),
-			static_cast<f32>(cell1.Y),
-			static_cast<f32>(cell->X),
-			static_cast<f32>(cell->Y));
-
-		if (m_TieType == 0) {
-			result *= f32(1.01);
-		} else {
-			f32 addingTieVal =
-				CrossProduct(static_cast<f32>(cell2.X),
-				static_cast<f32>(cell2.Y),
-				static_cast<f32>(cell1.X),
-				static_cast<f32>(cell1.Y),
-				static_cast<f32>(cell->X),
-				static_cast<f32>(cell->Y)) * f32(0.001f);
-			result += addingTieVal;
-		}
+//------------------------------------------------------------------------------------------------//
 
-		if (bestSolution > result) {
-			bestSolution = result;
-		}
+f32 cdGridMap::GetMovementCost(const cdGridCoord& c1, const cdGridCoord& c2) {
+	// Any-angle legs run straight between cells that can be far apart. A leg only sees its end
+	// cells, so it pays no threat rather than the threat of the cell it ends on.
+	if (m_SearchMode == cdSearchMode::ANY_ANGLE) {
+		return EuclideanDistance(static_cast<f32>(c1.X), static_cast<f32>(c1.Y),
+			static_cast<f32>(c2.X), static_cast<f32>(c2.Y));
 	}
 
-	return bestSolution;
+	// Jump point legs can span many cells, they pay the octile length of the leg. A single step is
+	// the one cell case.
+	return GetOctileLegLength(c1, c2, m_DiagonalStepLength) * GetEnterCost(c2);
 }
 
 //------------------------------------------------------------------------------------------------//
 
-f32 cdGridMap::GetMovementCost(const cdGridCoord& c1, const cdGridCoord& c2) {
-	cdGridCoord diff;
-	diff.X = abs(c2.X - c1.X);
-	diff.Y = abs(c2.Y - c2.Y);
+bool cdGridMap::GetGridSucessorList(const cdAStar<cdGridCoord>* astar,
+	const cdNode<cdGridCoord>& current,
+	const cdGridCoord& start,
+	const std::vector<cdGridCoord>& end,
+	std::vector<cdGridCoord>& adjcentList) {
+	const auto& pos = current.NodePos;
+
+	unsigned moves = GetCellMoves(pos);
+	// Any-angle legs may not touch a blocked cell at a corner, so their single steps may not either.
+	if (m_SearchMode == cdSearchMode::ANY_ANGLE) {
+		moves = GetAllowedMoves(static_cast<u8>(moves), cdCornerRule::NEVER);
+	}
+	while (moves != 0) {
+		auto dir = std::countr_zero(moves);
+		moves &= moves - 1;
+		adjcentList.push_back(cdGridCoord(pos.X + k_GridDirections[dir].X, pos.Y + k_GridDirections[dir].Y));
+	}
+
+	return adjcentList.empty() == false;
+}
 
-	if (diff.X != 0 && diff.Y != 0) {
-		return 1.5f;
+//------------------------------------------------------------------------------------------------//
+
+u8 cdGridMap::GetCellMoves(const cdGridCoord& cell) const {
+	// One read for the whole 3x3 neighbourhood whatever the agent size, the table takes care of
+	// the corners.
+	return kMoveTables[static_cast<int>(m_CornerRule)][GetAgentNeighbourMask(cell)];
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::SetSearchMode(cdSearchMode mode) {
+	m_SearchMode = mode;
+
+	if (mode == cdSearchMode::JUMP_POINT) {
+		GetSucessors = fastdelegate::MakeDelegate(this, &cdJumpStartMap::GetSucessorList);
+	} else {
+		GetSucessors = fastdelegate::MakeDelegate(this, &cdGridMap::GetGridSucessorList);
+	}
+
+	if (mode == cdSearchMode::ANY_ANGLE) {
+		AnyAngleLineOfSight = fastdelegate::MakeDelegate(this, &cdGridMap::HasLineOfSight);
+	} else {
+		AnyAngleLineOfSight.clear();
+	}
+}
+
+//------------------------------------------------------------------------------------------------//
+
+void cdGridMap::SetCellLayout(cdCellLayout layout) {
+	if (layout == m_Layout) {
+		return;
+	}
+
+	// Read every layer through the old layout and write it through the new one.
+	auto relayout = [this, layout](const cdGridLayer<u8>& source) {
+		std::vector<u8> result(GetLayerSize(layout), 0);
+		for (int y = 0; y < m_NumRows; ++y) {
+			for (int x = 0; x < m_NumCols; ++x) {
+				result[GetLayerIndex(x, y, layout)] = source[GetLayerIndex(x, y)];
+			}
+		}
+		return result;
+	};
+
+	std::vector<u64> occupancy(GetOccupancySize(layout), 0);
+	for (int y = 0; y < m_NumRows; ++y) {
+		for (int x = 0; x < m_NumCols; ++x) {
+			if (IsBlocked(x, y)) {
+				occupancy[GetOccupancyWord(x, y, layout)] |= u64(1) << GetOccupancyBit(x, y, layout);
+			}
+		}
 	}
 
-	return 1;
+	auto masks = relayout(m_NeighbourMasks);
+	auto threat = relayout(m_ThreatLayer);
+	auto clearance = relayout(m_Clearance);
+
+	m_Layout = layout;
+	m_Occupancy.Own(std::move(occupancy));
+	m_NeighbourMasks.Own(std::move(masks));
+	m_ThreatLayer.Own(std::move(threat));
+	m_Clearance.Own(std::move(clearance));
+	BuildAgentMasks();
 }
 
 //------------------------------------------------------------------------------------------------//
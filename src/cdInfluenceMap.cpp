@@ -0,0 +1,290 @@
+/*!
+ * \file cdInfluenceMap.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+
+#include <algorithm>
+
+#include "cdInfluenceMap.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CD_INFLUENCE_SSE 1
+#endif
+
+namespace {
+constexpr f32 kDefaultDecay = 0.9f;
+constexpr f32 kDefaultCutoff = 0.0001f;
+}
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdInfluenceMap::cdInfluenceMap(int cols, int rows, int tileSize)
+		: m_NumCols(cols)
+		, m_NumRows(rows)
+		, m_TileSize(tileSize)
+		, m_NumTileCols((cols + tileSize - 1) / tileSize)
+		, m_NumTileRows((rows + tileSize - 1) / tileSize)
+		, m_Decay(kDefaultDecay)
+		, m_Cutoff(kDefaultCutoff)
+		, m_Kernel({ 0.25f, 0.5f, 0.25f })
+		, m_Values(static_cast<size_t>(cols) * rows, 0.0f)
+		, m_Sources(m_Values.size(), 0.0f)
+		, m_Scratch(m_Values.size(), 0.0f)
+		, m_ActiveTiles(static_cast<size_t>(m_NumTileCols) * m_NumTileRows, 0)
+		, m_SourceTiles(m_ActiveTiles.size(), 0)
+		, m_DirtyTiles(m_ActiveTiles.size(), 0) {
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdInfluenceMap::cdInfluenceMap(const cdGridMap& map, int tileSize)
+		: cdInfluenceMap(map.GetNumCols(), map.GetNumRows(), tileSize) {
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdInfluenceMap::SetKernel(const std::vector<f32>& kernel) {
+		if ((kernel.size() & 1) == 0 || static_cast<int>(kernel.size() / 2) > m_TileSize) {
+			return false;
+		}
+
+		m_Kernel = kernel;
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdInfluenceMap::AddSource(const cdGridCoord& cell, f32 strength) {
+		if (cell.X < 0 || cell.Y < 0 || cell.X >= m_NumCols || cell.Y >= m_NumRows) {
+			return;
+		}
+
+		m_Sources[cell.Y * m_NumCols + cell.X] += strength;
+		m_SourceTiles[(cell.Y / m_TileSize) * m_NumTileCols + cell.X / m_TileSize] = 1;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdInfluenceMap::CollectDirtyTiles() {
+		std::fill(m_DirtyTiles.begin(), m_DirtyTiles.end(), u8(0));
+		m_DirtyList.clear();
+
+		// The blur radius is at most one tile so influence can only spill into the 8 neighbours.
+		for (int ty = 0; ty < m_NumTileRows; ++ty) {
+			for (int tx = 0; tx < m_NumTileCols; ++tx) {
+				auto tileIdx = ty * m_NumTileCols + tx;
+				if (m_ActiveTiles[tileIdx] == 0 && m_SourceTiles[tileIdx] == 0) {
+					continue;
+				}
+
+				for (int ny = std::max(0, ty - 1); ny <= std::min(m_NumTileRows - 1, ty + 1); ++ny) {
+					for (int nx = std::max(0, tx - 1); nx <= std::min(m_NumTileCols - 1, tx + 1); ++nx) {
+						m_DirtyTiles[ny * m_NumTileCols + nx] = 1;
+					}
+				}
+			}
+		}
+
+		for (int tileIdx = 0; tileIdx < static_cast<int>(m_DirtyTiles.size()); ++tileIdx) {
+			if (m_DirtyTiles[tileIdx] != 0) {
+				m_DirtyList.push_back(tileIdx);
+			}
+		}
+
+		std::fill(m_SourceTiles.begin(), m_SourceTiles.end(), u8(0));
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdInfluenceMap::DecayTile(int tileIdx) {
+		const int x0 = (tileIdx % m_NumTileCols) * m_TileSize;
+		const int y0 = (tileIdx / m_NumTileCols) * m_TileSize;
+		const int x1 = std::min(x0 + m_TileSize, m_NumCols);
+		const int y1 = std::min(y0 + m_TileSize, m_NumRows);
+
+		for (int y = y0; y < y1; ++y) {
+			f32* values = &m_Values[y * m_NumCols];
+			f32* sources = &m_Sources[y * m_NumCols];
+			int x = x0;
+#ifdef CD_INFLUENCE_SSE
+			const __m128 decay = _mm_set1_ps(m_Decay);
+			const __m128 zero = _mm_setzero_ps();
+			for (; x + 4 <= x1; x += 4) {
+				__m128 v = _mm_loadu_ps(values + x);
+				__m128 s = _mm_loadu_ps(sources + x);
+				_mm_storeu_ps(values + x, _mm_add_ps(_mm_mul_ps(v, decay), s));
+				_mm_storeu_ps(sources + x, zero);
+			}
+#endif
+			for (; x < x1; ++x) {
+				values[x] = values[x] * m_Decay + sources[x];
+				sources[x] = 0.0f;
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdInfluenceMap::BlurTileRows(int tileIdx) {
+		const int x0 = (tileIdx % m_NumTileCols) * m_TileSize;
+		const int y0 = (tileIdx / m_NumTileCols) * m_TileSize;
+		const int x1 = std::min(x0 + m_TileSize, m_NumCols);
+		const int y1 = std::min(y0 + m_TileSize, m_NumRows);
+		const int radius = static_cast<int>(m_Kernel.size() / 2);
+		const int kernelSize = static_cast<int>(m_Kernel.size());
+
+		for (int y = y0; y < y1; ++y) {
+			const f32* values = &m_Values[y * m_NumCols];
+			f32* scratch = &m_Scratch[y * m_NumCols];
+
+			for (int x = x0; x < x1;) {
+#ifdef CD_INFLUENCE_SSE
+				// Whole kernel inside the row, do 4 cells at once.
+				if (x - radius >= 0 && x + 4 + radius <= m_NumCols && x + 4 <= x1) {
+					__m128 acc = _mm_setzero_ps();
+					for (int k = 0; k < kernelSize; ++k) {
+						acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(m_Kernel[k]),
+							_mm_loadu_ps(values + x + k - radius)));
+					}
+					_mm_storeu_ps(scratch + x, acc);
+					x += 4;
+					continue;
+				}
+#endif
+				f32 acc = 0.0f;
+				for (int k = 0; k < kernelSize; ++k) {
+					auto sx = x + k - radius;
+					if (sx >= 0 && sx < m_NumCols) {
+						acc += m_Kernel[k] * values[sx];
+					}
+				}
+				scratch[x] = acc;
+				++x;
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdInfluenceMap::BlurTileColumns(int tileIdx) {
+		const int x0 = (tileIdx % m_NumTileCols) * m_TileSize;
+		const int y0 = (tileIdx / m_NumTileCols) * m_TileSize;
+		const int x1 = std::min(x0 + m_TileSize, m_NumCols);
+		const int y1 = std::min(y0 + m_TileSize, m_NumRows);
+		const int radius = static_cast<int>(m_Kernel.size() / 2);
+		const int kernelSize = static_cast<int>(m_Kernel.size());
+
+		for (int y = y0; y < y1; ++y) {
+			const int k0 = std::max(0, radius - y);
+			const int k1 = std::min(kernelSize, m_NumRows - y + radius);
+			f32* values = &m_Values[y * m_NumCols];
+
+			int x = x0;
+#ifdef CD_INFLUENCE_SSE
+			for (; x + 4 <= x1; x += 4) {
+				__m128 acc = _mm_setzero_ps();
+				for (int k = k0; k < k1; ++k) {
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(m_Kernel[k]),
+						_mm_loadu_ps(&m_Scratch[(y + k - radius) * m_NumCols + x])));
+				}
+				_mm_storeu_ps(values + x, acc);
+			}
+#endif
+			for (; x < x1; ++x) {
+				f32 acc = 0.0f;
+				for (int k = k0; k < k1; ++k) {
+					acc += m_Kernel[k] * m_Scratch[(y + k - radius) * m_NumCols + x];
+				}
+				values[x] = acc;
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdInfluenceMap::RefreshTileActivity(int tileIdx) {
+		const int x0 = (tileIdx % m_NumTileCols) * m_TileSize;
+		const int y0 = (tileIdx / m_NumTileCols) * m_TileSize;
+		const int x1 = std::min(x0 + m_TileSize, m_NumCols);
+		const int y1 = std::min(y0 + m_TileSize, m_NumRows);
+
+		bool active = false;
+		for (int y = y0; y < y1 && active == false; ++y) {
+			for (int x = x0; x < x1; ++x) {
+				auto value = m_Values[y * m_NumCols + x];
+				if (value > m_Cutoff || value < -m_Cutoff) {
+					active = true;
+					break;
+				}
+			}
+		}
+
+		// Sleeping tiles have to read as zero for the neighbours' blur.
+		if (active == false) {
+			for (int y = y0; y < y1; ++y) {
+				std::fill(&m_Values[y * m_NumCols + x0], &m_Values[y * m_NumCols + x1], 0.0f);
+			}
+		}
+
+		m_ActiveTiles[tileIdx] = active ? 1 : 0;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdInfluenceMap::Propagate() {
+		CollectDirtyTiles();
+
+		// Each pass has to finish on every dirty tile before the next one reads across tile borders.
+		for (auto tileIdx : m_DirtyList) {
+			DecayTile(tileIdx);
+		}
+		for (auto tileIdx : m_DirtyList) {
+			BlurTileRows(tileIdx);
+		}
+		for (auto tileIdx : m_DirtyList) {
+			BlurTileColumns(tileIdx);
+		}
+
+		for (auto tileIdx : m_DirtyList) {
+			const int x0 = (tileIdx % m_NumTileCols) * m_TileSize;
+			const int y0 = (tileIdx / m_NumTileCols) * m_TileSize;
+			const int x1 = std::min(x0 + m_TileSize, m_NumCols);
+			const int y1 = std::min(y0 + m_TileSize, m_NumRows);
+			for (int y = y0; y < y1; ++y) {
+				std::fill(&m_Scratch[y * m_NumCols + x0], &m_Scratch[y * m_NumCols + x1], 0.0f);
+			}
+
+			RefreshTileActivity(tileIdx);
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdInfluenceMap::Apply(cdGridMap& map) const {
+		for (auto tileIdx : m_DirtyList) {
+			const int x0 = (tileIdx % m_NumTileCols) * m_TileSize;
+			const int y0 = (tileIdx / m_NumTileCols) * m_TileSize;
+			const int x1 = std::min(x0 + m_TileSize, m_NumCols);
+			const int y1 = std::min(y0 + m_TileSize, m_NumRows);
+			for (int y = y0; y < y1; ++y) {
+				map.SetThreatRow(x0, y, x1 - x0, &m_Values[y * m_NumCols + x0]);
+			}
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdInfluenceMap::Clear() {
+		std::fill(m_Values.begin(), m_Values.end(), 0.0f);
+		std::fill(m_Sources.begin(), m_Sources.end(), 0.0f);
+		std::fill(m_ActiveTiles.begin(), m_ActiveTiles.end(), u8(0));
+		std::fill(m_SourceTiles.begin(), m_SourceTiles.end(), u8(0));
+		std::fill(m_DirtyTiles.begin(), m_DirtyTiles.end(), u8(0));
+		m_DirtyList.clear();
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
@@ -4,27 +4,27 @@
  */
 
 #include <algorithm>
+#include <float.h>
+#include <functional>
+#include <queue>
 
 #include "cdHelperMethods.hpp"
 #include "cdJumpStartMap.hpp"
 
 namespace {
-struct Direction {
-    int X, Y;
-    constexpr Direction(int x = 0, int y = 0)
-        : X(x), Y(y) {}
-};
+constexpr auto& DirectionList = ceed::ai::path::k_GridDirections;
+
+// Costs that differ by less than this are treated as ties when building goal bounds.
+constexpr f32 kGoalBoundsTieEpsilon = 0.0001f;
+
+struct GoalBoundsEntry {
+    f32 Cost;
+    int Idx;
 
-constexpr std::array<Direction, 8> DirectionList = {{
-    {0, 1},
-    {1, 0},
-    {0, -1},
-    {-1, 0},
-    {1, 1},
-    {1, -1},
-    {-1, -1},
-    {-1, 1}
-}};
+    inline bool operator > (const GoalBoundsEntry& entry) const {
+        return Cost > entry.Cost;
+    }
+};
 
 }
 
@@ -45,7 +45,64 @@ namespace ceed::ai::path {
 			tieType)
 		, m_NumCols(cols)
 		, m_NumRows(rows)
-		, m_ArraySize(cols * rows) {
+		, m_ArraySize(cols * rows)
+		, m_GoalBoundsEnabled(true)
+		, m_CutCorners(true) {
+		NodeKey = fastdelegate::MakeDelegate(this, &cdJumpStartMap::GetNodeKey);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdJumpStartMap::CanStep(const cdGridCoord& cell, int dir) {
+		const auto& step = DirectionList[dir];
+		if (Collides(cdGridCoord(cell.X + step.X, cell.Y + step.Y))) {
+			return false;
+		}
+		return m_CutCorners || dir < 4 ||
+			(Collides(cdGridCoord(cell.X + step.X, cell.Y)) == false &&
+			Collides(cdGridCoord(cell.X, cell.Y + step.Y)) == false);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdJumpStartMap::PruneWithoutCornerCutting(const cdGridCoord& pos, int xDir, int yDir,
+		std::vector<cdGridCoord>& result) {
+		// Diagonal steps need both sides open, so a diagonal move has no forced neighbours: anything
+		// behind it is as close through one of the sides.
+		if (xDir != 0 && yDir != 0) {
+			const bool xOpen = Collides(cdGridCoord(pos.X + xDir, pos.Y)) == false;
+			const bool yOpen = Collides(cdGridCoord(pos.X, pos.Y + yDir)) == false;
+			if (xOpen) {
+				result.push_back(cdGridCoord(pos.X + xDir, pos.Y));
+			}
+			if (yOpen) {
+				result.push_back(cdGridCoord(pos.X, pos.Y + yDir));
+			}
+			if (xOpen && yOpen && Collides(cdGridCoord(pos.X + xDir, pos.Y + yDir)) == false) {
+				result.push_back(cdGridCoord(pos.X + xDir, pos.Y + yDir));
+			}
+			return;
+		}
+
+		// A straight move forces the side cells whose cell behind is blocked, since the parent could
+		// not step onto them diagonally, and the diagonal ahead of them.
+		const int sideX = yDir;
+		const int sideY = xDir;
+		const bool aheadOpen = Collides(cdGridCoord(pos.X + xDir, pos.Y + yDir)) == false;
+		if (aheadOpen) {
+			result.push_back(cdGridCoord(pos.X + xDir, pos.Y + yDir));
+		}
+		for (int side = -1; side <= 1; side += 2) {
+			cdGridCoord sideCell(pos.X + side * sideX, pos.Y + side * sideY);
+			if (Collides(sideCell) ||
+				Collides(cdGridCoord(sideCell.X - xDir, sideCell.Y - yDir)) == false) {
+				continue;
+			}
+			result.push_back(sideCell);
+			if (aheadOpen && Collides(cdGridCoord(sideCell.X + xDir, sideCell.Y + yDir)) == false) {
+				result.push_back(cdGridCoord(sideCell.X + xDir, sideCell.Y + yDir));
+			}
+		}
 	}
 
 	//------------------------------------------------------------------------------------------------//
@@ -58,13 +115,8 @@ namespace ceed::ai::path {
 
 		if (curParentIdx == -1){
 			for (int i = 0; i < 8; ++i){
-				cdGridCoord coord;
-				coord.X = curNodePos.X + DirectionList[i].X;
-				coord.Y = curNodePos.Y + DirectionList[i].Y;
-
-				if (Collides(coord) == false)
-				{
-					result.push_back(coord);
+				if (CanStep(curNodePos, i)) {
+					result.push_back(cdGridCoord(curNodePos.X + DirectionList[i].X, curNodePos.Y + DirectionList[i].Y));
 				}
 			}
 		} else {
@@ -79,7 +131,9 @@ namespace ceed::ai::path {
 				auto xDir = std::min(std::max(-1, xDiff), 1);
 				auto yDir = std::min(std::max(-1, yDiff), 1);
 
-				if (xDir != 0 && yDir != 0) {
+				if (m_CutCorners == false) {
+					PruneWithoutCornerCutting(curNodePos, xDir, yDir, result);
+				} else if (xDir != 0 && yDir != 0) {
 					cdGridCoord nodePos;
 					nodePos.X = curNodePos.X;
 					nodePos.Y = curNodePos.Y + yDir;
@@ -117,18 +171,17 @@ namespace ceed::ai::path {
 
 						if (Collides(nodePos) == false) {
 							result.push_back(nodePos);
+						}
+
+						// Forced neighbours, a diagonal step only needs its destination open.
+						if (Collides(cdGridCoord(curNodePos.X - 1, curNodePos.Y)) == true &&
+							Collides(cdGridCoord(curNodePos.X - 1, curNodePos.Y + yDir)) == false) {
+							result.push_back(cdGridCoord(curNodePos.X - 1, curNodePos.Y + yDir));
+						}
 
-							if (Collides(cdGridCoord(curNodePos.X - 1, curNodePos.Y)) == true) {
-								nodePos.X = curNodePos.X - 1;
-								nodePos.Y = curNodePos.Y + yDir;
-								result.push_back(nodePos);
-							}
-
-							if (Collides(cdGridCoord(curNodePos.X + 1, curNodePos.Y)) == true) {
-								nodePos.X = curNodePos.X + 1;
-								nodePos.Y = curNodePos.Y + yDir;
-								result.push_back(nodePos);
-							}
+						if (Collides(cdGridCoord(curNodePos.X + 1, curNodePos.Y)) == true &&
+							Collides(cdGridCoord(curNodePos.X + 1, curNodePos.Y + yDir)) == false) {
+							result.push_back(cdGridCoord(curNodePos.X + 1, curNodePos.Y + yDir));
 						}
 					}
 					else {
@@ -137,18 +190,16 @@ namespace ceed::ai::path {
 						nodePos.Y = curNodePos.Y;
 						if (Collides(nodePos) == false) {
 							result.push_back(nodePos);
+						}
+
+						if (Collides(cdGridCoord(curNodePos.X, curNodePos.Y - 1)) == true &&
+							Collides(cdGridCoord(curNodePos.X + xDir, curNodePos.Y - 1)) == false) {
+							result.push_back(cdGridCoord(curNodePos.X + xDir, curNodePos.Y - 1));
+						}
 
-							if (Collides(cdGridCoord(curNodePos.X, curNodePos.Y - 1)) == true) {
-								nodePos.X = curNodePos.X + xDir;
-								nodePos.Y = curNodePos.Y - 1;
-								result.push_back(nodePos);
-							}
-
-							if (Collides(cdGridCoord(curNodePos.X, curNodePos.Y + 1)) == true) {
-								nodePos.X = curNodePos.X + xDir;
-								nodePos.Y = curNodePos.Y + 1;
-								result.push_back(nodePos);
-							}
+						if (Collides(cdGridCoord(curNodePos.X, curNodePos.Y + 1)) == true &&
+							Collides(cdGridCoord(curNodePos.X + xDir, curNodePos.Y + 1)) == false) {
+							result.push_back(cdGridCoord(curNodePos.X + xDir, curNodePos.Y + 1));
 						}
 					}
 				}
@@ -158,6 +209,24 @@ namespace ceed::ai::path {
 
 	//------------------------------------------------------------------------------------------------//
 
+	bool cdJumpStartMap::IsForcedStraight(const cdGridCoord& pos, int xDir, int yDir) {
+		for (int side = -1; side <= 1; side += 2) {
+			cdGridCoord sideCell(pos.X + side * yDir, pos.Y + side * xDir);
+			if (m_CutCorners) {
+				// Blocked beside, open diagonally ahead.
+				if (Collides(sideCell) && Collides(cdGridCoord(sideCell.X + xDir, sideCell.Y + yDir)) == false) {
+					return true;
+				}
+			} else if (Collides(sideCell) == false && Collides(cdGridCoord(sideCell.X - xDir, sideCell.Y - yDir))) {
+				// Open beside, blocked diagonally behind.
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
 	bool cdJumpStartMap::Jump(const cdGridCoord & current,
 		int xDir, int yDir,
 		const cdGridCoord & start,
@@ -170,7 +239,7 @@ namespace ceed::ai::path {
 
 		auto stepNodePos = nextNode;
 
-		if (Collides(stepNodePos)) {
+		if (CanStep(current, GetGridDirectionIndex(xDir, yDir)) == false) {
 			return false;
 		}
 
@@ -188,10 +257,12 @@ namespace ceed::ai::path {
 			cdGridCoord tmpResult;
 
 			while (1) {
-				if ((Collides(cdGridCoord(nextNodePos.X - xDir, nextNodePos.Y + yDir)) == false &&
+				// Without corner cutting diagonal moves have no forced neighbours.
+				if (m_CutCorners &&
+					((Collides(cdGridCoord(nextNodePos.X - xDir, nextNodePos.Y + yDir)) == false &&
 					Collides(cdGridCoord(nextNodePos.X - xDir, nextNodePos.Y)) == true) ||
 					(Collides(cdGridCoord(nextNodePos.X + xDir, nextNodePos.Y - yDir)) == false &&
-					Collides(cdGridCoord(nextNodePos.X, nextNodePos.Y - yDir)) == true)) {
+					Collides(cdGridCoord(nextNodePos.X, nextNodePos.Y - yDir)) == true))) {
 					resultNode = nextNodePos;
 					return true;
 				}
@@ -202,13 +273,13 @@ namespace ceed::ai::path {
 					return true;
 				}
 
-				nextNodePos.X += xDir;
-				nextNodePos.Y += yDir;
-
-				if (Collides(nextNodePos) == true) {
+				if (CanStep(nextNodePos, GetGridDirectionIndex(xDir, yDir)) == false) {
 					return false;
 				}
 
+				nextNodePos.X += xDir;
+				nextNodePos.Y += yDir;
+
 				for (auto jumpCoord : end) {
 					if (jumpCoord.X == nextNodePos.X &&
 						jumpCoord.Y == nextNodePos.Y) {
@@ -220,10 +291,7 @@ namespace ceed::ai::path {
 		} else {
 			if (xDir == 0) {
 				while (1) {
-					if ((Collides(cdGridCoord(nextNodePos.X - 1, nextNodePos.Y)) == true &&
-						Collides(cdGridCoord(nextNodePos.X - 1, nextNodePos.Y + yDir)) == false) ||
-						(Collides(cdGridCoord(nextNodePos.X + 1, nextNodePos.Y)) == true &&
-						Collides(cdGridCoord(nextNodePos.X + 1, nextNodePos.Y + yDir)) == false)) {
+					if (IsForcedStraight(nextNodePos, 0, yDir)) {
 						resultNode = nextNodePos;
 						return true;
 					}
@@ -244,10 +312,7 @@ namespace ceed::ai::path {
 				}
 			} else if (yDir == 0) {
 				while (1) {
-					if ((Collides(cdGridCoord(nextNodePos.X, nextNodePos.Y + 1)) == true &&
-						Collides(cdGridCoord(nextNodePos.X + xDir, nextNodePos.Y + 1)) == false) ||
-						(Collides(cdGridCoord(nextNodePos.X, nextNodePos.Y - 1)) == true &&
-						Collides(cdGridCoord(nextNodePos.X + xDir, nextNodePos.Y - 1)) == false)) {
+					if (IsForcedStraight(nextNodePos, xDir, 0)) {
 						resultNode = nextNodePos;
 						return true;
 					}
@@ -281,7 +346,8 @@ namespace ceed::ai::path {
 		const cdGridCoord& start,
 		const std::vector<cdGridCoord>& end,
 		std::vector<cdGridCoord>& adjcentList) {
-		static std::vector< cdGridCoord > nearNodes;
+		// Per thread so searches can share one map.
+		thread_local std::vector< cdGridCoord > nearNodes;
 		nearNodes.clear();
 
 		Prune(astar, current, nearNodes);
@@ -293,6 +359,11 @@ namespace ceed::ai::path {
 		cdGridCoord resultNode;
 
 		auto currentNodePos = current.NodePos;
+		const cdGoalBounds* goalBounds = nullptr;
+		if (m_GoalBoundsEnabled && m_GoalBounds.Empty() == false) {
+			goalBounds = &m_GoalBounds[(currentNodePos.Y * m_NumCols + currentNodePos.X) * 8];
+		}
+
 		for (auto i = nearNodes.begin(); i != nearNodes.end(); ++i) {
 			auto nodePos = *i;
 
@@ -302,6 +373,21 @@ namespace ceed::ai::path {
 			auto xDir = std::min(std::max(-1, xDiff), 1);
 			auto yDir = std::min(std::max(-1, yDiff), 1);
 
+			// Nothing optimal leaves through this direction toward any of the goals.
+			if (goalBounds != nullptr) {
+				const auto& bounds = goalBounds[GetGridDirectionIndex(xDir, yDir)];
+				bool reachesGoal = false;
+				for (const auto& goal : end) {
+					if (bounds.Contains(goal)) {
+						reachesGoal = true;
+						break;
+					}
+				}
+				if (reachesGoal == false) {
+					continue;
+				}
+			}
+
 			if (Jump(currentNodePos, xDir, yDir, start, end, resultNode) == true) {
 				adjcentList.push_back(resultNode);
 			}
@@ -314,5 +400,96 @@ namespace ceed::ai::path {
 		return false;
 	}
 
+	//------------------------------------------------------------------------------------------------//
+	void cdJumpStartMap::BuildGoalBounds() {
+		std::vector<cdGoalBounds> goalBounds(static_cast<size_t>(m_NumCols) * m_NumRows * 8);
+
+		std::vector<f32> costs(goalBounds.size() / 8);
+		std::vector<u8> firstMoves(costs.size());
+		std::vector<GoalBoundsEntry> openList;
+		openList.reserve(costs.size());
+
+		for (int srcIdx = 0; srcIdx < m_ArraySize; ++srcIdx) {
+			cdGridCoord src(srcIdx % m_NumCols, srcIdx / m_NumCols);
+			if (Collides(src)) {
+				continue;
+			}
+
+			std::fill(costs.begin(), costs.end(), FLT_MAX);
+			std::fill(firstMoves.begin(), firstMoves.end(), u8(0));
+			openList.clear();
+
+			// Same moves as Jump, corners included.
+			costs[srcIdx] = 0;
+			for (int dir = 0; dir < 8; ++dir) {
+				cdGridCoord next(src.X + DirectionList[dir].X, src.Y + DirectionList[dir].Y);
+				if (CanStep(src, dir) == false) {
+					continue;
+				}
+				auto nextIdx = next.Y * m_NumCols + next.X;
+				costs[nextIdx] = MovementCost(src, next);
+				firstMoves[nextIdx] = u8(1 << dir);
+				openList.push_back({ costs[nextIdx], nextIdx });
+				push_heap(openList.begin(), openList.end(), std::greater<GoalBoundsEntry>());
+			}
+
+			while (openList.empty() == false) {
+				auto entry = openList.front();
+				pop_heap(openList.begin(), openList.end(), std::greater<GoalBoundsEntry>());
+				openList.pop_back();
+
+				// Stale entry, the cell got a cheaper cost after it was pushed.
+				if (entry.Cost > costs[entry.Idx]) {
+					continue;
+				}
+
+				// All the equal cost parents come out of the heap before this cell so the mask is final.
+				cdGridCoord cell(entry.Idx % m_NumCols, entry.Idx / m_NumCols);
+				auto cellMoves = firstMoves[entry.Idx];
+				auto srcBounds = &goalBounds[srcIdx * 8];
+				for (int dir = 0; dir < 8; ++dir) {
+					if (cellMoves & (1 << dir)) {
+						srcBounds[dir].Extend(cell);
+					}
+				}
+
+				for (int dir = 0; dir < 8; ++dir) {
+					cdGridCoord next(cell.X + DirectionList[dir].X, cell.Y + DirectionList[dir].Y);
+					if (CanStep(cell, dir) == false) {
+						continue;
+					}
+					auto nextIdx = next.Y * m_NumCols + next.X;
+					if (nextIdx == srcIdx) {
+						continue;
+					}
+
+					auto cost = entry.Cost + MovementCost(cell, next);
+					if (cost < costs[nextIdx] - kGoalBoundsTieEpsilon) {
+						costs[nextIdx] = cost;
+						firstMoves[nextIdx] = cellMoves;
+						openList.push_back({ cost, nextIdx });
+						push_heap(openList.begin(), openList.end(), std::greater<GoalBoundsEntry>());
+					} else if (cost <= costs[nextIdx] + kGoalBoundsTieEpsilon) {
+						firstMoves[nextIdx] |= cellMoves;
+					}
+				}
+			}
+		}
+
+		m_GoalBounds.Own(std::move(goalBounds));
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdJumpStartMap::ClearGoalBounds() {
+		m_GoalBounds = cdGridLayer<cdGoalBounds>();
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	const cdGoalBounds& cdJumpStartMap::GetGoalBounds(const cdGridCoord& cell, int direction) const {
+		return m_GoalBounds[(cell.Y * m_NumCols + cell.X) * 8 + direction];
+	}
+
 	//------------------------------------------------------------------------------------------------//
 }
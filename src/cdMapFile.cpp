@@ -0,0 +1,480 @@
+/*!
+ * \file cdMapFile.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "cdMapFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr u64 kSectionAlignment = 64;
+
+inline u64 AlignSection(u64 offset) {
+    return (offset + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+}
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdMapFile::cdMapFile()
+		: m_Data(nullptr)
+		, m_Size(0)
+#ifdef _WIN32
+		, m_File(INVALID_HANDLE_VALUE)
+		, m_Mapping(nullptr) {
+#else
+		, m_File(-1) {
+#endif
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdMapFile::~cdMapFile() {
+		Close();
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdMapFile::Open(const char* path) {
+		Close();
+
+#ifdef _WIN32
+		m_File = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_File == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (GetFileSizeEx(m_File, &fileSize) == FALSE || fileSize.QuadPart == 0) {
+			Close();
+			return false;
+		}
+
+		m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_Mapping == nullptr) {
+			Close();
+			return false;
+		}
+
+		m_Data = static_cast<const u8*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+		m_Size = static_cast<size_t>(fileSize.QuadPart);
+#else
+		m_File = open(path, O_RDONLY);
+		MapView();
+#endif
+
+		if (m_Data == nullptr || Validate() == false) {
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdMapFile::OpenShared(const char* name) {
+		Close();
+
+#ifdef _WIN32
+		return false;
+#else
+		m_File = shm_open(name, O_RDONLY, 0);
+		MapView();
+
+		if (m_Data == nullptr || Validate() == false) {
+			Close();
+			return false;
+		}
+
+		return true;
+#endif
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+#ifndef _WIN32
+	void cdMapFile::MapView() {
+		struct stat fileStat;
+		if (m_File < 0 || fstat(m_File, &fileStat) != 0 || fileStat.st_size == 0) {
+			return;
+		}
+
+		auto data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, m_File, 0);
+		if (data != MAP_FAILED) {
+			m_Data = static_cast<const u8*>(data);
+			m_Size = static_cast<size_t>(fileStat.st_size);
+		}
+	}
+#endif
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdMapFile::Close() {
+#ifdef _WIN32
+		if (m_Data != nullptr) {
+			UnmapViewOfFile(m_Data);
+		}
+		if (m_Mapping != nullptr) {
+			CloseHandle(m_Mapping);
+			m_Mapping = nullptr;
+		}
+		if (m_File != INVALID_HANDLE_VALUE) {
+			CloseHandle(m_File);
+			m_File = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (m_Data != nullptr) {
+			munmap(const_cast<u8*>(m_Data), m_Size);
+		}
+		if (m_File >= 0) {
+			close(m_File);
+			m_File = -1;
+		}
+#endif
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdMapFile::Validate() const {
+		if (m_Size < sizeof(cdMapFileHeader)) {
+			return false;
+		}
+
+		// Pairs with the store CreateShared publishes a segment with.
+		const auto header = GetHeader();
+		const auto magic = std::atomic_ref<u32>(const_cast<u32&>(header->Magic)).load(std::memory_order_acquire);
+		if (magic != k_MapFileMagic || header->Version != k_MapFileVersion ||
+			header->NumCols <= 0 || header->NumRows <= 0 || header->NumSections > k_MapFileMaxSections) {
+			return false;
+		}
+
+		const u64 numCells = static_cast<u64>(header->NumCols) * static_cast<u64>(header->NumRows);
+		const u64 occupancySize = static_cast<u64>((header->NumCols + 63) / 64) * header->NumRows * sizeof(u64);
+
+		bool hasOccupancy = false;
+		bool hasThreat = false;
+		for (u32 i = 0; i < header->NumSections; ++i) {
+			const auto& section = header->Sections[i];
+			if (section.Offset % kSectionAlignment != 0 || section.Offset > m_Size ||
+				section.Size > m_Size - section.Offset) {
+				return false;
+			}
+
+			u64 expected = 0;
+			switch (section.Type) {
+				case SECTION_OCCUPANCY:
+					expected = occupancySize;
+					hasOccupancy = true;
+					break;
+				case SECTION_THREAT:
+					expected = numCells;
+					hasThreat = true;
+					break;
+				case SECTION_NEIGHBOUR_MASKS:
+				case SECTION_CLEARANCE:
+					expected = numCells;
+					break;
+				case SECTION_GOAL_BOUNDS:
+					// Bounds only hold for the agent size, corner rule and diagonal length they were built with.
+					if (section.Param == 0 || section.Param2 > static_cast<u32>(cdCornerRule::NEVER) ||
+						(section.ParamF > 0.0f) == false) {
+						return false;
+					}
+					expected = numCells * 8 * sizeof(cdGoalBounds);
+					break;
+				default:
+					continue;
+			}
+
+			if (section.Size != expected) {
+				return false;
+			}
+		}
+
+		return hasOccupancy && hasThreat;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	const cdMapFileHeader& cdMapFile::GetOpenHeader(const cdMapFile* file) {
+		static const cdMapFileHeader k_EmptyHeader = {};
+		return file != nullptr && file->IsOpen() ? *file->GetHeader() : k_EmptyHeader;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	const cdMapFileSection* cdMapFile::FindSection(u32 type) const {
+		if (m_Data == nullptr) {
+			return nullptr;
+		}
+
+		const auto header = GetHeader();
+		for (u32 i = 0; i < header->NumSections; ++i) {
+			if (header->Sections[i].Type == type) {
+				return &header->Sections[i];
+			}
+		}
+		return nullptr;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	const void* cdMapFile::GetSection(u32 type, size_t& size) const {
+		auto section = FindSection(type);
+		if (section == nullptr) {
+			size = 0;
+			return nullptr;
+		}
+
+		size = static_cast<size_t>(section->Size);
+		return m_Data + section->Offset;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdMapFile::BuildImage(const cdGridMap& map, u32 flags, cdImage& image) {
+		auto& header = image.Header;
+		memset(&header, 0, sizeof(header));
+		header.Magic = k_MapFileMagic;
+		header.Version = k_MapFileVersion;
+		header.NumCols = map.m_NumCols;
+		header.NumRows = map.m_NumRows;
+		header.DimensionX = map.m_MapDimension.x;
+		header.DimensionY = map.m_MapDimension.y;
+		header.ThreatScale = map.m_ThreatScale;
+
+		auto addSection = [&image](u32 type, const void* data, u64 size, u32 param = 0, u32 param2 = 0,
+			f32 paramF = 0.0f) {
+			auto& section = image.Header.Sections[image.Header.NumSections];
+			section.Type = type;
+			section.Param = param;
+			section.Param2 = param2;
+			section.ParamF = paramF;
+			section.Size = size;
+			image.SectionData[image.Header.NumSections++] = data;
+		};
+
+		const u64 numCells = static_cast<u64>(map.m_ArraySize);
+		const void* occupancyData = map.m_Occupancy.Data();
+		const void* threatData = map.m_ThreatLayer.Data();
+		const void* masksData = map.m_NeighbourMasks.Data();
+		const void* clearanceData = map.m_Clearance.Data();
+
+		// The file is always row major, other layouts are written from row major copies.
+		if (map.m_Layout != cdCellLayout::ROW_MAJOR) {
+			image.Occupancy.assign(map.GetOccupancySize(cdCellLayout::ROW_MAJOR), 0);
+			image.Threat.resize(numCells);
+			image.Masks.resize(numCells);
+			image.Clearance.resize(numCells);
+			for (int y = 0; y < map.m_NumRows; ++y) {
+				for (int x = 0; x < map.m_NumCols; ++x) {
+					auto from = map.GetLayerIndex(x, y);
+					auto to = map.GetLayerIndex(x, y, cdCellLayout::ROW_MAJOR);
+					if (map.IsBlocked(x, y)) {
+						image.Occupancy[map.GetOccupancyWord(x, y, cdCellLayout::ROW_MAJOR)] |=
+							u64(1) << map.GetOccupancyBit(x, y, cdCellLayout::ROW_MAJOR);
+					}
+					image.Threat[to] = map.m_ThreatLayer[from];
+					image.Masks[to] = map.m_NeighbourMasks[from];
+					image.Clearance[to] = map.m_Clearance[from];
+				}
+			}
+			occupancyData = image.Occupancy.data();
+			threatData = image.Threat.data();
+			masksData = image.Masks.data();
+			clearanceData = image.Clearance.data();
+		}
+
+		addSection(SECTION_OCCUPANCY, occupancyData, map.GetOccupancySize(cdCellLayout::ROW_MAJOR) * sizeof(u64));
+		addSection(SECTION_THREAT, threatData, numCells);
+		if (flags & WRITE_NEIGHBOUR_MASKS) {
+			addSection(SECTION_NEIGHBOUR_MASKS, masksData, numCells);
+		}
+		if (flags & WRITE_CLEARANCE) {
+			addSection(SECTION_CLEARANCE, clearanceData, numCells);
+		}
+		if ((flags & WRITE_GOAL_BOUNDS) && map.HasGoalBounds()) {
+			addSection(SECTION_GOAL_BOUNDS, map.m_GoalBounds.Data(), map.m_GoalBounds.Size() * sizeof(cdGoalBounds),
+				static_cast<u32>(map.m_GoalBoundsAgentSize), static_cast<u32>(map.m_GoalBoundsCornerRule),
+				map.m_GoalBoundsDiagonalStepLength);
+		}
+
+		u64 offset = AlignSection(sizeof(header));
+		for (u32 i = 0; i < header.NumSections; ++i) {
+			header.Sections[i].Offset = offset;
+			offset = AlignSection(offset + header.Sections[i].Size);
+		}
+		image.Size = offset;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdMapFile::Write(const char* path, const cdGridMap& map, u32 flags) {
+		cdImage image;
+		BuildImage(map, flags, image);
+		const auto& header = image.Header;
+
+		auto file = fopen(path, "wb");
+		if (file == nullptr) {
+			return false;
+		}
+
+		static const u8 padding[kSectionAlignment] = {};
+		bool result = fwrite(&header, sizeof(header), 1, file) == 1;
+		u64 written = sizeof(header);
+		for (u32 i = 0; i < header.NumSections && result; ++i) {
+			const auto& section = header.Sections[i];
+			result = fwrite(padding, 1, static_cast<size_t>(section.Offset - written), file) == section.Offset - written &&
+				fwrite(image.SectionData[i], 1, static_cast<size_t>(section.Size), file) == section.Size;
+			written = section.Offset + section.Size;
+		}
+
+		return fclose(file) == 0 && result;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdMapFile::CreateShared(const char* name, const cdGridMap& map, u32 flags) {
+#ifdef _WIN32
+		return false;
+#else
+		cdImage image;
+		BuildImage(map, flags, image);
+
+		// Replace rather than resize, processes still on the old segment keep their pages.
+		shm_unlink(name);
+		int segment = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+		if (segment < 0) {
+			return false;
+		}
+
+		const auto size = static_cast<size_t>(image.Size);
+		auto data = ftruncate(segment, static_cast<off_t>(size)) == 0 ?
+			mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, segment, 0) : MAP_FAILED;
+		close(segment);
+		if (data == MAP_FAILED) {
+			shm_unlink(name);
+			return false;
+		}
+
+		// Fresh segments are zero filled, so until Magic lands a reader fails validation. It goes in
+		// last with a release store, a reader that sees it sees everything written before it.
+		auto bytes = static_cast<u8*>(data);
+		for (u32 i = 0; i < image.Header.NumSections; ++i) {
+			const auto& section = image.Header.Sections[i];
+			memcpy(bytes + section.Offset, image.SectionData[i], static_cast<size_t>(section.Size));
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		constexpr size_t headerRest = offsetof(cdMapFileHeader, Version);
+		memcpy(bytes + headerRest, reinterpret_cast<const u8*>(&image.Header) + headerRest,
+			sizeof(image.Header) - headerRest);
+		std::atomic_ref<u32>(reinterpret_cast<cdMapFileHeader*>(bytes)->Magic).store(k_MapFileMagic,
+			std::memory_order_release);
+
+		munmap(data, size);
+		return true;
+#endif
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdMapFile::RemoveShared(const char* name) {
+#ifdef _WIN32
+		return false;
+#else
+		return shm_unlink(name) == 0;
+#endif
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdMapFile::Write(const char* path, int cols, int rows, const cdPoint2f& dimension,
+		f32 threatScale, const RowFunc& getRow) {
+		if (cols <= 0 || rows <= 0) {
+			return false;
+		}
+
+		cdMapFileHeader header;
+		memset(&header, 0, sizeof(header));
+		header.Magic = k_MapFileMagic;
+		header.Version = k_MapFileVersion;
+		header.NumCols = cols;
+		header.NumRows = rows;
+		header.DimensionX = dimension.x;
+		header.DimensionY = dimension.y;
+		header.ThreatScale = threatScale;
+		header.NumSections = 2;
+
+		const int stride = (cols + 63) / 64;
+		auto& occupancy = header.Sections[0];
+		occupancy.Type = SECTION_OCCUPANCY;
+		occupancy.Offset = AlignSection(sizeof(header));
+		occupancy.Size = static_cast<u64>(stride) * rows * sizeof(u64);
+		auto& threat = header.Sections[1];
+		threat.Type = SECTION_THREAT;
+		threat.Offset = AlignSection(occupancy.Offset + occupancy.Size);
+		threat.Size = static_cast<u64>(cols) * rows;
+
+		auto file = fopen(path, "wb");
+		if (file == nullptr) {
+			return false;
+		}
+
+		static const u8 padding[kSectionAlignment] = {};
+		std::vector<cdGridCell> cells(cols);
+		std::vector<u64> words(stride);
+		std::vector<u8> bytes(cols);
+		const f32 toQuantized = threatScale > 0 ? 255.0f / threatScale : 0.0f;
+
+		const auto headerGap = static_cast<size_t>(occupancy.Offset - sizeof(header));
+		bool result = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(padding, 1, headerGap, file) == headerGap;
+		for (int y = 0; y < rows && result; ++y) {
+			getRow(y, cells.data());
+			std::fill(words.begin(), words.end(), 0);
+			for (int x = 0; x < cols; ++x) {
+				if (cells[x].Type == cdGridCell::CellType::BLOCKED) {
+					words[x >> 6] |= u64(1) << (x & 63);
+				}
+			}
+			result = fwrite(words.data(), sizeof(u64), words.size(), file) == words.size();
+		}
+
+		const auto sectionGap = static_cast<size_t>(threat.Offset - (occupancy.Offset + occupancy.Size));
+		result = result && fwrite(padding, 1, sectionGap, file) == sectionGap;
+		for (int y = 0; y < rows && result; ++y) {
+			getRow(y, cells.data());
+			for (int x = 0; x < cols; ++x) {
+				auto value = cells[x].Threat * toQuantized + 0.5f;
+				bytes[x] = static_cast<u8>(std::min(std::max(value, 0.0f), 255.0f));
+			}
+			result = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+		}
+
+		return fclose(file) == 0 && result;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
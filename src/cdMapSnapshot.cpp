@@ -0,0 +1,238 @@
+/*!
+ * \file cdMapSnapshot.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#include <algorithm>
+#include <bit>
+#include <math.h>
+#include <span>
+
+#include "cdHeuristics.hpp"
+#include "cdMapSnapshot.hpp"
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdMapSnapshot::cdMapSnapshot(const cdGridMap& map, const cdMapSnapshot* previous)
+		: cdJumpStartMap(fastdelegate::MakeDelegate(this, &cdMapSnapshot::CellCollides)
+		, fastdelegate::MakeDelegate(this, &cdMapSnapshot::GetHeuristics)
+		, fastdelegate::MakeDelegate(this, &cdMapSnapshot::GetMovementCost)
+		, map.GetTieType(), map.GetNumRows(), map.GetNumCols())
+		, m_Version(map.GetVersion())
+		, m_AgentSize(map.GetAgentSize())
+		, m_SearchMode(map.GetSearchMode())
+		, m_CornerRule(map.GetCornerRule())
+		, m_CostMode(map.GetCostMode())
+		, m_DiagonalStepLength(map.GetDiagonalStepLength())
+		, m_NumChunkCols(map.GetNumChunkCols())
+		, m_RetireEpoch(0) {
+		for (int i = 0; i < 256; ++i) {
+			m_ThreatCostTable[i] = map.GetThreatCost(static_cast<u8>(i));
+		}
+		m_CutCorners = m_CornerRule == cdCornerRule::ALWAYS;
+
+		if (m_SearchMode != cdSearchMode::JUMP_POINT) {
+			GetSucessors = fastdelegate::MakeDelegate(this, &cdMapSnapshot::GetGridSucessorList);
+		}
+		if (m_SearchMode == cdSearchMode::ANY_ANGLE) {
+			AnyAngleLineOfSight = fastdelegate::MakeDelegate(this, &cdMapSnapshot::HasLineOfSight);
+		}
+
+		constexpr int chunkSize = 1 << cdGridMap::k_ChunkShift;
+		m_Chunks.resize(map.GetNumChunks());
+		for (int chunk = 0; chunk < map.GetNumChunks(); ++chunk) {
+			const auto version = map.GetChunkVersion(chunk);
+			// The neighbour masks are for the agent size, another one needs them copied again.
+			if (previous != nullptr && previous->m_AgentSize == m_AgentSize && previous->m_Chunks[chunk]->Version == version) {
+				m_Chunks[chunk] = previous->m_Chunks[chunk];
+				continue;
+			}
+
+			// Value initialised, so the cells past the map edge are zero.
+			auto data = std::make_shared<cdMapSnapshotChunk>();
+			const int x0 = (chunk % m_NumChunkCols) * chunkSize;
+			const int y0 = (chunk / m_NumChunkCols) * chunkSize;
+			const int numCols = std::min(chunkSize, m_NumCols - x0);
+			const int numRows = std::min(chunkSize, m_NumRows - y0);
+			data->Version = version;
+
+			// The map's layout may be tiled, so each row is gathered before it is copied in.
+			std::array<u8, chunkSize> clearance, masks, threat;
+			for (int row = 0; row < numRows; ++row) {
+				for (int col = 0; col < numCols; ++col) {
+					cdGridCoord cell(x0 + col, y0 + row);
+					clearance[col] = map.GetClearance(cell);
+					masks[col] = map.GetAgentNeighbourMask(cell);
+					threat[col] = map.GetQuantizedThreat(cell);
+				}
+				const size_t offset = static_cast<size_t>(row) << cdGridMap::k_ChunkShift;
+				std::copy_n(clearance.begin(), numCols, std::span(data->Clearance).subspan(offset, chunkSize).begin());
+				std::copy_n(masks.begin(), numCols, std::span(data->NeighbourMasks).subspan(offset, chunkSize).begin());
+				std::copy_n(threat.begin(), numCols, std::span(data->Threat).subspan(offset, chunkSize).begin());
+			}
+			m_Chunks[chunk] = std::move(data);
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdMapSnapshot::CellCollides(const cdGridCoord& cell) const {
+		if (cell.X < 0 || cell.Y < 0 || cell.X >= m_NumCols || cell.Y >= m_NumRows) {
+			return true;
+		}
+		return GetChunk(cell.X, cell.Y).Clearance[GetChunkCellIndex(cell.X, cell.Y)] < m_AgentSize;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdMapSnapshot::HasLineOfSight(const cdGridCoord& from, const cdGridCoord& to) const {
+		return WalkSupercover(from, to, [this](const cdGridCoord& cell) {
+			return CellCollides(cell) == false;
+		});
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f32 cdMapSnapshot::GetHeuristics(const cdGridCoord& cell1,
+		const cdGridCoord& cell2, const std::vector<cdGridCoord>& cellList) {
+		if (m_SearchMode == cdSearchMode::ANY_ANGLE) {
+			return GetAnyAngleHeuristics(m_TieType, cell1, cell2, cellList);
+		}
+		return GetOctileHeuristics(m_TieType, cell1, cell2, cellList, m_DiagonalStepLength);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f32 cdMapSnapshot::GetMovementCost(const cdGridCoord& c1, const cdGridCoord& c2) {
+		// Any-angle legs pay no threat, as on the map.
+		if (m_SearchMode == cdSearchMode::ANY_ANGLE) {
+			return EuclideanDistance(static_cast<f32>(c1.X), static_cast<f32>(c1.Y),
+				static_cast<f32>(c2.X), static_cast<f32>(c2.Y));
+		}
+
+		// Jump point legs pay their octile length, as on the map.
+		f32 distance = GetOctileLegLength(c1, c2, m_DiagonalStepLength);
+		if (m_CostMode == cdCostMode::THREAT_WEIGHTED) {
+			distance *= m_ThreatCostTable[GetQuantizedThreat(c2)];
+		}
+
+		return distance;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdMapSnapshot::GetGridSucessorList(const cdAStar<cdGridCoord>* astar,
+		const cdNode<cdGridCoord>& current,
+		const cdGridCoord& start,
+		const std::vector<cdGridCoord>& end,
+		std::vector<cdGridCoord>& adjcentList) {
+		const auto& pos = current.NodePos;
+
+		// One read whatever the agent size, the chunk holds the masks for it.
+		const u8 mask = GetChunk(pos.X, pos.Y).NeighbourMasks[GetChunkCellIndex(pos.X, pos.Y)];
+
+		// Any-angle legs may not touch a blocked cell at a corner, so their single steps may not either.
+		unsigned moves = GetAllowedMoves(mask, m_SearchMode == cdSearchMode::ANY_ANGLE ? cdCornerRule::NEVER : m_CornerRule);
+		while (moves != 0) {
+			auto dir = std::countr_zero(moves);
+			moves &= moves - 1;
+			adjcentList.push_back(cdGridCoord(pos.X + k_GridDirections[dir].X, pos.Y + k_GridDirections[dir].Y));
+		}
+
+		return adjcentList.empty() == false;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdSnapshotPublisher::cdSnapshotPublisher(cdGridMap& map)
+		: m_Map(map)
+		, m_Current(nullptr)
+		, m_Epoch(0)
+		, m_NumPublished(0) {
+		for (auto& slot : m_Readers) {
+			slot.Epoch.store(k_IdleEpoch, std::memory_order_relaxed);
+			slot.InUse.store(false, std::memory_order_relaxed);
+		}
+
+		Publish();
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdSnapshotPublisher::~cdSnapshotPublisher() {
+		m_Retired.clear();
+		delete m_Current.load(std::memory_order_relaxed);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdSnapshotPublisher::Publish() {
+		auto previous = m_Current.load(std::memory_order_relaxed);
+		auto next = new cdMapSnapshot(m_Map, previous);
+		++m_NumPublished;
+
+		// A reader that still got the previous snapshot announced an epoch no later than the one
+		// read here, so the snapshot is free once every active reader is past it.
+		m_Current.exchange(next, std::memory_order_seq_cst);
+		if (previous != nullptr) {
+			previous->m_RetireEpoch = m_Epoch.fetch_add(1, std::memory_order_seq_cst);
+			m_Retired.emplace_back(previous);
+		}
+
+		Reclaim();
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	size_t cdSnapshotPublisher::Reclaim() {
+		u64 oldestActive = k_IdleEpoch;
+		for (const auto& slot : m_Readers) {
+			oldestActive = std::min(oldestActive, slot.Epoch.load(std::memory_order_seq_cst));
+		}
+
+		auto kept = std::remove_if(m_Retired.begin(), m_Retired.end(),
+			[oldestActive](const std::unique_ptr<cdMapSnapshot>& snapshot) {
+				return snapshot->m_RetireEpoch < oldestActive;
+			});
+		auto freed = static_cast<size_t>(m_Retired.end() - kept);
+		m_Retired.erase(kept, m_Retired.end());
+		return freed;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	int cdSnapshotPublisher::AddReader() {
+		for (int reader = 0; reader < k_MaxReaders; ++reader) {
+			bool expected = false;
+			if (m_Readers[reader].InUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+				return reader;
+			}
+		}
+		return -1;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdSnapshotPublisher::RemoveReader(int reader) {
+		m_Readers[reader].Epoch.store(k_IdleEpoch, std::memory_order_release);
+		m_Readers[reader].InUse.store(false, std::memory_order_release);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdMapSnapshot* cdSnapshotPublisher::Acquire(int reader) {
+		// Announce the epoch before looking at the snapshot, both sequentially consistent so the
+		// writer cannot miss the announcement once it has swapped the snapshot out.
+		m_Readers[reader].Epoch.store(m_Epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+		return m_Current.load(std::memory_order_seq_cst);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdSnapshotPublisher::Release(int reader) {
+		m_Readers[reader].Epoch.store(k_IdleEpoch, std::memory_order_release);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
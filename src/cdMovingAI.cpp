@@ -0,0 +1,147 @@
+/*!
+ * \file cdMovingAI.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "cdMovingAI.hpp"
+
+namespace {
+inline bool IsMovingAIOpen(char terrain) {
+    return terrain == '.' || terrain == 'G' || terrain == 'S';
+}
+}
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool LoadMovingAIMap(const char* path, cdGridCellList& cells, int& cols, int& rows) {
+		std::ifstream file(path);
+		if (!file) {
+			return false;
+		}
+
+		cols = 0;
+		rows = 0;
+
+		std::string key;
+		while (file >> key) {
+			if (key == "height") {
+				file >> rows;
+			} else if (key == "width") {
+				file >> cols;
+			} else if (key == "type") {
+				file >> key;
+			} else if (key == "map") {
+				break;
+			} else {
+				return false;
+			}
+		}
+
+		if (cols <= 0 || rows <= 0) {
+			return false;
+		}
+
+		cells.assign(static_cast<size_t>(cols) * rows, cdGridCell());
+
+		std::string line;
+		std::getline(file, line);
+		for (int y = 0; y < rows; ++y) {
+			if (!std::getline(file, line) || static_cast<int>(line.size()) < cols) {
+				return false;
+			}
+			for (int x = 0; x < cols; ++x) {
+				if (IsMovingAIOpen(line[x]) == false) {
+					cells[y * cols + x].Type = cdGridCell::CellType::BLOCKED;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	std::unique_ptr<cdGridMap> LoadMovingAIMap(const char* path) {
+		cdGridCellList cells;
+		int cols = 0;
+		int rows = 0;
+		if (LoadMovingAIMap(path, cells, cols, rows) == false) {
+			return nullptr;
+		}
+
+		return std::make_unique<cdGridMap>(std::move(cells), cols, rows,
+			cdPoint2f(static_cast<f32>(cols), static_cast<f32>(rows)));
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool LoadMovingAIScenarios(const char* path, std::vector<cdMovingAIScenario>& scenarios) {
+		std::ifstream file(path);
+		if (!file) {
+			return false;
+		}
+
+		std::string line;
+		if (!std::getline(file, line) || line.rfind("version", 0) != 0) {
+			return false;
+		}
+
+		while (std::getline(file, line)) {
+			if (line.empty() || line[0] == '\r') {
+				continue;
+			}
+
+			std::istringstream stream(line);
+			cdMovingAIScenario scenario;
+			if (!(stream >> scenario.Bucket >> scenario.MapName >> scenario.MapWidth >> scenario.MapHeight >>
+				scenario.Start.X >> scenario.Start.Y >> scenario.Goal.X >> scenario.Goal.Y >>
+				scenario.OptimalLength)) {
+				return false;
+			}
+			scenarios.push_back(scenario);
+		}
+
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f64 GetOctilePathLength(const std::vector<cdGridCoord>& path) {
+		f64 length = 0;
+		for (size_t i = 1; i < path.size(); ++i) {
+			auto dx = abs(path[i].X - path[i - 1].X);
+			auto dy = abs(path[i].Y - path[i - 1].Y);
+			auto diagonal = std::min(dx, dy);
+			length += (std::max(dx, dy) - diagonal) + diagonal * sqrt(2.0);
+		}
+		return length;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool SetMovingAISearchMode(cdGridMap& map, cdSearchMode mode) {
+		map.SetSearchMode(mode);
+		map.SetCornerRule(cdCornerRule::NEVER);
+		map.SetDiagonalStepLength(k_MovingAIDiagonalLength);
+		return mode != cdSearchMode::ANY_ANGLE;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f64 GetPathLengthError(const std::vector<cdGridCoord>& path, f64 optimalLength) {
+		if (optimalLength <= 0) {
+			return 0;
+		}
+		return (GetOctilePathLength(path) - optimalLength) / optimalLength;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
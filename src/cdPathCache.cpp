@@ -0,0 +1,154 @@
+/*!
+ * \file cdPathCache.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#include <algorithm>
+
+#include "cdPathCache.hpp"
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdPathCache::cdPathCache(cdGridMap& map, size_t memoryBudget)
+		: m_Map(map)
+		, m_MemoryBudget(memoryBudget)
+		, m_MemoryUsage(0)
+		, m_NumHits(0)
+		, m_NumMisses(0)
+		, m_NumInvalidations(0) {
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	size_t cdPathCache::GetMemoryUsage(const cdCachedPath& cached) {
+		return sizeof(cdCachedPath) + cached.Path.capacity() * sizeof(cdGridCoord) +
+			cached.Tags.capacity() * sizeof(cdChunkTag);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdPathCache::IsValid(const cdCachedPath& cached) const {
+		if (cached.SearchMode != m_Map.GetSearchMode() || cached.CornerRule != m_Map.GetCornerRule() ||
+			cached.CostMode != m_Map.GetCostMode() || cached.AgentSize != m_Map.GetAgentSize() ||
+			cached.DiagonalStepLength != m_Map.GetDiagonalStepLength()) {
+			return false;
+		}
+		// The cost table only prices threat weighted paths.
+		if (cached.CostMode == cdCostMode::THREAT_WEIGHTED &&
+			(cached.ThreatWeight != m_Map.GetThreatWeight() || cached.ThreatScale != m_Map.GetThreatScale())) {
+			return false;
+		}
+
+		for (const auto& tag : cached.Tags) {
+			if (m_Map.GetChunkVersion(tag.Chunk) != tag.Version) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdPathCache::Erase(std::list<cdCachedPath>::iterator cached) {
+		m_MemoryUsage -= GetMemoryUsage(*cached);
+		m_Lookup.erase(cached->Key);
+		m_Paths.erase(cached);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdPathCache::TagPath(cdCachedPath& cached) {
+		// Jump point paths skip cells, walk each leg. Diagonal steps take in both corner cells.
+		m_Chunks.clear();
+		m_Chunks.push_back(m_Map.GetChunkIndex(cached.Path.front()));
+		for (size_t i = 0; i + 1 < cached.Path.size(); ++i) {
+			WalkSupercover(cached.Path[i], cached.Path[i + 1], [this](const cdGridCoord& cell) {
+				m_Chunks.push_back(m_Map.GetChunkIndex(cell));
+				return true;
+			});
+		}
+
+		std::sort(m_Chunks.begin(), m_Chunks.end());
+		m_Chunks.erase(std::unique(m_Chunks.begin(), m_Chunks.end()), m_Chunks.end());
+		cached.Tags.clear();
+		cached.Tags.reserve(m_Chunks.size());
+		for (auto chunk : m_Chunks) {
+			cached.Tags.push_back({ chunk, m_Map.GetChunkVersion(chunk) });
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdPathCache::FindPath(cdAStar<cdGridCoord>& aStar, const cdGridCoord& start, const cdGridCoord& goal,
+		std::vector<cdGridCoord>& path) {
+		// Out of the map the search answers on its own.
+		if (m_Map.CellCollides(start) || m_Map.CellCollides(goal)) {
+			++m_NumMisses;
+			return aStar.FindPath(start, goal, &m_Map, path);
+		}
+
+		const auto key = GetKey(start, goal);
+		auto found = m_Lookup.find(key);
+		if (found != m_Lookup.end()) {
+			if (IsValid(*found->second)) {
+				++m_NumHits;
+				m_Paths.splice(m_Paths.begin(), m_Paths, found->second);
+				path.insert(path.end(), found->second->Path.begin(), found->second->Path.end());
+				return true;
+			}
+			++m_NumInvalidations;
+			Erase(found->second);
+		}
+
+		++m_NumMisses;
+		const auto first = path.size();
+		if (aStar.FindPath(start, goal, &m_Map, path) == false) {
+			return false;
+		}
+
+		cdCachedPath cached;
+		cached.Key = key;
+		cached.Path.assign(path.begin() + first, path.end());
+		cached.SearchMode = m_Map.GetSearchMode();
+		cached.CornerRule = m_Map.GetCornerRule();
+		cached.CostMode = m_Map.GetCostMode();
+		cached.AgentSize = m_Map.GetAgentSize();
+		cached.ThreatWeight = m_Map.GetThreatWeight();
+		cached.ThreatScale = m_Map.GetThreatScale();
+		cached.DiagonalStepLength = m_Map.GetDiagonalStepLength();
+		TagPath(cached);
+
+		const auto usage = GetMemoryUsage(cached);
+		if (usage > m_MemoryBudget) {
+			return true;
+		}
+		while (m_MemoryUsage + usage > m_MemoryBudget) {
+			Erase(std::prev(m_Paths.end()));
+		}
+
+		m_MemoryUsage += usage;
+		m_Paths.push_front(std::move(cached));
+		m_Lookup[key] = m_Paths.begin();
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdPathCache::SetMemoryBudget(size_t memoryBudget) {
+		m_MemoryBudget = memoryBudget;
+		while (m_MemoryUsage > m_MemoryBudget) {
+			Erase(std::prev(m_Paths.end()));
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdPathCache::Clear() {
+		m_Paths.clear();
+		m_Lookup.clear();
+		m_MemoryUsage = 0;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
@@ -0,0 +1,222 @@
+/*!
+ * \file cdQueryRecorder.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+
+#include <algorithm>
+#include <string.h>
+
+#include "cdQueryRecorder.hpp"
+
+namespace {
+constexpr size_t kFlushSize = 64 * 1024;
+}
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdQueryRecorder::cdQueryRecorder()
+		: m_File(nullptr)
+		, m_NumRecords(0) {
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdQueryRecorder::~cdQueryRecorder() {
+		Close();
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdQueryRecorder::Open(const char* path) {
+		Close();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_File = fopen(path, "wb");
+		if (m_File == nullptr) {
+			return false;
+		}
+
+		cdQueryLogHeader header = { k_QueryLogMagic, k_QueryLogVersion };
+		if (fwrite(&header, sizeof(header), 1, m_File) != 1) {
+			fclose(m_File);
+			m_File = nullptr;
+			return false;
+		}
+
+		m_NumRecords = 0;
+		m_Buffer.reserve(kFlushSize + sizeof(cdQueryLogEntry));
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdQueryRecorder::Close() {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_File == nullptr) {
+			return;
+		}
+
+		Flush();
+		fclose(m_File);
+		m_File = nullptr;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdQueryRecorder::Flush() {
+		if (m_Buffer.empty() == false) {
+			fwrite(m_Buffer.data(), 1, m_Buffer.size(), m_File);
+			m_Buffer.clear();
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdQueryRecorder::Attach(cdAStar<cdGridCoord>& aStar) {
+		aStar.SetQueryHook(fastdelegate::MakeDelegate(this, &cdQueryRecorder::OnQuery));
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdQueryRecorder::Detach(cdAStar<cdGridCoord>& aStar) {
+		aStar.SetQueryHook(cdAStar<cdGridCoord>::QueryFunc());
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdQueryRecorder::OnQuery(const cdAStar<cdGridCoord>* aStar,
+		const cdGridCoord& start,
+		const std::vector<cdGridCoord>& goals,
+		const cdAStarMap<cdGridCoord>* map,
+		bool found,
+		f64 latencyUs) {
+		cdQueryRecord record;
+		record.MapId = 0;
+		record.MapVersion = 0;
+		record.Start = start;
+		record.Goals = goals;
+		record.SearchMode = cdSearchMode::JUMP_POINT;
+		record.CostMode = cdCostMode::DISTANCE;
+		record.CornerRule = cdCornerRule::ALWAYS;
+		record.AgentSize = 1;
+		record.ThreatWeight = 1.0f;
+		record.ThreatScale = 1.0f;
+		record.DiagonalStepLength = GetGridStepLength(4);
+		record.LineOfSightShortcut = true;
+		record.Found = found;
+		record.Expansions = static_cast<u32>(aStar->GetNumExpansions());
+		record.LatencyUs = static_cast<f32>(latencyUs);
+
+		if (auto gridMap = dynamic_cast<const cdGridMap*>(map)) {
+			record.MapId = gridMap->GetMapId();
+			record.MapVersion = gridMap->GetVersion();
+			record.SearchMode = gridMap->GetSearchMode();
+			record.CostMode = gridMap->GetCostMode();
+			record.CornerRule = gridMap->GetCornerRule();
+			record.AgentSize = gridMap->GetAgentSize();
+			record.ThreatWeight = gridMap->GetThreatWeight();
+			record.ThreatScale = gridMap->GetThreatScale();
+			record.DiagonalStepLength = gridMap->GetDiagonalStepLength();
+			record.LineOfSightShortcut = gridMap->GetLineOfSightShortcut();
+		}
+
+		Record(record);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdQueryRecorder::Record(const cdQueryRecord& record) {
+		cdQueryLogEntry entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.MapId = record.MapId;
+		entry.MapVersion = record.MapVersion;
+		entry.StartX = record.Start.X;
+		entry.StartY = record.Start.Y;
+		entry.LatencyUs = record.LatencyUs;
+		entry.Expansions = record.Expansions;
+		entry.ThreatWeight = record.ThreatWeight;
+		entry.ThreatScale = record.ThreatScale;
+		entry.DiagonalStepLength = record.DiagonalStepLength;
+		entry.NumGoals = static_cast<u16>(std::min<size_t>(record.Goals.size(), 0xFFFF));
+		entry.SearchMode = static_cast<u8>(record.SearchMode);
+		entry.CostMode = static_cast<u8>(record.CostMode);
+		entry.CornerRule = static_cast<u8>(record.CornerRule);
+		entry.AgentSize = static_cast<u8>(std::clamp(record.AgentSize, 1, 255));
+		entry.Found = record.Found ? 1 : 0;
+		entry.LineOfSightShortcut = record.LineOfSightShortcut ? 1 : 0;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_File == nullptr) {
+			return;
+		}
+
+		auto bytes = reinterpret_cast<const u8*>(&entry);
+		m_Buffer.insert(m_Buffer.end(), bytes, bytes + sizeof(entry));
+		for (u16 i = 0; i < entry.NumGoals; ++i) {
+			s32 goal[2] = { record.Goals[i].X, record.Goals[i].Y };
+			bytes = reinterpret_cast<const u8*>(goal);
+			m_Buffer.insert(m_Buffer.end(), bytes, bytes + sizeof(goal));
+		}
+		++m_NumRecords;
+
+		if (m_Buffer.size() >= kFlushSize) {
+			Flush();
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdQueryRecorder::Load(const char* path, std::vector<cdQueryRecord>& records) {
+		auto file = fopen(path, "rb");
+		if (file == nullptr) {
+			return false;
+		}
+
+		cdQueryLogHeader header;
+		if (fread(&header, sizeof(header), 1, file) != 1 ||
+			header.Magic != k_QueryLogMagic || header.Version != k_QueryLogVersion) {
+			fclose(file);
+			return false;
+		}
+
+		// A truncated tail, say from a crashed process, ends the log without failing it.
+		cdQueryLogEntry entry;
+		while (fread(&entry, sizeof(entry), 1, file) == 1) {
+			cdQueryRecord record;
+			record.MapId = entry.MapId;
+			record.MapVersion = entry.MapVersion;
+			record.Start = cdGridCoord(entry.StartX, entry.StartY);
+			record.SearchMode = static_cast<cdSearchMode>(entry.SearchMode);
+			record.CostMode = static_cast<cdCostMode>(entry.CostMode);
+			record.CornerRule = static_cast<cdCornerRule>(entry.CornerRule);
+			record.AgentSize = entry.AgentSize;
+			record.ThreatWeight = entry.ThreatWeight;
+			record.ThreatScale = entry.ThreatScale;
+			record.DiagonalStepLength = entry.DiagonalStepLength;
+			record.LineOfSightShortcut = entry.LineOfSightShortcut != 0;
+			record.Found = entry.Found != 0;
+			record.Expansions = entry.Expansions;
+			record.LatencyUs = entry.LatencyUs;
+
+			bool complete = true;
+			record.Goals.reserve(entry.NumGoals);
+			for (u16 i = 0; i < entry.NumGoals; ++i) {
+				s32 goal[2];
+				if (fread(goal, sizeof(goal), 1, file) != 1) {
+					complete = false;
+					break;
+				}
+				record.Goals.push_back(cdGridCoord(goal[0], goal[1]));
+			}
+			if (complete == false) {
+				break;
+			}
+			records.push_back(std::move(record));
+		}
+
+		fclose(file);
+		return true;
+	}
+}
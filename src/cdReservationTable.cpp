@@ -0,0 +1,108 @@
+/*!
+ * \file cdReservationTable.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#include "cdReservationTable.hpp"
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdReservationTable::cdReservationTable(int numCols)
+		: m_NumCols(numCols) {
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdReservationTable::Reserve(const cdGridCoord& cell, u32 time, s32 agent) {
+		if (IsFree(cell, time, agent) == false) {
+			return false;
+		}
+
+		const auto key = GetKey(cell, time);
+		if (m_Reservations.try_emplace(key, agent).second) {
+			m_Agents[agent].Keys.push_back(key);
+		}
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdReservationTable::Park(const cdGridCoord& cell, u32 fromTime, s32 agent) {
+		auto parked = m_Parking.find(GetCellIndex(cell));
+		if (parked != m_Parking.end() && parked->second.Agent != agent) {
+			return false;
+		}
+
+		auto& holds = m_Agents[agent];
+		if (holds.ParkedCell >= 0) {
+			m_Parking.erase(holds.ParkedCell);
+		}
+		holds.ParkedCell = GetCellIndex(cell);
+		m_Parking[holds.ParkedCell] = { agent, fromTime };
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	s32 cdReservationTable::GetOwner(const cdGridCoord& cell, u32 time) const {
+		auto reserved = m_Reservations.find(GetKey(cell, time));
+		if (reserved != m_Reservations.end()) {
+			return reserved->second;
+		}
+
+		auto parked = m_Parking.find(GetCellIndex(cell));
+		if (parked != m_Parking.end() && time >= parked->second.FromTime) {
+			return parked->second.Agent;
+		}
+
+		return k_NoAgent;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdReservationTable::IsSwap(const cdGridCoord& from, const cdGridCoord& to, u32 time, s32 agent) const {
+		auto other = GetOwner(to, time);
+		return other != k_NoAgent && other != agent && GetOwner(from, time + 1) == other;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdReservationTable::Release(s32 agent) {
+		auto holds = m_Agents.find(agent);
+		if (holds == m_Agents.end()) {
+			return;
+		}
+
+		for (auto key : holds->second.Keys) {
+			m_Reservations.erase(key);
+		}
+		if (holds->second.ParkedCell >= 0) {
+			m_Parking.erase(holds->second.ParkedCell);
+		}
+		m_Agents.erase(holds);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdReservationTable::Purge(u32 beforeTime) {
+		std::erase_if(m_Reservations, [beforeTime](const auto& reservation) {
+			return (reservation.first >> 32) < beforeTime;
+		});
+		for (auto& [agent, holds] : m_Agents) {
+			std::erase_if(holds.Keys, [beforeTime](u64 key) {
+				return (key >> 32) < beforeTime;
+			});
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdReservationTable::Clear() {
+		m_Reservations.clear();
+		m_Parking.clear();
+		m_Agents.clear();
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
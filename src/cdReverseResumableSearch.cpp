@@ -0,0 +1,92 @@
+/*!
+ * \file cdReverseResumableSearch.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#include <algorithm>
+#include <bit>
+
+#include "cdFlowField.hpp"
+#include "cdHeuristics.hpp"
+#include "cdReverseResumableSearch.hpp"
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdReverseResumableSearch::cdReverseResumableSearch(const cdGridMap& map,
+		const cdGridCoord& goal, const cdGridCoord& origin)
+		: m_Map(map)
+		, m_Goal(goal)
+		, m_Origin(origin)
+		, m_NumExpansions(0) {
+		if (map.CellCollides(goal) == false) {
+			const auto idx = goal.Y * map.GetNumCols() + goal.X;
+			m_Best[idx] = 0.0f;
+			m_Open.push({ GetOriginHeuristics(goal), idx });
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f32 cdReverseResumableSearch::GetOriginHeuristics(const cdGridCoord& cell) const {
+		// Threat only ever makes steps dearer.
+		return OctileDistance(static_cast<f32>(cell.X), static_cast<f32>(cell.Y),
+			static_cast<f32>(m_Origin.X), static_cast<f32>(m_Origin.Y), m_Map.GetDiagonalStepLength());
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f32 cdReverseResumableSearch::GetDistance(const cdGridCoord& cell) {
+		if (m_Map.CellCollides(cell)) {
+			return cdFlowField::k_Unreachable;
+		}
+
+		const int numCols = m_Map.GetNumCols();
+		const auto target = cell.Y * numCols + cell.X;
+		auto closed = m_Closed.find(target);
+		if (closed != m_Closed.end()) {
+			return closed->second;
+		}
+
+		while (m_Open.empty() == false) {
+			const auto idx = m_Open.top().second;
+			m_Open.pop();
+			if (m_Closed.count(idx) != 0) {
+				continue;
+			}
+
+			const f32 distance = m_Best[idx];
+			m_Closed[idx] = distance;
+			m_Best.erase(idx);
+			++m_NumExpansions;
+
+			// Searching backwards, so each neighbour pays for the step from it onto this cell.
+			cdGridCoord current(idx % numCols, idx / numCols);
+			unsigned moves = m_Map.GetCellMoves(current);
+			while (moves != 0) {
+				auto dir = std::countr_zero(moves);
+				moves &= moves - 1;
+				cdGridCoord next(current.X + k_GridDirections[dir].X, current.Y + k_GridDirections[dir].Y);
+				const auto nIdx = next.Y * numCols + next.X;
+				if (m_Closed.count(nIdx) != 0) {
+					continue;
+				}
+
+				const f32 nDistance = distance + m_Map.GetStepCost(dir, current);
+				auto best = m_Best.find(nIdx);
+				if (best == m_Best.end() || nDistance < best->second) {
+					m_Best[nIdx] = nDistance;
+					m_Open.push({ nDistance + GetOriginHeuristics(next), nIdx });
+				}
+			}
+
+			if (idx == target) {
+				return distance;
+			}
+		}
+
+		return cdFlowField::k_Unreachable;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
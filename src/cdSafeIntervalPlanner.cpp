@@ -0,0 +1,201 @@
+/*!
+ * \file cdSafeIntervalPlanner.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#include <algorithm>
+#include <bit>
+
+#include "cdSafeIntervalPlanner.hpp"
+
+namespace ceed::ai::path {
+	namespace {
+		const std::vector<cdSafeInterval> kNoIntervals;
+		const std::vector<cdSafeInterval> kAlwaysSafe = { { 0, cdSafeIntervalPlanner::k_Forever } };
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdSafeIntervalPlanner::cdSafeIntervalPlanner(const cdGridMap& map)
+		: m_Map(map)
+		, m_NumObstacles(0)
+		, m_IntervalsDirty(false)
+		, m_NumExpansions(0) {
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	s32 cdSafeIntervalPlanner::AddObstacle(const std::vector<cdGridCoord>& cells, u32 startTime) {
+		const auto obstacle = m_NumObstacles++;
+		for (size_t i = 0; i < cells.size(); ++i) {
+			const auto time = startTime + static_cast<u32>(i);
+			m_Occupied.emplace(GetKey(cells[i], time), obstacle);
+			m_UnsafeTimes[GetCellIndex(cells[i])].push_back(time);
+		}
+		m_IntervalsDirty = true;
+		return obstacle;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdSafeIntervalPlanner::ClearObstacles(void) {
+		m_NumObstacles = 0;
+		m_Occupied.clear();
+		m_UnsafeTimes.clear();
+		m_Intervals.clear();
+		m_IntervalsDirty = false;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdSafeIntervalPlanner::BuildIntervals(void) {
+		m_Intervals.clear();
+		for (auto& [cellIdx, times] : m_UnsafeTimes) {
+			std::sort(times.begin(), times.end());
+			times.erase(std::unique(times.begin(), times.end()), times.end());
+
+			auto& intervals = m_Intervals[cellIdx];
+			u32 begin = 0;
+			for (auto time : times) {
+				if (time > begin) {
+					intervals.push_back({ begin, time - 1 });
+				}
+				begin = time + 1;
+			}
+			intervals.push_back({ begin, k_Forever });
+		}
+		m_IntervalsDirty = false;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	const std::vector<cdSafeInterval>& cdSafeIntervalPlanner::GetSafeIntervals(const cdGridCoord& cell) {
+		if (m_Map.CellCollides(cell)) {
+			return kNoIntervals;
+		}
+		if (m_IntervalsDirty) {
+			BuildIntervals();
+		}
+
+		auto intervals = m_Intervals.find(GetCellIndex(cell));
+		return intervals != m_Intervals.end() ? intervals->second : kAlwaysSafe;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdSafeIntervalPlanner::IsSwap(const cdGridCoord& from, const cdGridCoord& to, u32 arrival) const {
+		auto incoming = m_Occupied.find(GetKey(from, arrival));
+		if (incoming == m_Occupied.end()) {
+			return false;
+		}
+
+		auto outgoing = m_Occupied.find(GetKey(to, arrival - 1));
+		return outgoing != m_Occupied.end() && outgoing->second == incoming->second;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdSafeIntervalPlanner::FindPath(const cdGridCoord& start, u32 startTime,
+		const cdGridCoord& goal, std::vector<cdTimedCell>& path) {
+		path.clear();
+		m_Nodes.clear();
+		m_Visited.clear();
+
+		const auto& startIntervals = GetSafeIntervals(start);
+		auto startInterval = std::find_if(startIntervals.begin(), startIntervals.end(), [startTime](const auto& interval) {
+			return interval.Begin <= startTime && startTime <= interval.End;
+		});
+		if (startInterval == startIntervals.end() || m_Map.CellCollides(goal)) {
+			return false;
+		}
+
+		// Steps take a tick whichever way they go.
+		auto heuristics = [&goal](const cdGridCoord& cell) {
+			return static_cast<u32>(std::max(abs(cell.X - goal.X), abs(cell.Y - goal.Y)));
+		};
+		auto visitedKey = [this](const cdGridCoord& cell, u32 interval) {
+			return (static_cast<u64>(interval) << 32) | static_cast<u32>(GetCellIndex(cell));
+		};
+
+		cdOpenQueue open;
+		const auto startIdx = static_cast<u32>(startInterval - startIntervals.begin());
+		m_Nodes.push_back({ start, startIdx, startTime, -1 });
+		m_Visited[visitedKey(start, startIdx)] = startTime;
+		open.push({ startTime + heuristics(start), 0 });
+
+		s32 found = -1;
+		while (open.empty() == false) {
+			const auto nodeIdx = open.top().second;
+			open.pop();
+			const auto node = m_Nodes[nodeIdx];
+			if (m_Visited[visitedKey(node.Cell, node.Interval)] < node.Time) {
+				continue;
+			}
+			++m_NumExpansions;
+
+			const auto end = GetSafeIntervals(node.Cell)[node.Interval].End;
+			if (node.Cell == goal && end == k_Forever) {
+				found = nodeIdx;
+				break;
+			}
+
+			// Waiting here until the interval closes, the step can land any tick up to one past it.
+			const u32 latest = end == k_Forever ? k_Forever : end + 1;
+			unsigned moves = m_Map.GetCellMoves(node.Cell);
+			while (moves != 0) {
+				auto dir = std::countr_zero(moves);
+				moves &= moves - 1;
+				cdGridCoord next(node.Cell.X + k_GridDirections[dir].X, node.Cell.Y + k_GridDirections[dir].Y);
+
+				const auto& intervals = GetSafeIntervals(next);
+				for (u32 i = 0; i < intervals.size(); ++i) {
+					const auto& interval = intervals[i];
+					if (interval.End < node.Time + 1) {
+						continue;
+					}
+					if (interval.Begin > latest) {
+						break;
+					}
+
+					u32 arrival = std::max(node.Time + 1, interval.Begin);
+					while (arrival <= interval.End && arrival <= latest && IsSwap(node.Cell, next, arrival)) {
+						++arrival;
+					}
+					if (arrival > interval.End || arrival > latest) {
+						continue;
+					}
+
+					const auto key = visitedKey(next, i);
+					auto visited = m_Visited.find(key);
+					if (visited != m_Visited.end() && visited->second <= arrival) {
+						continue;
+					}
+					m_Visited[key] = arrival;
+
+					m_Nodes.push_back({ next, i, arrival, nodeIdx });
+					open.push({ arrival + heuristics(next), static_cast<s32>(m_Nodes.size()) - 1 });
+				}
+			}
+		}
+
+		if (found < 0) {
+			return false;
+		}
+
+		std::vector<s32> chain;
+		for (auto nodeIdx = found; nodeIdx >= 0; nodeIdx = m_Nodes[nodeIdx].Parent) {
+			chain.push_back(nodeIdx);
+		}
+
+		path.push_back({ start, startTime });
+		for (auto i = chain.rbegin() + 1; i != chain.rend(); ++i) {
+			const auto& node = m_Nodes[*i];
+			while (path.back().Time + 1 < node.Time) {
+				path.push_back({ path.back().Cell, path.back().Time + 1 });
+			}
+			path.push_back({ node.Cell, node.Time });
+		}
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
@@ -0,0 +1,394 @@
+/*!
+ * \file cdSectorFlowField.cpp
+ * Copyright (c) Punch First 2014 - 2016 All rights reserved.
+ */
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <queue>
+
+#include "cdHeuristics.hpp"
+#include "cdSectorFlowField.hpp"
+
+namespace {
+using cdOpenEntry = std::pair<f32, s32>;
+using cdOpenQueue = std::priority_queue<cdOpenEntry, std::vector<cdOpenEntry>, std::greater<cdOpenEntry>>;
+}
+
+namespace ceed::ai::path {
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdSectorGraph::cdSectorGraph(const cdGridMap& map, int sectorSize)
+		: cdAStarMap<cdSectorRegion>(fastdelegate::MakeDelegate(this, &cdSectorGraph::RegionCollides)
+		, fastdelegate::MakeDelegate(this, &cdSectorGraph::GetRegionSucessorList)
+		, fastdelegate::MakeDelegate(this, &cdSectorGraph::GetRegionHeuristics)
+		, fastdelegate::MakeDelegate(this, &cdSectorGraph::GetRegionMovementCost), 0)
+		, m_Map(map)
+		, m_SectorSize(std::max(sectorSize, 1))
+		, m_NumSectorCols((map.GetNumCols() + m_SectorSize - 1) / m_SectorSize)
+		, m_NumSectorRows((map.GetNumRows() + m_SectorSize - 1) / m_SectorSize) {
+		m_Sectors.resize(static_cast<size_t>(m_NumSectorCols) * m_NumSectorRows);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdSectorGraph::Clear() {
+		for (auto& sector : m_Sectors) {
+			sector.reset();
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	const cdSectorGraph::cdSectorRegions& cdSectorGraph::GetRegions(int sector) {
+		if (m_Sectors[sector] != nullptr) {
+			return *m_Sectors[sector];
+		}
+
+		auto regions = std::make_unique<cdSectorRegions>();
+		regions->Labels.assign(static_cast<size_t>(m_SectorSize) * m_SectorSize, k_NoRegion);
+		regions->NumRegions = 0;
+
+		const int x0 = (sector % m_NumSectorCols) * m_SectorSize;
+		const int y0 = (sector / m_NumSectorCols) * m_SectorSize;
+		const int x1 = std::min(x0 + m_SectorSize, m_Map.GetNumCols());
+		const int y1 = std::min(y0 + m_SectorSize, m_Map.GetNumRows());
+
+		// Flood fill with the GRID moves, they are symmetric so every region is one fill.
+		std::vector<cdGridCoord> stack;
+		for (int y = y0; y < y1; ++y) {
+			for (int x = x0; x < x1; ++x) {
+				auto& label = regions->Labels[(y - y0) * m_SectorSize + x - x0];
+				if (label != k_NoRegion || m_Map.CellCollides(cdGridCoord(x, y))) {
+					continue;
+				}
+
+				const auto region = static_cast<u16>(regions->NumRegions++);
+				label = region;
+				stack.push_back(cdGridCoord(x, y));
+				while (stack.empty() == false) {
+					auto cell = stack.back();
+					stack.pop_back();
+
+					unsigned moves = m_Map.GetCellMoves(cell);
+					while (moves != 0) {
+						auto dir = std::countr_zero(moves);
+						moves &= moves - 1;
+						const int nx = cell.X + k_GridDirections[dir].X;
+						const int ny = cell.Y + k_GridDirections[dir].Y;
+						if (nx < x0 || ny < y0 || nx >= x1 || ny >= y1) {
+							continue;
+						}
+
+						auto& nLabel = regions->Labels[(ny - y0) * m_SectorSize + nx - x0];
+						if (nLabel == k_NoRegion) {
+							nLabel = region;
+							stack.push_back(cdGridCoord(nx, ny));
+						}
+					}
+				}
+			}
+		}
+
+		m_Sectors[sector] = std::move(regions);
+		return *m_Sectors[sector];
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdSectorRegion cdSectorGraph::GetRegion(const cdGridCoord& cell) {
+		if (m_Map.CellCollides(cell)) {
+			return cdSectorRegion(-1, -1);
+		}
+
+		const auto sector = GetSectorIndex(cell);
+		const auto label = GetRegions(sector).Labels[(cell.Y % m_SectorSize) * m_SectorSize + cell.X % m_SectorSize];
+		return cdSectorRegion(sector, label);
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	int cdSectorGraph::GetNumRegions(int sector) {
+		return GetRegions(sector).NumRegions;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdSectorGraph::RegionCollides(const cdSectorRegion& region) {
+		return region.Region < 0;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdSectorGraph::GetRegionSucessorList(const cdAStar<cdSectorRegion>* astar,
+		const cdNode<cdSectorRegion>& current,
+		const cdSectorRegion& start,
+		const std::vector<cdSectorRegion>& end,
+		std::vector<cdSectorRegion>& adjcentList) {
+		const auto& node = current.NodePos;
+		const auto& labels = GetRegions(node.Sector).Labels;
+
+		const int x0 = (node.Sector % m_NumSectorCols) * m_SectorSize;
+		const int y0 = (node.Sector / m_NumSectorCols) * m_SectorSize;
+		const int x1 = std::min(x0 + m_SectorSize, m_Map.GetNumCols());
+		const int y1 = std::min(y0 + m_SectorSize, m_Map.GetNumRows());
+
+		// Only border cells can step into another sector.
+		for (int y = y0; y < y1; ++y) {
+			const int step = (y == y0 || y == y1 - 1) ? 1 : std::max(x1 - 1 - x0, 1);
+			for (int x = x0; x < x1; x += step) {
+				if (labels[(y - y0) * m_SectorSize + x - x0] != node.Region) {
+					continue;
+				}
+
+				unsigned moves = m_Map.GetCellMoves(cdGridCoord(x, y));
+				while (moves != 0) {
+					auto dir = std::countr_zero(moves);
+					moves &= moves - 1;
+					cdGridCoord next(x + k_GridDirections[dir].X, y + k_GridDirections[dir].Y);
+					if (next.X >= x0 && next.Y >= y0 && next.X < x1 && next.Y < y1) {
+						continue;
+					}
+
+					auto region = GetRegion(next);
+					if (std::find(adjcentList.begin(), adjcentList.end(), region) == adjcentList.end()) {
+						adjcentList.push_back(region);
+					}
+				}
+			}
+		}
+
+		return adjcentList.empty() == false;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f32 cdSectorGraph::GetRegionHeuristics(const cdSectorRegion& region,
+		const cdSectorRegion& start, const std::vector<cdSectorRegion>& goals) {
+		const auto x = static_cast<f32>(region.Sector % m_NumSectorCols);
+		const auto y = static_cast<f32>(region.Sector / m_NumSectorCols);
+
+		f32 best = FLT_MAX;
+		for (const auto& goal : goals) {
+			best = std::min(best, DiagonalDistance(x, y,
+				static_cast<f32>(goal.Sector % m_NumSectorCols),
+				static_cast<f32>(goal.Sector / m_NumSectorCols)));
+		}
+		return best * m_SectorSize;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f32 cdSectorGraph::GetRegionMovementCost(const cdSectorRegion& r1, const cdSectorRegion& r2) {
+		const bool diagonal = (r1.Sector % m_NumSectorCols) != (r2.Sector % m_NumSectorCols) &&
+			(r1.Sector / m_NumSectorCols) != (r2.Sector / m_NumSectorCols);
+		return (diagonal ? 1.5f : 1.0f) * m_SectorSize;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	cdSectorFlowField::cdSectorFlowField(const cdGridMap& map, int sectorSize)
+		: m_Map(map)
+		, m_MapVersion(map.GetVersion())
+		, m_Graph(map, sectorSize)
+		, m_NumIntegrations(0) {
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdSectorFlowField::Clear() {
+		m_Fields.clear();
+		m_Graph.Clear();
+		m_MapVersion = m_Map.GetVersion();
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdSectorFlowField::Refresh() {
+		if (m_Map.GetVersion() != m_MapVersion) {
+			Clear();
+		}
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	const cdSectorFlowField::cdSectorField* cdSectorFlowField::FindField(const cdGridCoord& goal, int sector) const {
+		auto field = m_Fields.find(GetFieldKey(goal, sector));
+		return field == m_Fields.end() ? nullptr : field->second.get();
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	f32 cdSectorFlowField::GetDistance(const cdGridCoord& cell, const cdGridCoord& goal) const {
+		auto field = FindField(goal, m_Graph.GetSectorIndex(cell));
+		return field == nullptr ? cdFlowField::k_Unreachable : field->Distance[GetLocalIndex(cell)];
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	u8 cdSectorFlowField::GetDirection(const cdGridCoord& cell, const cdGridCoord& goal) const {
+		auto field = FindField(goal, m_Graph.GetSectorIndex(cell));
+		return field == nullptr ? cdFlowField::k_NoDirection : field->Direction[GetLocalIndex(cell)];
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	bool cdSectorFlowField::Prepare(const cdGridCoord& start, const cdGridCoord& goal) {
+		Refresh();
+
+		if (m_Map.CellCollides(start) || m_Map.CellCollides(goal)) {
+			return false;
+		}
+
+		// Earlier groups may have covered this one already.
+		auto startRegion = m_Graph.GetRegion(start);
+		auto startField = FindField(goal, startRegion.Sector);
+		if (startField != nullptr && startField->ReachedRegions[startRegion.Region] != 0) {
+			return true;
+		}
+
+		m_SectorPath.clear();
+		if (m_AStar.FindPath(startRegion, m_Graph.GetRegion(goal), &m_Graph, m_SectorPath) == false) {
+			return false;
+		}
+
+		// The path runs from the goal back to the start, each sector leans on the one before it.
+		for (const auto& node : m_SectorPath) {
+			auto& field = m_Fields[GetFieldKey(goal, node.Sector)];
+			if (field == nullptr) {
+				const auto size = static_cast<size_t>(m_Graph.GetSectorSize()) * m_Graph.GetSectorSize();
+				field = std::make_unique<cdSectorField>();
+				field->Distance.assign(size, cdFlowField::k_Unreachable);
+				field->Direction.assign(size, cdFlowField::k_NoDirection);
+				field->ReachedRegions.assign(m_Graph.GetNumRegions(node.Sector), 0);
+			}
+
+			if (field->ReachedRegions[node.Region] == 0) {
+				IntegrateSector(goal, node.Sector, *field);
+			}
+		}
+
+		return GetDistance(start, goal) != cdFlowField::k_Unreachable;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+
+	void cdSectorFlowField::IntegrateSector(const cdGridCoord& goal, int sector, cdSectorField& field) {
+		const int size = m_Graph.GetSectorSize();
+		const int x0 = (sector % m_Graph.GetNumSectorCols()) * size;
+		const int y0 = (sector / m_Graph.GetNumSectorCols()) * size;
+		const int x1 = std::min(x0 + size, m_Map.GetNumCols());
+		const int y1 = std::min(y0 + size, m_Map.GetNumRows());
+		auto inSector = [x0, y0, x1, y1](const cdGridCoord& cell) {
+			return cell.X >= x0 && cell.Y >= y0 && cell.X < x1 && cell.Y < y1;
+		};
+		auto getLocal = [x0, y0, size](const cdGridCoord& cell) {
+			return (cell.Y - y0) * size + cell.X - x0;
+		};
+
+		cdOpenQueue open;
+		if (inSector(goal) && field.Distance[getLocal(goal)] != 0.0f) {
+			field.Distance[getLocal(goal)] = 0.0f;
+			open.push({ 0.0f, getLocal(goal) });
+		}
+
+		// Seed the border from whatever the neighbouring sectors already know.
+		for (int y = y0; y < y1; ++y) {
+			const int step = (y == y0 || y == y1 - 1) ? 1 : std::max(x1 - 1 - x0, 1);
+			for (int x = x0; x < x1; x += step) {
+				cdGridCoord cell(x, y);
+				if (m_Map.CellCollides(cell)) {
+					continue;
+				}
+
+				const auto idx = getLocal(cell);
+				unsigned moves = m_Map.GetCellMoves(cell);
+				while (moves != 0) {
+					auto dir = std::countr_zero(moves);
+					moves &= moves - 1;
+					cdGridCoord next(x + k_GridDirections[dir].X, y + k_GridDirections[dir].Y);
+					if (inSector(next)) {
+						continue;
+					}
+
+					const f32 nDistance = GetDistance(next, goal);
+					if (nDistance == cdFlowField::k_Unreachable) {
+						continue;
+					}
+
+					const f32 distance = nDistance + m_Map.GetStepCost(dir, next);
+					if (distance < field.Distance[idx]) {
+						field.Distance[idx] = distance;
+						open.push({ distance, idx });
+					}
+				}
+			}
+		}
+
+		// The same backwards walk as cdFlowField, kept inside the sector.
+		while (open.empty() == false) {
+			const auto [distance, idx] = open.top();
+			open.pop();
+			if (distance > field.Distance[idx]) {
+				continue;
+			}
+
+			cdGridCoord cell(x0 + idx % size, y0 + idx / size);
+			unsigned moves = m_Map.GetCellMoves(cell);
+			while (moves != 0) {
+				auto dir = std::countr_zero(moves);
+				moves &= moves - 1;
+				cdGridCoord next(cell.X + k_GridDirections[dir].X, cell.Y + k_GridDirections[dir].Y);
+				if (inSector(next) == false) {
+					continue;
+				}
+
+				const auto nIdx = getLocal(next);
+				const f32 nDistance = distance + m_Map.GetStepCost(dir, cell);
+				if (nDistance < field.Distance[nIdx]) {
+					field.Distance[nIdx] = nDistance;
+					open.push({ nDistance, nIdx });
+				}
+			}
+		}
+
+		// Lowest direction index wins ties, as in cdFlowField.
+		for (int y = y0; y < y1; ++y) {
+			for (int x = x0; x < x1; ++x) {
+				cdGridCoord cell(x, y);
+				const auto idx = getLocal(cell);
+				if (field.Distance[idx] == 0.0f || field.Distance[idx] == cdFlowField::k_Unreachable) {
+					continue;
+				}
+
+				f32 best = cdFlowField::k_Unreachable;
+				unsigned moves = m_Map.GetCellMoves(cell);
+				while (moves != 0) {
+					auto dir = std::countr_zero(moves);
+					moves &= moves - 1;
+					cdGridCoord next(x + k_GridDirections[dir].X, y + k_GridDirections[dir].Y);
+					const f32 nDistance = inSector(next) ? field.Distance[getLocal(next)] : GetDistance(next, goal);
+					if (nDistance == cdFlowField::k_Unreachable) {
+						continue;
+					}
+
+					const f32 distance = nDistance + m_Map.GetStepCost(dir, next);
+					if (distance < best) {
+						best = distance;
+						field.Direction[idx] = static_cast<u8>(dir);
+					}
+				}
+
+				field.ReachedRegions[m_Graph.GetRegion(cell).Region] = 1;
+			}
+		}
+		if (inSector(goal)) {
+			field.ReachedRegions[m_Graph.GetRegion(goal).Region] = 1;
+		}
+
+		++m_NumIntegrations;
+	}
+
+	//------------------------------------------------------------------------------------------------//
+}
@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
+#include <cmath>
 #include "cdAStar.hpp"
 #include "cdJumpStartMap.hpp"
 #include "cdGridMap.hpp"
+#include "cdMapFile.hpp"
+#include "cdMovingAI.hpp"
+#include "test_maps.hpp"
 
 #include <gtest/gtest.h>
 #include "cdGridMap.hpp"
@@ -124,6 +128,676 @@ TEST(CdGridMapTest, PathFindingBlockedMap) {
     EXPECT_FALSE(found);
 }
 
+TEST(CdGridMapTest, GoalBoundsPruneDirections) {
+    // Vertical wall at x = 4 with a single gap at y = 9.
+    cdGridCellList cells(100, cdGridCell());
+    for (int y = 0; y < 9; ++y) {
+        cells[y * 10 + 4].Type = cdGridCell::CellType::BLOCKED;
+    }
+    cdPoint2f dimension(10, 10);
+    cdGridMap gridMap(cells, 10, 10, dimension);
+
+    EXPECT_FALSE(gridMap.HasGoalBounds());
+    gridMap.BuildGoalBounds();
+    ASSERT_TRUE(gridMap.HasGoalBounds());
+
+    cdGridCoord start(0, 0);
+    cdGridCoord end(9, 0);
+
+    // Nothing is reachable by walking off the map, and the goal is behind the wall.
+    EXPECT_TRUE(gridMap.GetGoalBounds(start, GetGridDirectionIndex(-1, 0)).IsEmpty());
+    EXPECT_TRUE(gridMap.GetGoalBounds(start, GetGridDirectionIndex(0, -1)).IsEmpty());
+    EXPECT_TRUE(gridMap.GetGoalBounds(start, GetGridDirectionIndex(0, 1)).Contains(end));
+
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    EXPECT_TRUE(aStar.FindPath(start, end, &gridMap, resultPath));
+    EXPECT_EQ(resultPath.front(), end);
+    EXPECT_EQ(resultPath.back(), start);
+
+    gridMap.ClearGoalBounds();
+    EXPECT_FALSE(gridMap.HasGoalBounds());
+}
+
+TEST(CdGridMapTest, GoalBoundsFollowStepSettings) {
+    cdGridCellList cells(8, cdGridCell());
+    cells[1].Type = cdGridCell::CellType::BLOCKED;
+    cdPoint2f dimension(4, 2);
+    cdGridMap bounded(cells, 4, 2, dimension);
+    cdGridMap plain(cells, 4, 2, dimension);
+    bounded.BuildGoalBounds();
+    ASSERT_TRUE(bounded.GetGoalBoundsEnabled());
+
+    // Under ALWAYS the bounds send (0, 0) diagonally past the block, a step NEVER does not take.
+    bounded.SetCornerRule(cdCornerRule::NEVER);
+    plain.SetCornerRule(cdCornerRule::NEVER);
+    EXPECT_FALSE(bounded.GetGoalBoundsEnabled());
+
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> boundedPath;
+    std::vector<cdGridCoord> plainPath;
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(2, 0), &plain, plainPath));
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(2, 0), &bounded, boundedPath));
+    EXPECT_EQ(boundedPath, plainPath);
+
+    bounded.SetCornerRule(cdCornerRule::ALWAYS);
+    EXPECT_TRUE(bounded.GetGoalBoundsEnabled());
+    bounded.SetDiagonalStepLength(std::sqrt(2.0f));
+    EXPECT_FALSE(bounded.GetGoalBoundsEnabled());
+    bounded.BuildGoalBounds();
+    EXPECT_TRUE(bounded.GetGoalBoundsEnabled());
+}
+
+TEST(CdGridMapTest, GridSearchCornerRules) {
+    cdGridCellList cells(100, cdGridCell());
+    cells[1].Type = cdGridCell::CellType::BLOCKED;
+    cells[10].Type = cdGridCell::CellType::BLOCKED;
+    cdPoint2f dimension(10, 10);
+    cdGridMap gridMap(cells, 10, 10, dimension);
+    gridMap.SetSearchMode(cdSearchMode::GRID);
+
+    // (0, 0) can only leave diagonally, between the two blocked cells.
+    EXPECT_EQ(gridMap.GetNeighbourMask(cdGridCoord(0, 0)), 1 << GetGridDirectionIndex(1, 1));
+
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    cdGridCoord start(0, 0);
+    cdGridCoord end(3, 3);
+
+    EXPECT_TRUE(aStar.FindPath(start, end, &gridMap, resultPath));
+    EXPECT_EQ(resultPath.size(), 4);
+
+    gridMap.SetCornerRule(cdCornerRule::ONE_OPEN);
+    resultPath.clear();
+    EXPECT_FALSE(aStar.FindPath(start, end, &gridMap, resultPath));
+
+    // JPS follows ALWAYS and takes ONE_OPEN as NEVER.
+    gridMap.SetSearchMode(cdSearchMode::JUMP_POINT);
+    resultPath.clear();
+    EXPECT_FALSE(aStar.FindPath(start, end, &gridMap, resultPath));
+    gridMap.SetCornerRule(cdCornerRule::ALWAYS);
+    resultPath.clear();
+    EXPECT_TRUE(aStar.FindPath(start, end, &gridMap, resultPath));
+}
+
+TEST(CdAStarTest, OpenListKeepsCheaperParent) {
+    // (1, 1) is opened diagonally from (0, 0) for 1.5, then reached again through (0, 1) for 2.
+    // The open list has to keep the cheaper parent, or the path comes out at 4.5.
+    cdGridCellList cells(12, cdGridCell());
+    cells[1 * 4 + 3].Type = cdGridCell::CellType::BLOCKED;
+    cdPoint2f dimension(4, 3);
+    cdGridMap gridMap(cells, 4, 3, dimension);
+    gridMap.SetSearchMode(cdSearchMode::GRID);
+    gridMap.SetCornerRule(cdCornerRule::NEVER);
+
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(3, 2), &gridMap, resultPath));
+
+    f32 cost = 0.0f;
+    for (size_t i = 1; i < resultPath.size(); ++i) {
+        cost += gridMap.GetMovementCost(resultPath[i], resultPath[i - 1]);
+    }
+    EXPECT_FLOAT_EQ(cost, 4.0f);
+}
+
+TEST(CdGridMapTest, ThreatWeightedCost) {
+    // Threat wall at x = 5 with a safe gap at y = 9.
+    cdGridCellList cells(100, cdGridCell());
+    for (int y = 0; y < 9; ++y) {
+        cells[y * 10 + 5].Threat = 10.0f;
+    }
+    cdPoint2f dimension(10, 10);
+    cdGridMap gridMap(cells, 10, 10, dimension);
+    gridMap.SetSearchMode(cdSearchMode::GRID);
+    gridMap.SetThreatScale(10.0f);
+    gridMap.SetThreatWeight(2.0f);
+
+    EXPECT_EQ(gridMap.GetQuantizedThreat(cdGridCoord(5, 0)), 255);
+    EXPECT_EQ(gridMap.GetQuantizedThreat(cdGridCoord(5, 9)), 0);
+
+    // The plain mode ignores threat, the weighted one pays 1 + 2 * 10 for it.
+    EXPECT_FLOAT_EQ(gridMap.GetMovementCost(cdGridCoord(4, 0), cdGridCoord(5, 0)), 1.0f);
+    gridMap.SetCostMode(cdCostMode::THREAT_WEIGHTED);
+    EXPECT_FLOAT_EQ(gridMap.GetMovementCost(cdGridCoord(4, 0), cdGridCoord(5, 0)), 21.0f);
+    EXPECT_FLOAT_EQ(gridMap.GetMovementCost(cdGridCoord(4, 8), cdGridCoord(5, 9)), 1.5f);
+
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    EXPECT_TRUE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(9, 0), &gridMap, resultPath));
+    for (const auto& cell : resultPath) {
+        EXPECT_EQ(gridMap.GetQuantizedThreat(cell), 0);
+    }
+}
+
+TEST(CdGridMapTest, JumpPointLegCost) {
+    cdGridCellList cells(100, cdGridCell());
+    cdPoint2f dimension(10, 10);
+    cdGridMap gridMap(cells, 10, 10, dimension);
+
+    // A jump pays every step of its leg.
+    EXPECT_FLOAT_EQ(gridMap.GetMovementCost(cdGridCoord(0, 0), cdGridCoord(0, 7)), 7.0f);
+    EXPECT_FLOAT_EQ(gridMap.GetMovementCost(cdGridCoord(6, 6), cdGridCoord(2, 2)), 6.0f);
+    EXPECT_FLOAT_EQ(gridMap.GetMovementCost(cdGridCoord(1, 1), cdGridCoord(4, 3)), 4.0f);
+
+    // Corner cutting JPS finds paths as short as the GRID search with the same rule.
+    auto randomMap = MakeRandomMap(48, 32, 5, 4);
+    cdAStar<cdGridCoord> aStar;
+    unsigned seed = 9;
+    int numFound = 0;
+    for (int query = 0; query < 40; ++query) {
+        seed = seed * 1103515245u + 12345u;
+        cdGridCoord start(static_cast<int>((seed >> 4) % 48), static_cast<int>((seed >> 12) % 32));
+        seed = seed * 1103515245u + 12345u;
+        cdGridCoord goal(static_cast<int>((seed >> 4) % 48), static_cast<int>((seed >> 12) % 32));
+        if (randomMap->CellCollides(start) || randomMap->CellCollides(goal)) {
+            continue;
+        }
+
+        f32 costs[2] = {};
+        bool found[2] = {};
+        for (int i = 0; i < 2; ++i) {
+            randomMap->SetSearchMode(i == 0 ? cdSearchMode::GRID : cdSearchMode::JUMP_POINT);
+            std::vector<cdGridCoord> resultPath;
+            found[i] = aStar.FindPath(start, goal, randomMap.get(), resultPath);
+            for (size_t j = 1; j < resultPath.size(); ++j) {
+                costs[i] += randomMap->GetMovementCost(resultPath[j], resultPath[j - 1]);
+            }
+        }
+        ASSERT_EQ(found[1], found[0]);
+        EXPECT_NEAR(costs[1], costs[0], 1e-3f);
+        numFound += found[0] ? 1 : 0;
+    }
+    EXPECT_GT(numFound, 10);
+}
+
+TEST(CdGridMapTest, ClearanceAndAgentSize) {
+    // Wall at x = 5 with a 1 cell gap at y = 2 and a 3 cell gap at y = 6..8.
+    cdGridCellList cells(100, cdGridCell());
+    for (int y = 0; y < 10; ++y) {
+        if (y != 2 && (y < 6 || y > 8)) {
+            cells[y * 10 + 5].Type = cdGridCell::CellType::BLOCKED;
+        }
+    }
+    cdPoint2f dimension(10, 10);
+    cdGridMap gridMap(cells, 10, 10, dimension);
+
+    EXPECT_EQ(gridMap.GetClearance(cdGridCoord(5, 0)), 0);
+    EXPECT_EQ(gridMap.GetClearance(cdGridCoord(0, 0)), 1);
+    EXPECT_EQ(gridMap.GetClearance(cdGridCoord(5, 2)), 1);
+    EXPECT_EQ(gridMap.GetClearance(cdGridCoord(5, 7)), 2);
+    EXPECT_EQ(gridMap.GetClearance(cdGridCoord(2, 4)), 3);
+
+    gridMap.SetAgentSize(2);
+    EXPECT_TRUE(gridMap.CellCollides(cdGridCoord(5, 2)));
+    EXPECT_FALSE(gridMap.CellCollides(cdGridCoord(5, 7)));
+
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    EXPECT_TRUE(aStar.FindPath(cdGridCoord(2, 2), cdGridCoord(7, 2), &gridMap, resultPath));
+    for (const auto& cell : resultPath) {
+        EXPECT_GE(gridMap.GetClearance(cell), 2);
+    }
+
+    // Close the wide gap, now only the single cell agent gets through.
+    gridMap.SetCell(cdGridCoord(5, 7), cdGridCell(cdGridCell::CellType::BLOCKED));
+    resultPath.clear();
+    EXPECT_FALSE(aStar.FindPath(cdGridCoord(2, 2), cdGridCoord(7, 2), &gridMap, resultPath));
+    gridMap.SetAgentSize(1);
+    resultPath.clear();
+    EXPECT_TRUE(aStar.FindPath(cdGridCoord(2, 2), cdGridCoord(7, 2), &gridMap, resultPath));
+}
+
+TEST(CdGridMapTest, IncrementalEditsMatchRebuild) {
+    const int cols = 24;
+    const int rows = 17;
+    cdGridCellList cells(cols * rows, cdGridCell());
+    cdPoint2f dimension(cols, rows);
+    cdGridMap gridMap(cells, cols, rows, dimension);
+    // The agent's masks follow the edits as well.
+    gridMap.SetAgentSize(2);
+
+    unsigned seed = 7;
+    for (int edit = 0; edit < 400; ++edit) {
+        seed = seed * 1103515245u + 12345u;
+        auto idx = static_cast<int>((seed >> 8) % (cols * rows));
+        auto type = (seed >> 4) % 3 == 0 ? cdGridCell::CellType::EMPTY : cdGridCell::CellType::BLOCKED;
+        cells[idx].Type = type;
+        gridMap.SetCell(cdGridCoord(idx % cols, idx / cols), cells[idx]);
+    }
+
+    cdGridMap rebuilt(cells, cols, rows, dimension);
+    rebuilt.SetAgentSize(2);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            cdGridCoord cell(x, y);
+            EXPECT_EQ(gridMap.GetClearance(cell), rebuilt.GetClearance(cell));
+            EXPECT_EQ(gridMap.GetNeighbourMask(cell), rebuilt.GetNeighbourMask(cell));
+            EXPECT_EQ(gridMap.GetAgentNeighbourMask(cell), rebuilt.GetAgentNeighbourMask(cell));
+            for (int dir = 0; dir < 8; ++dir) {
+                cdGridCoord next(x + k_GridDirections[dir].X, y + k_GridDirections[dir].Y);
+                EXPECT_EQ((gridMap.GetAgentNeighbourMask(cell) >> dir & 1) != 0, gridMap.CellCollides(next) == false);
+            }
+        }
+    }
+}
+
+TEST(CdGridMapTest, ZeroCopyCellStorage) {
+    auto shared = std::make_shared<cdGridCellList>(100, cdGridCell());
+    (*shared)[22].Type = cdGridCell::CellType::BLOCKED;
+    std::shared_ptr<const cdGridCellList> terrain = shared;
+    cdPoint2f dimension(10, 10);
+
+    cdGridMap mapA(terrain, 10, 10, dimension);
+    cdGridMap mapB(std::span<const cdGridCell>(*terrain), 10, 10, dimension);
+
+    EXPECT_TRUE(mapA.IsCellStorageShared());
+    EXPECT_TRUE(mapB.IsCellStorageShared());
+    EXPECT_EQ(mapA.GetCells(), terrain->data());
+    EXPECT_EQ(mapB.GetCells(), terrain->data());
+    EXPECT_TRUE(mapA.CellCollides(cdGridCoord(2, 2)));
+
+    // An edit copies the cells for that map only.
+    mapA.SetCell(cdGridCoord(3, 3), cdGridCell(cdGridCell::CellType::BLOCKED));
+    EXPECT_FALSE(mapA.IsCellStorageShared());
+    EXPECT_TRUE(mapA.CellCollides(cdGridCoord(3, 3)));
+    EXPECT_FALSE(mapB.CellCollides(cdGridCoord(3, 3)));
+    EXPECT_EQ((*terrain)[33].Type, cdGridCell::CellType::EMPTY);
+
+    cdGridCellList cells(100, cdGridCell());
+    auto buffer = cells.data();
+    cdGridMap moved(std::move(cells), 10, 10, dimension);
+    EXPECT_FALSE(moved.IsCellStorageShared());
+    EXPECT_EQ(moved.GetCells(), buffer);
+}
+
+TEST(CdGridMapTest, CellCountMustFillGrid) {
+    auto terrain = std::make_shared<const cdGridCellList>(100, cdGridCell());
+    cdPoint2f dimension(10, 10);
+
+    // Short or long, the cells are rejected and the map is empty where asserts are off.
+    EXPECT_DEBUG_DEATH({
+        cdGridMap shortMap(std::span<const cdGridCell>(*terrain).first(99), 10, 10, dimension);
+        EXPECT_EQ(shortMap.GetNumCols(), 0);
+        EXPECT_EQ(shortMap.GetNumRows(), 0);
+        EXPECT_TRUE(shortMap.CellCollides(cdGridCoord(0, 0)));
+    }, "");
+    EXPECT_DEBUG_DEATH({
+        cdGridMap longMap(terrain, 9, 10, dimension);
+        EXPECT_EQ(longMap.GetNumCols(), 0);
+    }, "");
+    EXPECT_DEBUG_DEATH({
+        cdGridMap noCells(std::shared_ptr<const cdGridCellList>(), 10, 10, dimension);
+        EXPECT_EQ(noCells.GetNumCols(), 0);
+    }, "");
+
+    // No cells for no rows or columns is a map, an empty one.
+    cdGridMap empty(std::span<const cdGridCell>(), 0, 0, dimension);
+    EXPECT_EQ(empty.GetNumCols(), 0);
+    EXPECT_TRUE(empty.CellCollides(cdGridCoord(0, 0)));
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> path;
+    EXPECT_FALSE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(1, 1), &empty, path));
+}
+
+TEST(CdGridMapTest, TiledLayoutMatchesRowMajor) {
+    // Not a whole number of tiles either way.
+    const int cols = 37;
+    const int rows = 29;
+    cdGridCellList cells(cols * rows, cdGridCell());
+    unsigned seed = 11;
+    for (auto& cell : cells) {
+        seed = seed * 1103515245u + 12345u;
+        cell.Type = (seed >> 8) % 5 == 0 ? cdGridCell::CellType::BLOCKED : cdGridCell::CellType::EMPTY;
+        cell.Threat = static_cast<float>((seed >> 12) % 100) / 100.0f;
+    }
+    cdPoint2f dimension(cols, rows);
+    cdGridMap rowMajor(cells, cols, rows, dimension);
+    cdGridMap tiled(cells, cols, rows, dimension);
+    tiled.SetCellLayout(cdCellLayout::TILED);
+    EXPECT_EQ(tiled.GetCellLayout(), cdCellLayout::TILED);
+
+    auto expectSameLayers = [&]() {
+        for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < cols; ++x) {
+                cdGridCoord cell(x, y);
+                ASSERT_EQ(tiled.IsBlocked(x, y), rowMajor.IsBlocked(x, y));
+                ASSERT_EQ(tiled.CellCollides(cell), rowMajor.CellCollides(cell));
+                ASSERT_EQ(tiled.GetClearance(cell), rowMajor.GetClearance(cell));
+                ASSERT_EQ(tiled.GetNeighbourMask(cell), rowMajor.GetNeighbourMask(cell));
+                ASSERT_EQ(tiled.GetQuantizedThreat(cell), rowMajor.GetQuantizedThreat(cell));
+            }
+        }
+    };
+    expectSameLayers();
+
+    // Incremental edits keep the tiled layers in step.
+    for (int edit = 0; edit < 200; ++edit) {
+        seed = seed * 1103515245u + 12345u;
+        cdGridCoord cell(static_cast<int>((seed >> 8) % cols), static_cast<int>((seed >> 16) % rows));
+        cdGridCell value((seed >> 4) % 2 == 0 ? cdGridCell::CellType::BLOCKED : cdGridCell::CellType::EMPTY);
+        value.Threat = 0.25f;
+        rowMajor.SetCell(cell, value);
+        tiled.SetCell(cell, value);
+    }
+    expectSameLayers();
+
+    cdAStar<cdGridCoord> aStar;
+    for (auto mode : { cdSearchMode::JUMP_POINT, cdSearchMode::GRID }) {
+        rowMajor.SetSearchMode(mode);
+        tiled.SetSearchMode(mode);
+        std::vector<cdGridCoord> rowMajorPath;
+        std::vector<cdGridCoord> tiledPath;
+        auto found = aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(cols - 1, rows - 1), &rowMajor, rowMajorPath);
+        EXPECT_EQ(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(cols - 1, rows - 1), &tiled, tiledPath), found);
+        EXPECT_EQ(tiledPath, rowMajorPath);
+    }
+
+    // Map files stay row major.
+    auto path = ::testing::TempDir() + "cdgridmap_tiled_test.cdpm";
+    ASSERT_TRUE(cdMapFile::Write(path.c_str(), tiled));
+    auto file = std::make_shared<cdMapFile>();
+    ASSERT_TRUE(file->Open(path.c_str()));
+    cdGridMap loaded(file);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            cdGridCoord cell(x, y);
+            ASSERT_EQ(loaded.CellCollides(cell), rowMajor.CellCollides(cell));
+            ASSERT_EQ(loaded.GetClearance(cell), rowMajor.GetClearance(cell));
+            ASSERT_EQ(loaded.GetQuantizedThreat(cell), rowMajor.GetQuantizedThreat(cell));
+        }
+    }
+
+    tiled.SetCellLayout(cdCellLayout::ROW_MAJOR);
+    expectSameLayers();
+}
+
+TEST(CdGridMapTest, SupercoverWalk) {
+    std::vector<cdGridCoord> cells;
+    auto collect = [&cells](const cdGridCoord& cell) {
+        cells.push_back(cell);
+        return true;
+    };
+
+    WalkSupercover(cdGridCoord(0, 0), cdGridCoord(3, 1), collect);
+    std::vector<cdGridCoord> shallow = { cdGridCoord(0, 0), cdGridCoord(1, 0), cdGridCoord(2, 1), cdGridCoord(3, 1) };
+    // Crosses the middle of the cell border between x = 1 and 2, in both rows.
+    shallow.insert(shallow.begin() + 2, cdGridCoord(1, 1));
+    shallow.insert(shallow.begin() + 3, cdGridCoord(2, 0));
+    std::sort(cells.begin(), cells.end(), [](auto& a, auto& b) { return a.X != b.X ? a.X < b.X : a.Y < b.Y; });
+    std::sort(shallow.begin(), shallow.end(), [](auto& a, auto& b) { return a.X != b.X ? a.X < b.X : a.Y < b.Y; });
+    EXPECT_EQ(cells, shallow);
+
+    // Exactly through the corners, both side cells count.
+    cells.clear();
+    WalkSupercover(cdGridCoord(2, 2), cdGridCoord(0, 0), collect);
+    EXPECT_EQ(cells.size(), 7u);
+    EXPECT_EQ(cells.front(), cdGridCoord(2, 2));
+    EXPECT_EQ(cells.back(), cdGridCoord(0, 0));
+
+    cells.clear();
+    EXPECT_FALSE(WalkSupercover(cdGridCoord(0, 5), cdGridCoord(0, 0), [&cells](const cdGridCoord& cell) {
+        cells.push_back(cell);
+        return cell.Y > 3;
+    }));
+    EXPECT_EQ(cells.size(), 3u);
+}
+
+TEST(CdGridMapTest, LineOfSightShortcut) {
+    cdGridCellList cells(40 * 30, cdGridCell());
+    for (int y = 0; y < 20; ++y) {
+        cells[y * 40 + 20].Type = cdGridCell::CellType::BLOCKED;
+    }
+    cdPoint2f dimension(40, 30);
+    cdGridMap gridMap(cells, 40, 30, dimension);
+    EXPECT_TRUE(gridMap.GetLineOfSightShortcut());
+
+    // Clear exact diagonal, no search at all.
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(2, 3), cdGridCoord(11, 12), &gridMap, resultPath));
+    EXPECT_EQ(resultPath, std::vector<cdGridCoord>({ cdGridCoord(11, 12), cdGridCoord(2, 3) }));
+    EXPECT_EQ(aStar.GetNumExpansions(), 0u);
+
+    // Off axis, JPS searches for octile legs even with the line clear.
+    EXPECT_TRUE(gridMap.HasLineOfSight(cdGridCoord(2, 3), cdGridCoord(17, 12)));
+    resultPath.clear();
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(2, 3), cdGridCoord(17, 12), &gridMap, resultPath));
+    EXPECT_GT(aStar.GetNumExpansions(), 0u);
+    ASSERT_GT(resultPath.size(), 2u);
+    for (size_t i = 0; i + 1 < resultPath.size(); ++i) {
+        const int dx = abs(resultPath[i].X - resultPath[i + 1].X);
+        const int dy = abs(resultPath[i].Y - resultPath[i + 1].Y);
+        EXPECT_TRUE(dx == 0 || dy == 0 || dx == dy) << i;
+    }
+    EXPECT_FLOAT_EQ(GetOctilePathLength(resultPath), GetOctilePathLength({ cdGridCoord(17, 12), cdGridCoord(2, 3) }));
+
+    // Any-angle takes the line itself.
+    gridMap.SetSearchMode(cdSearchMode::ANY_ANGLE);
+    resultPath.clear();
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(2, 3), cdGridCoord(17, 12), &gridMap, resultPath));
+    EXPECT_EQ(resultPath, std::vector<cdGridCoord>({ cdGridCoord(17, 12), cdGridCoord(2, 3) }));
+    EXPECT_EQ(aStar.GetNumExpansions(), 0u);
+
+    // The wall is in the way.
+    EXPECT_FALSE(gridMap.HasLineOfSight(cdGridCoord(2, 3), cdGridCoord(30, 12)));
+    EXPECT_TRUE(gridMap.HasLineOfSight(cdGridCoord(2, 25), cdGridCoord(30, 21)));
+    resultPath.clear();
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(2, 3), cdGridCoord(30, 12), &gridMap, resultPath));
+    EXPECT_GT(resultPath.size(), 2u);
+    EXPECT_GT(aStar.GetNumExpansions(), 0u);
+
+    // Same path length as searching, the octile length of a straight JPS leg.
+    gridMap.SetSearchMode(cdSearchMode::JUMP_POINT);
+    resultPath.clear();
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(2, 25), cdGridCoord(30, 25), &gridMap, resultPath));
+    EXPECT_EQ(resultPath.size(), 2u);
+    EXPECT_EQ(aStar.GetNumExpansions(), 0u);
+    gridMap.SetLineOfSightShortcut(false);
+    std::vector<cdGridCoord> searched;
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(2, 25), cdGridCoord(30, 25), &gridMap, searched));
+    EXPECT_GT(aStar.GetNumExpansions(), 0u);
+    EXPECT_DOUBLE_EQ(GetOctilePathLength(resultPath), GetOctilePathLength(searched));
+
+    // Cell by cell searches never take it.
+    gridMap.SetLineOfSightShortcut(true);
+    gridMap.SetSearchMode(cdSearchMode::GRID);
+    resultPath.clear();
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(2, 3), cdGridCoord(17, 12), &gridMap, resultPath));
+    EXPECT_EQ(resultPath.size(), 16u);
+
+    // Bigger agents need the clearance along the line.
+    gridMap.SetSearchMode(cdSearchMode::JUMP_POINT);
+    gridMap.SetAgentSize(2);
+    EXPECT_TRUE(gridMap.HasLineOfSight(cdGridCoord(5, 5), cdGridCoord(15, 15)));
+    EXPECT_FALSE(gridMap.HasLineOfSight(cdGridCoord(5, 5), cdGridCoord(19, 15)));
+}
+
+TEST(CdGridMapTest, BatchedRaycasts) {
+    const int cols = 150;
+    const int rows = 37;
+    cdGridCellList cells(cols * rows, cdGridCell());
+    unsigned seed = 7;
+    for (auto& cell : cells) {
+        seed = seed * 1103515245u + 12345u;
+        cell.Type = (seed >> 8) % 9 == 0 ? cdGridCell::CellType::BLOCKED : cdGridCell::CellType::EMPTY;
+    }
+    cdPoint2f dimension(cols, rows);
+    cdGridMap gridMap(cells, cols, rows, dimension);
+    // Agent size plays no part in rays.
+    gridMap.SetAgentSize(2);
+
+    // Some ends off the map, some rays a single cell.
+    std::vector<cdGridCoord> from, to;
+    for (int i = 0; i < 1000; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        from.push_back(cdGridCoord(static_cast<int>((seed >> 4) % (cols + 4)) - 2, static_cast<int>((seed >> 12) % (rows + 4)) - 2));
+        seed = seed * 1103515245u + 12345u;
+        to.push_back(i % 50 == 0 ? from.back() :
+            cdGridCoord(static_cast<int>((seed >> 4) % (cols + 4)) - 2, static_cast<int>((seed >> 12) % (rows + 4)) - 2));
+    }
+    from.push_back(cdGridCoord(0, 0));
+    to.push_back(cdGridCoord(cols - 1, rows - 1));
+
+    // The first cell of the walk that is off the map or walled.
+    gridMap.SetAgentSize(1);
+    std::vector<u8> expectedHits;
+    std::vector<cdGridCoord> expectedFirstHits;
+    for (size_t i = 0; i < from.size(); ++i) {
+        cdGridCoord firstHit = to[i];
+        WalkSupercover(from[i], to[i], [&](const cdGridCoord& cell) {
+            if (gridMap.CellCollides(cell)) {
+                firstHit = cell;
+                return false;
+            }
+            return true;
+        });
+        expectedHits.push_back(gridMap.CellCollides(firstHit) ? 1 : 0);
+        expectedFirstHits.push_back(firstHit);
+    }
+    gridMap.SetAgentSize(2);
+    const auto expectedNumHits = static_cast<size_t>(std::count(expectedHits.begin(), expectedHits.end(), 1));
+    EXPECT_GT(expectedNumHits, 0u);
+    EXPECT_LT(expectedNumHits, from.size());
+
+    for (auto layout : { cdCellLayout::ROW_MAJOR, cdCellLayout::TILED }) {
+        gridMap.SetCellLayout(layout);
+        for (int numThreads : { 1, 3, 4 }) {
+            std::vector<u8> hits(from.size(), 2);
+            std::vector<cdGridCoord> firstHits(from.size());
+            EXPECT_EQ(gridMap.CastRays(from, to, hits, firstHits, numThreads), expectedNumHits);
+            EXPECT_EQ(hits, expectedHits);
+            EXPECT_EQ(firstHits, expectedFirstHits);
+        }
+
+        cdGridCoord firstHit;
+        for (size_t i = 0; i < from.size(); ++i) {
+            ASSERT_EQ(gridMap.CastRay(from[i], to[i], firstHit), expectedHits[i] != 0);
+            ASSERT_EQ(firstHit, expectedFirstHits[i]);
+        }
+    }
+
+    // The shortest span sets the ray count.
+    std::vector<u8> hits(10);
+    std::vector<cdGridCoord> firstHits(from.size(), cdGridCoord(-100, -100));
+    gridMap.CastRays(from, to, hits, firstHits, 2);
+    EXPECT_EQ(std::vector<cdGridCoord>(firstHits.begin(), firstHits.begin() + 10),
+        std::vector<cdGridCoord>(expectedFirstHits.begin(), expectedFirstHits.begin() + 10));
+    EXPECT_EQ(firstHits[10], cdGridCoord(-100, -100));
+}
+
+TEST(CdGridMapTest, AnyAngleSearch) {
+    auto getLength = [](const std::vector<cdGridCoord>& path) {
+        f64 length = 0;
+        for (size_t i = 0; i + 1 < path.size(); ++i) {
+            length += std::hypot(path[i + 1].X - path[i].X, path[i + 1].Y - path[i].Y);
+        }
+        return length;
+    };
+
+    cdGridCellList cells(40 * 30, cdGridCell());
+    for (int y = 0; y < 20; ++y) {
+        cells[y * 40 + 20].Type = cdGridCell::CellType::BLOCKED;
+    }
+    cdPoint2f dimension(40, 30);
+    cdGridMap gridMap(cells, 40, 30, dimension);
+    gridMap.SetSearchMode(cdSearchMode::ANY_ANGLE);
+    gridMap.SetLineOfSightShortcut(false);
+
+    // A clear line comes out of the search as one leg.
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(2, 3), cdGridCoord(17, 12), &gridMap, resultPath));
+    EXPECT_EQ(resultPath, std::vector<cdGridCoord>({ cdGridCoord(17, 12), cdGridCoord(2, 3) }));
+    EXPECT_GT(aStar.GetNumExpansions(), 0u);
+
+    // Around the end of the wall, turning once.
+    resultPath.clear();
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(2, 3), cdGridCoord(30, 12), &gridMap, resultPath));
+    ASSERT_EQ(resultPath.size(), 3u);
+    EXPECT_EQ(resultPath.front(), cdGridCoord(30, 12));
+    EXPECT_EQ(resultPath.back(), cdGridCoord(2, 3));
+    EXPECT_GE(resultPath[1].Y, 20);
+    EXPECT_LE(std::abs(resultPath[1].X - 20), 1);
+    // As short as the best single turn through any cell both ends can see, the optimum past one wall.
+    auto getBestLength = [&](const cdGridCoord& start, const cdGridCoord& goal) {
+        f64 bestLength = 1e9;
+        for (int y = 0; y < 30; ++y) {
+            for (int x = 0; x < 40; ++x) {
+                const cdGridCoord turn(x, y);
+                if (gridMap.HasLineOfSight(start, turn) && gridMap.HasLineOfSight(turn, goal)) {
+                    bestLength = std::min(bestLength, getLength({ goal, turn, start }));
+                }
+            }
+        }
+        return bestLength;
+    };
+    EXPECT_NEAR(getLength(resultPath), getBestLength(cdGridCoord(2, 3), cdGridCoord(30, 12)), 1e-4);
+    // A heuristic scaled above the straight line settles for a turn about 0.07 longer here.
+    resultPath.clear();
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(23, 0), cdGridCoord(5, 16), &gridMap, resultPath));
+    EXPECT_NEAR(getLength(resultPath), getBestLength(cdGridCoord(23, 0), cdGridCoord(5, 16)), 1e-4);
+
+    // Every leg is in line of sight and shorter than the 8-connected way on random maps.
+    unsigned seed = 3;
+    for (auto& cell : cells) {
+        seed = seed * 1103515245u + 12345u;
+        cell.Type = (seed >> 8) % 5 == 0 ? cdGridCell::CellType::BLOCKED : cdGridCell::CellType::EMPTY;
+    }
+    cdGridMap randomMap(cells, 40, 30, dimension);
+    // The rule any-angle steps follow anyway.
+    randomMap.SetCornerRule(cdCornerRule::NEVER);
+    int numFound = 0;
+    size_t gridExpansions = 0;
+    size_t anyAngleExpansions = 0;
+    for (int query = 0; query < 20; ++query) {
+        seed = seed * 1103515245u + 12345u;
+        cdGridCoord start(static_cast<int>((seed >> 4) % 40), static_cast<int>((seed >> 12) % 30));
+        seed = seed * 1103515245u + 12345u;
+        cdGridCoord goal(static_cast<int>((seed >> 4) % 40), static_cast<int>((seed >> 12) % 30));
+        if (randomMap.CellCollides(start) || randomMap.CellCollides(goal)) {
+            continue;
+        }
+
+        randomMap.SetSearchMode(cdSearchMode::GRID);
+        std::vector<cdGridCoord> gridPath;
+        const bool found = aStar.FindPath(start, goal, &randomMap, gridPath);
+        const auto numGridExpansions = aStar.GetNumExpansions();
+
+        randomMap.SetSearchMode(cdSearchMode::ANY_ANGLE);
+        std::vector<cdGridCoord> anyAnglePath;
+        ASSERT_EQ(aStar.FindPath(start, goal, &randomMap, anyAnglePath), found);
+        if (found == false) {
+            continue;
+        }
+        gridExpansions += numGridExpansions;
+        anyAngleExpansions += aStar.GetNumExpansions();
+        ++numFound;
+        EXPECT_EQ(anyAnglePath.front(), goal);
+        EXPECT_EQ(anyAnglePath.back(), start);
+        for (size_t i = 0; i + 1 < anyAnglePath.size(); ++i) {
+            EXPECT_TRUE(randomMap.HasLineOfSight(anyAnglePath[i + 1], anyAnglePath[i]));
+        }
+        EXPECT_LE(getLength(anyAnglePath), getLength(gridPath) + 1e-4);
+        EXPECT_LE(anyAnglePath.size(), gridPath.size());
+    }
+    EXPECT_GT(numFound, 5);
+    // About as many nodes as the 8-connected search a post-smoothing pass would start from, the
+    // straight line heuristic is a little weaker than the octile one.
+    EXPECT_LE(anyAngleExpansions, gridExpansions + gridExpansions / 50);
+
+    // Threat is ignored by any-angle legs but the cost mode survives the switch for GRID searches.
+    randomMap.SetSearchMode(cdSearchMode::GRID);
+    randomMap.SetCostMode(cdCostMode::THREAT_WEIGHTED);
+    randomMap.SetThreat(cdGridCoord(3, 4), randomMap.GetThreatScale());
+    randomMap.SetSearchMode(cdSearchMode::ANY_ANGLE);
+    EXPECT_EQ(randomMap.GetCostMode(), cdCostMode::THREAT_WEIGHTED);
+    EXPECT_FLOAT_EQ(randomMap.GetMovementCost(cdGridCoord(0, 0), cdGridCoord(3, 4)), 5.0f);
+    randomMap.SetSearchMode(cdSearchMode::GRID);
+    EXPECT_EQ(randomMap.GetCostMode(), cdCostMode::THREAT_WEIGHTED);
+    EXPECT_GT(randomMap.GetMovementCost(cdGridCoord(2, 3), cdGridCoord(3, 4)), 1.5f);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
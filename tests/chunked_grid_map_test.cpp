@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "cdAStar.hpp"
+#include "cdChunkedGridMap.hpp"
+#include "cdMapFile.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+constexpr int kCols = 140;
+constexpr int kRows = 100;
+
+cdGridCell MakeCell(int x, int y) {
+    // Scattered blocks with a clear border, threat rising towards the east.
+    std::minstd_rand rng(static_cast<u32>(y * kCols + x + 1));
+    bool border = x == 0 || y == 0 || x == kCols - 1 || y == kRows - 1;
+    cdGridCell cell(border == false && rng() % 5 == 0 ? cdGridCell::CellType::BLOCKED : cdGridCell::CellType::EMPTY);
+    cell.Threat = static_cast<f32>(x) / kCols;
+    return cell;
+}
+}
+
+TEST(CdChunkedGridMapTest, PagesChunksWithinBudget) {
+    auto path = ::testing::TempDir() + "cdchunkedgridmap_test.cdpm";
+    cdPoint2f dimension(kCols, kRows);
+    ASSERT_TRUE(cdMapFile::Write(path.c_str(), kCols, kRows, dimension, 1.0f,
+        [](int row, cdGridCell* cells) {
+            for (int x = 0; x < kCols; ++x) {
+                cells[x] = MakeCell(x, row);
+            }
+        }));
+
+    cdGridCellList cells;
+    for (int y = 0; y < kRows; ++y) {
+        for (int x = 0; x < kCols; ++x) {
+            cells.push_back(MakeCell(x, y));
+        }
+    }
+    cdGridMap gridMap(std::move(cells), kCols, kRows, dimension);
+    gridMap.SetSearchMode(cdSearchMode::GRID);
+
+    auto file = std::make_shared<cdMapFile>();
+    ASSERT_TRUE(file->Open(path.c_str()));
+
+    // 3 x 2 chunks in the world, at most 4 resident.
+    cdChunkedGridMap chunked(file, 64, 0);
+    EXPECT_EQ(chunked.GetMaxResidentChunks(), cdChunkedGridMap::k_MinResidentChunks);
+
+    for (int y = -1; y <= kRows; ++y) {
+        for (int x = -1; x <= kCols; ++x) {
+            cdGridCoord cell(x, y);
+            ASSERT_EQ(chunked.CellCollides(cell), gridMap.CellCollides(cell)) << x << "," << y;
+            if (x >= 0 && y >= 0 && x < kCols && y < kRows) {
+                ASSERT_EQ(chunked.GetQuantizedThreat(cell), gridMap.GetQuantizedThreat(cell));
+            }
+        }
+    }
+    EXPECT_LE(chunked.GetNumResidentChunks(), 4u);
+    EXPECT_GT(chunked.GetNumChunkEvictions(), 0u);
+
+    // Crosses a chunk border on both axes, under both cost models.
+    cdAStar<cdGridCoord> aStar;
+    for (auto mode : { cdCostMode::DISTANCE, cdCostMode::THREAT_WEIGHTED }) {
+        gridMap.SetCostMode(mode);
+        chunked.SetCostMode(mode);
+
+        std::vector<cdGridCoord> gridPath;
+        std::vector<cdGridCoord> chunkedPath;
+        EXPECT_TRUE(aStar.FindPath(cdGridCoord(40, 40), cdGridCoord(100, 80), &gridMap, gridPath));
+        // Pages the far column in so the search has to load some of its chunks again.
+        chunked.CellCollides(cdGridCoord(kCols - 1, 0));
+        chunked.CellCollides(cdGridCoord(kCols - 1, kRows - 1));
+        auto loads = chunked.GetNumChunkLoads();
+        EXPECT_TRUE(aStar.FindPath(cdGridCoord(40, 40), cdGridCoord(100, 80), &chunked, chunkedPath));
+        EXPECT_EQ(gridPath, chunkedPath);
+        EXPECT_GT(chunked.GetNumChunkLoads(), loads);
+        EXPECT_LE(chunked.GetNumResidentChunks(), 4u);
+    }
+
+    // A bigger budget keeps the whole world resident after one pass.
+    chunked.SetMemoryBudget(cdChunkedGridMap::k_DefaultMemoryBudget);
+    for (int y = 0; y < kRows; ++y) {
+        for (int x = 0; x < kCols; ++x) {
+            chunked.CellCollides(cdGridCoord(x, y));
+        }
+    }
+    EXPECT_EQ(chunked.GetNumResidentChunks(), 6u);
+    auto loads = chunked.GetNumChunkLoads();
+    chunked.CellCollides(cdGridCoord(0, 0));
+    EXPECT_EQ(chunked.GetNumChunkLoads(), loads);
+
+    // Shrinking evicts straight away, least recently used first: the top row's second and third
+    // chunks, the first was touched again above.
+    chunked.SetMemoryBudget(0);
+    EXPECT_EQ(chunked.GetNumResidentChunks(), 4u);
+    loads = chunked.GetNumChunkLoads();
+    for (auto cell : { cdGridCoord(0, 0), cdGridCoord(0, 64), cdGridCoord(64, 64), cdGridCoord(128, 64) }) {
+        chunked.CellCollides(cell);
+    }
+    EXPECT_EQ(chunked.GetNumChunkLoads(), loads);
+    chunked.CellCollides(cdGridCoord(64, 0));
+    EXPECT_EQ(chunked.GetNumChunkLoads(), loads + 1);
+}
+
+TEST(CdChunkedGridMapTest, FileNotOpen) {
+    // Asserts, and is empty where asserts are off.
+    for (auto missing : { std::shared_ptr<cdMapFile>(), std::make_shared<cdMapFile>() }) {
+        EXPECT_DEBUG_DEATH({
+            cdChunkedGridMap empty(missing);
+            EXPECT_EQ(empty.GetNumCols(), 0);
+            EXPECT_EQ(empty.GetNumRows(), 0);
+            EXPECT_TRUE(empty.CellCollides(cdGridCoord(0, 0)));
+            EXPECT_EQ(empty.GetNumChunkLoads(), 0u);
+        }, "");
+    }
+}
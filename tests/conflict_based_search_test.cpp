@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "cdConflictBasedSearch.hpp"
+#include "test_maps.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+// Paths start and end right, only take map moves and never meet.
+void CheckSolution(const cdGridMap& map, const cdConflictBasedSearch& cbs,
+    const std::vector<cdGridCoord>& starts, const std::vector<cdGridCoord>& goals) {
+    size_t length = 0;
+    f32 cost = 0.0f;
+    for (s32 agent = 0; agent < static_cast<s32>(starts.size()); ++agent) {
+        const auto& path = cbs.GetPath(agent);
+        ASSERT_FALSE(path.empty());
+        EXPECT_EQ(path.front(), starts[agent]);
+        EXPECT_EQ(path.back(), goals[agent]);
+        for (size_t t = 1; t < path.size(); ++t) {
+            if (path[t] != path[t - 1]) {
+                auto moves = map.GetCellMoves(path[t - 1]);
+                bool legal = false;
+                for (int dir = 0; dir < 8; ++dir) {
+                    legal = legal || ((moves >> dir) & 1 &&
+                        path[t - 1].X + k_GridDirections[dir].X == path[t].X &&
+                        path[t - 1].Y + k_GridDirections[dir].Y == path[t].Y);
+                }
+                EXPECT_TRUE(legal);
+            }
+        }
+        length = std::max(length, path.size());
+        cost += cbs.GetPathCost(agent);
+    }
+    EXPECT_NEAR(cost, cbs.GetCost(), 1e-3f);
+
+    auto at = [&](s32 agent, size_t t) {
+        const auto& path = cbs.GetPath(agent);
+        return t < path.size() ? path[t] : path.back();
+    };
+    for (size_t t = 0; t < length; ++t) {
+        for (s32 a = 0; a < static_cast<s32>(starts.size()); ++a) {
+            for (s32 b = a + 1; b < static_cast<s32>(starts.size()); ++b) {
+                EXPECT_NE(at(a, t), at(b, t)) << a << " and " << b << " meet at " << t;
+                if (t > 0) {
+                    EXPECT_FALSE(at(a, t) == at(b, t - 1) && at(b, t) == at(a, t - 1)) << a << " and " << b << " swap at " << t;
+                }
+            }
+        }
+    }
+}
+}
+
+TEST(CdConflictBasedSearchTest, PassesInCorridor) {
+    cdGridCellList cells(9 * 3, cdGridCell(cdGridCell::CellType::BLOCKED));
+    for (int x = 0; x < 9; ++x) {
+        cells[9 + x] = cdGridCell(cdGridCell::CellType::EMPTY);
+    }
+    cells[4] = cdGridCell(cdGridCell::CellType::EMPTY);
+    cdGridMap map(std::move(cells), 9, 3, cdPoint2f(9.0f, 3.0f));
+    map.SetSearchMode(cdSearchMode::GRID);
+    map.SetCornerRule(cdCornerRule::NEVER);
+
+    std::vector<cdGridCoord> starts = { cdGridCoord(0, 1), cdGridCoord(8, 1) };
+    std::vector<cdGridCoord> goals = { cdGridCoord(8, 1), cdGridCoord(0, 1) };
+    cdConflictBasedSearch cbs(map);
+    ASSERT_TRUE(cbs.Solve(starts, goals, 1e9));
+    EXPECT_TRUE(cbs.IsOptimal());
+    CheckSolution(map, cbs, starts, goals);
+
+    // One of them steps into the pocket and back out, the other waits a tick for it to get there.
+    EXPECT_FLOAT_EQ(cbs.GetCost(), 8.0f + 1.0f + 10.0f);
+
+    EXPECT_FALSE(cbs.Solve(starts, { cdGridCoord(3, 1), cdGridCoord(3, 1) }, 1e9));
+    EXPECT_FALSE(cbs.Solve(starts, { cdGridCoord(3, 1), cdGridCoord(3, 2) }, 1e9));
+}
+
+TEST(CdConflictBasedSearchTest, ThreadsAgreeOnCost) {
+    auto map = MakeRandomMap(10, 10, 4, 6);
+    std::vector<cdGridCoord> starts, goals;
+    std::minstd_rand rng(8);
+    while (starts.size() < 8) {
+        cdGridCoord start(static_cast<int>(rng() % 10), static_cast<int>(rng() % 10));
+        cdGridCoord goal(static_cast<int>(rng() % 10), static_cast<int>(rng() % 10));
+        if (map->CellCollides(start) || map->CellCollides(goal) ||
+            std::find(starts.begin(), starts.end(), start) != starts.end() ||
+            std::find(goals.begin(), goals.end(), goal) != goals.end()) {
+            continue;
+        }
+        cdFlowField field;
+        if (field.Build(*map, { goal }) && field.IsReachable(start)) {
+            starts.push_back(start);
+            goals.push_back(goal);
+        }
+    }
+
+    cdConflictBasedSearch single(*map);
+    ASSERT_TRUE(single.Solve(starts, goals, 1e9));
+    EXPECT_TRUE(single.IsOptimal());
+    CheckSolution(*map, single, starts, goals);
+
+    // Nobody does better than their own shortest path.
+    f32 lowerBound = 0.0f;
+    for (size_t i = 0; i < starts.size(); ++i) {
+        cdFlowField field;
+        field.Build(*map, { goals[i] });
+        lowerBound += field.GetDistance(starts[i]);
+    }
+    EXPECT_GE(single.GetCost(), lowerBound - 1e-3f);
+
+    cdConflictBasedSearch parallel(*map, 4);
+    EXPECT_EQ(parallel.GetNumThreads(), 4);
+    ASSERT_TRUE(parallel.Solve(starts, goals, 1e9));
+    EXPECT_TRUE(parallel.IsOptimal());
+    CheckSolution(*map, parallel, starts, goals);
+    EXPECT_NEAR(parallel.GetCost(), single.GetCost(), 1e-3f);
+
+    // Out of budget straight away, the answer is bounded instead.
+    cdConflictBasedSearch bounded(*map, 2);
+    ASSERT_TRUE(bounded.Solve(starts, goals, 0.0, 1.5f));
+    CheckSolution(*map, bounded, starts, goals);
+    EXPECT_LE(bounded.GetCost(), single.GetCost() * 1.5f + 1e-3f);
+    EXPECT_LE(bounded.GetNumNodes(), single.GetNumNodes());
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include "cdCooperativePlanner.hpp"
+#include "cdFlowField.hpp"
+#include "test_maps.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+// Steps every agent once and checks nobody shares a cell or swaps with another.
+void StepAndCheck(cdCooperativePlanner& planner) {
+    std::vector<cdGridCoord> before;
+    for (s32 i = 0; i < static_cast<s32>(planner.GetNumAgents()); ++i) {
+        before.push_back(planner.GetPosition(i));
+    }
+    planner.Step();
+
+    std::set<std::pair<int, int>> occupied;
+    for (s32 i = 0; i < static_cast<s32>(planner.GetNumAgents()); ++i) {
+        const auto& cell = planner.GetPosition(i);
+        EXPECT_TRUE(occupied.insert({ cell.X, cell.Y }).second) << "agent " << i << " collides";
+        for (s32 j = 0; j < i; ++j) {
+            EXPECT_FALSE(cell == before[j] && planner.GetPosition(j) == before[i]) << "agents " << i << " and " << j << " swap";
+        }
+    }
+}
+}
+
+TEST(CdCooperativePlannerTest, ReservationTable) {
+    cdReservationTable table(10);
+    cdGridCoord a(1, 1), b(2, 1);
+    EXPECT_TRUE(table.Reserve(a, 3, 0));
+    EXPECT_FALSE(table.Reserve(a, 3, 1));
+    EXPECT_TRUE(table.IsFree(a, 3, 0));
+    EXPECT_TRUE(table.IsFree(a, 4, 1));
+    EXPECT_EQ(table.GetOwner(a, 3), 0);
+
+    // Agent 0 moves a -> b while agent 1 wants b -> a over the same tick.
+    EXPECT_TRUE(table.Reserve(b, 4, 0));
+    EXPECT_TRUE(table.Reserve(b, 3, 1));
+    EXPECT_TRUE(table.IsSwap(b, a, 3, 1));
+
+    EXPECT_TRUE(table.Park(b, 10, 2));
+    EXPECT_FALSE(table.Park(b, 12, 3));
+    EXPECT_TRUE(table.IsFree(b, 9, 3));
+    EXPECT_FALSE(table.IsFree(b, 20, 3));
+
+    table.Purge(4);
+    EXPECT_EQ(table.GetOwner(a, 3), cdReservationTable::k_NoAgent);
+    table.Release(0);
+    EXPECT_EQ(table.GetOwner(b, 4), cdReservationTable::k_NoAgent);
+    table.Release(2);
+    EXPECT_EQ(table.GetOwner(b, 20), cdReservationTable::k_NoAgent);
+
+    // Parking again frees the old spot, releasing leaves the other agents alone.
+    EXPECT_TRUE(table.Park(a, 5, 4));
+    EXPECT_TRUE(table.Park(b, 5, 4));
+    EXPECT_EQ(table.GetOwner(a, 20), cdReservationTable::k_NoAgent);
+    EXPECT_EQ(table.GetOwner(b, 20), 4);
+    EXPECT_TRUE(table.Reserve(a, 6, 5));
+    table.Release(4);
+    EXPECT_EQ(table.GetOwner(b, 20), cdReservationTable::k_NoAgent);
+    EXPECT_EQ(table.GetOwner(a, 6), 5);
+    EXPECT_EQ(table.GetNumReservations(), 1u);
+}
+
+TEST(CdCooperativePlannerTest, ReverseSearchMatchesFlowField) {
+    cdGridCellList cells;
+    std::minstd_rand rng(5);
+    for (int i = 0; i < 40 * 30; ++i) {
+        cdGridCell cell(rng() % 4 == 0 ? cdGridCell::CellType::BLOCKED : cdGridCell::CellType::EMPTY);
+        cell.Threat = static_cast<f32>(rng() % 100) / 100.0f;
+        cells.push_back(cell);
+    }
+    cdGridMap map(std::move(cells), 40, 30, cdPoint2f(40.0f, 30.0f));
+    map.SetSearchMode(cdSearchMode::GRID);
+    map.SetCostMode(cdCostMode::THREAT_WEIGHTED);
+    cdGridCoord goal(30, 20);
+    map.SetCell(goal, cdGridCell(cdGridCell::CellType::EMPTY));
+
+    cdFlowField field;
+    ASSERT_TRUE(field.Build(map, { goal }));
+    cdReverseResumableSearch search(map, goal, cdGridCoord(2, 2));
+    for (int y = 0; y < 30; ++y) {
+        for (int x = 0; x < 40; ++x) {
+            cdGridCoord cell(x, y);
+            if (field.IsReachable(cell)) {
+                EXPECT_NEAR(search.GetDistance(cell), field.GetDistance(cell), 1e-3f);
+            } else {
+                EXPECT_EQ(search.GetDistance(cell), cdFlowField::k_Unreachable);
+            }
+        }
+    }
+}
+
+TEST(CdCooperativePlannerTest, PassesInCorridor) {
+    // A one wide corridor with a single pocket to step aside into.
+    auto map = MakeRandomMap(9, 3, 0, 0);
+    for (int x = 0; x < 9; ++x) {
+        if (x != 4) {
+            map->SetCell(cdGridCoord(x, 0), cdGridCell(cdGridCell::CellType::BLOCKED));
+        }
+        map->SetCell(cdGridCoord(x, 2), cdGridCell(cdGridCell::CellType::BLOCKED));
+    }
+
+    cdCooperativePlanner planner(*map, 16);
+    auto first = planner.AddAgent(cdGridCoord(0, 1), cdGridCoord(8, 1));
+    auto second = planner.AddAgent(cdGridCoord(8, 1), cdGridCoord(0, 1));
+    ASSERT_NE(first, -1);
+    ASSERT_NE(second, -1);
+    EXPECT_EQ(planner.AddAgent(cdGridCoord(8, 1), cdGridCoord(1, 1)), -1);
+    EXPECT_EQ(planner.AddAgent(cdGridCoord(4, 2), cdGridCoord(1, 1)), -1);
+
+    for (int tick = 0; tick < 40; ++tick) {
+        planner.Update(1e6);
+        StepAndCheck(planner);
+    }
+    EXPECT_EQ(planner.GetPosition(first), cdGridCoord(8, 1));
+    EXPECT_EQ(planner.GetPosition(second), cdGridCoord(0, 1));
+}
+
+TEST(CdCooperativePlannerTest, ManyAgents) {
+    auto map = MakeRandomMap(32, 32, 0, 0);
+    cdCooperativePlanner planner(*map);
+
+    std::minstd_rand rng(11);
+    std::set<std::pair<int, int>> starts, goals;
+    while (planner.GetNumAgents() < 60) {
+        cdGridCoord start(static_cast<int>(rng() % 32), static_cast<int>(rng() % 32));
+        cdGridCoord goal(static_cast<int>(rng() % 32), static_cast<int>(rng() % 32));
+        if (starts.count({ start.X, start.Y }) != 0 || goals.insert({ goal.X, goal.Y }).second == false) {
+            continue;
+        }
+        starts.insert({ start.X, start.Y });
+        ASSERT_NE(planner.AddAgent(start, goal), -1);
+    }
+
+    // No budget still plans one agent a tick.
+    EXPECT_EQ(planner.Update(0.0), 1u);
+    EXPECT_EQ(planner.GetNumReplans(), 1u);
+
+    for (int tick = 0; tick < 120; ++tick) {
+        planner.Update(1e6);
+        StepAndCheck(planner);
+    }
+
+    for (s32 i = 0; i < static_cast<s32>(planner.GetNumAgents()); ++i) {
+        EXPECT_EQ(planner.GetPosition(i), planner.GetGoal(i)) << "agent " << i;
+    }
+    EXPECT_GT(planner.GetNumExpansions(), 0u);
+}
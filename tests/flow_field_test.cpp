@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "cdAStar.hpp"
+#include "cdFlowField.hpp"
+#include "test_maps.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+// FindPath paths run from the goal back to the start.
+f32 GetPathCost(cdGridMap& map, const cdGridCoord& start, const std::vector<cdGridCoord>& path) {
+    f32 cost = 0.0f;
+    auto previous = start;
+    for (auto cell = path.rbegin(); cell != path.rend(); ++cell) {
+        if (*cell != previous) {
+            cost += map.GetMovementCost(previous, *cell);
+        }
+        previous = *cell;
+    }
+    return cost;
+}
+}
+
+TEST(CdFlowFieldTest, FollowsCheapestPath) {
+    auto map = MakeRandomMap(30, 24, 3, 5, true);
+    map->SetCostMode(cdCostMode::THREAT_WEIGHTED);
+    map->SetCornerRule(cdCornerRule::NEVER);
+    cdGridCoord goal(20, 15);
+    map->SetCell(goal, cdGridCell(cdGridCell::CellType::EMPTY));
+
+    cdFlowField field;
+    ASSERT_TRUE(field.Build(*map, { goal }));
+    EXPECT_EQ(field.GetDistance(goal), 0.0f);
+    EXPECT_EQ(field.GetDirection(goal), cdFlowField::k_NoDirection);
+
+    cdAStar<cdGridCoord> aStar;
+    std::minstd_rand rng(9);
+    for (int i = 0; i < 20; ++i) {
+        cdGridCoord start(static_cast<int>(rng() % 30), static_cast<int>(rng() % 24));
+        if (map->CellCollides(start) || field.IsReachable(start) == false) {
+            continue;
+        }
+
+        // Walking the field adds up to its distance and ends on the goal.
+        f32 walked = 0.0f;
+        auto cell = start;
+        for (int steps = 0; steps < 30 * 24 && cell != goal; ++steps) {
+            auto next = field.GetNextCell(cell);
+            ASSERT_NE(next, cell);
+            ASSERT_FALSE(map->CellCollides(next));
+            walked += map->GetMovementCost(cell, next);
+            cell = next;
+        }
+        EXPECT_EQ(cell, goal);
+        EXPECT_NEAR(walked, field.GetDistance(start), 1e-3f);
+
+        // Never worse than what A* finds.
+        std::vector<cdGridCoord> path;
+        ASSERT_TRUE(aStar.FindPath(start, goal, map.get(), path));
+        EXPECT_LE(field.GetDistance(start), GetPathCost(*map, start, path) + 1e-3f);
+    }
+}
+
+TEST(CdFlowFieldTest, GridSearchesAreOptimal) {
+    // The octile heuristic never overestimates, so GRID A* lands on the field's distance.
+    cdAStar<cdGridCoord> aStar;
+    for (u32 seed = 11; seed < 15; ++seed) {
+        auto map = MakeRandomMap(40, 32, seed, 5, true);
+        map->SetCostMode(seed % 2 == 0 ? cdCostMode::DISTANCE : cdCostMode::THREAT_WEIGHTED);
+        map->SetCornerRule(seed % 3 == 0 ? cdCornerRule::ALWAYS : cdCornerRule::NEVER);
+        cdGridCoord goal(static_cast<int>(seed * 7 % 40), static_cast<int>(seed * 5 % 32));
+        map->SetCell(goal, cdGridCell(cdGridCell::CellType::EMPTY));
+
+        cdFlowField field;
+        ASSERT_TRUE(field.Build(*map, { goal }));
+
+        std::minstd_rand rng(seed);
+        for (int i = 0; i < 30; ++i) {
+            cdGridCoord start(static_cast<int>(rng() % 40), static_cast<int>(rng() % 32));
+            if (map->CellCollides(start) || field.IsReachable(start) == false) {
+                continue;
+            }
+
+            std::vector<cdGridCoord> path;
+            ASSERT_TRUE(aStar.FindPath(start, goal, map.get(), path));
+            EXPECT_NEAR(GetPathCost(*map, start, path), field.GetDistance(start), 1e-3f)
+                << "seed " << seed << " from " << start.X << "," << start.Y;
+        }
+    }
+}
+
+TEST(CdFlowFieldTest, ThreadedMatchesSingleThreaded) {
+    auto map = MakeRandomMap(150, 130, 5, 5, true);
+    map->SetCostMode(cdCostMode::THREAT_WEIGHTED);
+    std::vector<cdGridCoord> goals = { cdGridCoord(3, 4), cdGridCoord(140, 120), cdGridCoord(70, 66) };
+    for (const auto& goal : goals) {
+        map->SetCell(goal, cdGridCell(cdGridCell::CellType::EMPTY));
+    }
+
+    cdFlowField single;
+    cdFlowField threaded;
+    ASSERT_TRUE(single.Build(*map, goals));
+    ASSERT_TRUE(threaded.Build(*map, goals, 4));
+    EXPECT_EQ(single.GetNumTileRuns(), 0u);
+    EXPECT_GT(threaded.GetNumTileRuns(), 0u);
+
+    for (int y = 0; y < 130; ++y) {
+        for (int x = 0; x < 150; ++x) {
+            cdGridCoord cell(x, y);
+            ASSERT_EQ(threaded.GetDistance(cell), single.GetDistance(cell)) << x << "," << y;
+            ASSERT_EQ(threaded.GetDirection(cell), single.GetDirection(cell)) << x << "," << y;
+        }
+    }
+}
+
+TEST(CdFlowFieldTest, UnreachableCellsAndBadGoals) {
+    // A pocket walled off in the corner.
+    cdGridCellList cells(100, cdGridCell());
+    for (int i = 0; i < 3; ++i) {
+        cells[2 * 10 + i].Type = cdGridCell::CellType::BLOCKED;
+        cells[i * 10 + 2].Type = cdGridCell::CellType::BLOCKED;
+    }
+    cdGridMap map(std::move(cells), 10, 10, cdPoint2f(10, 10));
+
+    cdFlowField field;
+    EXPECT_FALSE(field.Build(map, { cdGridCoord(2, 2), cdGridCoord(-1, 4) }));
+    ASSERT_TRUE(field.Build(map, { cdGridCoord(2, 2), cdGridCoord(9, 9) }));
+
+    EXPECT_FALSE(field.IsReachable(cdGridCoord(0, 0)));
+    EXPECT_EQ(field.GetDistance(cdGridCoord(1, 1)), cdFlowField::k_Unreachable);
+    EXPECT_EQ(field.GetNextCell(cdGridCoord(1, 1)), cdGridCoord(1, 1));
+    EXPECT_TRUE(field.IsReachable(cdGridCoord(3, 3)));
+    EXPECT_EQ(field.GetNextCell(cdGridCoord(9, 8)), cdGridCoord(9, 9));
+}
@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include "cdInfluenceMap.hpp"
+
+using namespace ceed::ai::path;
+
+TEST(CdInfluenceMapTest, PropagateOnlyDirtyTiles) {
+    cdInfluenceMap influence(64, 64, 16);
+    influence.SetDecay(0.5f);
+    influence.AddSource(cdGridCoord(2, 2), 4.0f);
+    influence.Propagate();
+
+    // Source tile plus its 3 neighbours in the corner.
+    EXPECT_EQ(influence.GetNumDirtyTiles(), 4);
+    EXPECT_TRUE(influence.IsTileDirty(cdGridCoord(17, 17)));
+    EXPECT_FALSE(influence.IsTileDirty(cdGridCoord(40, 40)));
+
+    // 3 tap kernel along rows then columns.
+    EXPECT_FLOAT_EQ(influence.GetValue(cdGridCoord(2, 2)), 1.0f);
+    EXPECT_FLOAT_EQ(influence.GetValue(cdGridCoord(3, 2)), 0.5f);
+    EXPECT_FLOAT_EQ(influence.GetValue(cdGridCoord(3, 3)), 0.25f);
+    EXPECT_FLOAT_EQ(influence.GetValue(cdGridCoord(4, 2)), 0.0f);
+
+    // Without sources everything decays away and the tiles go back to sleep.
+    for (int tick = 0; tick < 64; ++tick) {
+        influence.Propagate();
+    }
+    EXPECT_EQ(influence.GetNumDirtyTiles(), 0);
+    EXPECT_FLOAT_EQ(influence.GetValue(cdGridCoord(2, 2)), 0.0f);
+}
+
+TEST(CdInfluenceMapTest, SeparableKernelAcrossTiles) {
+    cdInfluenceMap influence(40, 40, 8);
+    EXPECT_FALSE(influence.SetKernel({ 0.5f, 0.5f }));
+    EXPECT_TRUE(influence.SetKernel({ 0.1f, 0.2f, 0.4f, 0.2f, 0.1f }));
+    influence.SetDecay(0.0f);
+
+    // Right on a tile corner so the blur has to cross into all 4 tiles.
+    influence.AddSource(cdGridCoord(8, 8), 1.0f);
+    influence.Propagate();
+
+    EXPECT_FLOAT_EQ(influence.GetValue(cdGridCoord(8, 8)), 0.16f);
+    EXPECT_FLOAT_EQ(influence.GetValue(cdGridCoord(6, 10)), 0.01f);
+    EXPECT_FLOAT_EQ(influence.GetValue(cdGridCoord(7, 8)), 0.08f);
+    EXPECT_FLOAT_EQ(influence.GetValue(cdGridCoord(10, 7)), 0.02f);
+    EXPECT_FLOAT_EQ(influence.GetValue(cdGridCoord(11, 8)), 0.0f);
+}
+
+TEST(CdInfluenceMapTest, ApplyToGridMapThreat) {
+    cdGridCellList cells(32 * 32, cdGridCell());
+    cdPoint2f dimension(32, 32);
+    cdGridMap gridMap(cells, 32, 32, dimension);
+    gridMap.SetSearchMode(cdSearchMode::GRID);
+    gridMap.SetCostMode(cdCostMode::THREAT_WEIGHTED);
+
+    cdInfluenceMap influence(gridMap, 16);
+    influence.AddSource(cdGridCoord(20, 20), 4.0f);
+    influence.Propagate();
+    influence.Apply(gridMap);
+
+    EXPECT_EQ(gridMap.GetQuantizedThreat(cdGridCoord(20, 20)), 255);
+    EXPECT_GT(gridMap.GetMovementCost(cdGridCoord(19, 20), cdGridCoord(20, 20)), 1.0f);
+    EXPECT_FLOAT_EQ(gridMap.GetMovementCost(cdGridCoord(0, 0), cdGridCoord(1, 0)), 1.0f);
+}
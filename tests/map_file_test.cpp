@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include "cdAStar.hpp"
+#include "cdMapFile.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+cdGridCellList MakeWallCells() {
+    // Wall at x = 4 with a gap at y = 9, threat on the column next to it.
+    cdGridCellList cells(100, cdGridCell());
+    for (int y = 0; y < 9; ++y) {
+        cells[y * 10 + 4].Type = cdGridCell::CellType::BLOCKED;
+        cells[y * 10 + 3].Threat = 0.5f;
+    }
+    return cells;
+}
+}
+
+TEST(CdMapFileTest, WriteAndMapBack) {
+    auto path = ::testing::TempDir() + "cdmapfile_test.cdpm";
+    cdPoint2f dimension(10, 10);
+    cdGridMap source(MakeWallCells(), 10, 10, dimension);
+    source.BuildGoalBounds();
+    ASSERT_TRUE(cdMapFile::Write(path.c_str(), source));
+
+    auto file = std::make_shared<cdMapFile>();
+    ASSERT_TRUE(file->Open(path.c_str()));
+    EXPECT_EQ(file->GetHeader()->NumCols, 10);
+    EXPECT_EQ(file->GetHeader()->NumRows, 10);
+
+    cdGridMap loaded(file);
+    EXPECT_EQ(loaded.GetCells(), nullptr);
+    EXPECT_TRUE(loaded.IsLayerStorageShared());
+    EXPECT_TRUE(loaded.HasGoalBounds());
+    EXPECT_EQ(loaded.GetDimension().x, 10);
+
+    for (int y = 0; y < 10; ++y) {
+        for (int x = 0; x < 10; ++x) {
+            cdGridCoord cell(x, y);
+            EXPECT_EQ(loaded.CellCollides(cell), source.CellCollides(cell));
+            EXPECT_EQ(loaded.GetClearance(cell), source.GetClearance(cell));
+            EXPECT_EQ(loaded.GetQuantizedThreat(cell), source.GetQuantizedThreat(cell));
+        }
+    }
+    EXPECT_EQ(loaded.GetCell(cdGridCoord(4, 0)).Type, cdGridCell::CellType::BLOCKED);
+    EXPECT_NEAR(loaded.GetCell(cdGridCoord(3, 0)).Threat, 0.5f, 0.01f);
+
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> sourcePath;
+    std::vector<cdGridCoord> loadedPath;
+    EXPECT_TRUE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(9, 0), &source, sourcePath));
+    EXPECT_TRUE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(9, 0), &loaded, loadedPath));
+    EXPECT_EQ(sourcePath, loadedPath);
+
+    // Edits copy the touched layers out of the mapping, the file stays as it was.
+    loaded.SetCell(cdGridCoord(4, 9), cdGridCell(cdGridCell::CellType::BLOCKED));
+    EXPECT_TRUE(loaded.CellCollides(cdGridCoord(4, 9)));
+    cdGridMap reloaded(file);
+    EXPECT_FALSE(reloaded.CellCollides(cdGridCoord(4, 9)));
+}
+
+TEST(CdMapFileTest, OptionalTablesAndBadFiles) {
+    auto path = ::testing::TempDir() + "cdmapfile_minimal.cdpm";
+    cdPoint2f dimension(10, 10);
+    cdGridMap source(MakeWallCells(), 10, 10, dimension);
+    ASSERT_TRUE(cdMapFile::Write(path.c_str(), source, 0));
+
+    auto file = std::make_shared<cdMapFile>();
+    ASSERT_TRUE(file->Open(path.c_str()));
+    size_t size = 0;
+    EXPECT_EQ(file->GetSection(cdMapFile::SECTION_CLEARANCE, size), nullptr);
+
+    // Missing tables are rebuilt from the occupancy.
+    cdGridMap loaded(file);
+    EXPECT_EQ(loaded.GetClearance(cdGridCoord(2, 4)), 2);
+    EXPECT_EQ(loaded.GetNeighbourMask(cdGridCoord(0, 0)), source.GetNeighbourMask(cdGridCoord(0, 0)));
+
+    auto badPath = ::testing::TempDir() + "cdmapfile_bad.cdpm";
+    auto bad = fopen(badPath.c_str(), "wb");
+    ASSERT_NE(bad, nullptr);
+    fputs("not a map", bad);
+    fclose(bad);
+
+    cdMapFile badFile;
+    EXPECT_FALSE(badFile.Open(badPath.c_str()));
+    EXPECT_FALSE(badFile.IsOpen());
+    EXPECT_FALSE(badFile.Open((::testing::TempDir() + "does_not_exist.cdpm").c_str()));
+
+    // Maps over a file that did not open assert, and are empty where asserts are off.
+    for (auto missing : { std::shared_ptr<cdMapFile>(), std::make_shared<cdMapFile>() }) {
+        EXPECT_DEBUG_DEATH({
+            cdGridMap empty(missing);
+            EXPECT_EQ(empty.GetNumCols(), 0);
+            EXPECT_EQ(empty.GetNumRows(), 0);
+            EXPECT_TRUE(empty.CellCollides(cdGridCoord(0, 0)));
+            cdAStar<cdGridCoord> aStar;
+            std::vector<cdGridCoord> path;
+            EXPECT_FALSE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(1, 1), &empty, path));
+        }, "");
+    }
+}
+
+#ifndef _WIN32
+TEST(CdMapFileTest, SharedSegment) {
+    auto name = "/cdmapfile_test_" + std::to_string(getpid());
+    cdPoint2f dimension(10, 10);
+    cdGridMap source(MakeWallCells(), 10, 10, dimension);
+    source.BuildGoalBounds();
+    ASSERT_TRUE(cdMapFile::CreateShared(name.c_str(), source));
+
+    // Two attachments stand in for two server processes.
+    auto first = std::make_shared<cdMapFile>();
+    auto second = std::make_shared<cdMapFile>();
+    ASSERT_TRUE(first->OpenShared(name.c_str()));
+    ASSERT_TRUE(second->OpenShared(name.c_str()));
+
+    cdGridMap loaded(first);
+    EXPECT_TRUE(loaded.IsLayerStorageShared());
+    EXPECT_TRUE(loaded.HasGoalBounds());
+    for (int y = 0; y < 10; ++y) {
+        for (int x = 0; x < 10; ++x) {
+            cdGridCoord cell(x, y);
+            EXPECT_EQ(loaded.CellCollides(cell), source.CellCollides(cell));
+            EXPECT_EQ(loaded.GetClearance(cell), source.GetClearance(cell));
+        }
+    }
+
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> sourcePath;
+    std::vector<cdGridCoord> loadedPath;
+    EXPECT_TRUE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(9, 0), &source, sourcePath));
+    EXPECT_TRUE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(9, 0), &loaded, loadedPath));
+    EXPECT_EQ(sourcePath, loadedPath);
+
+    // Edits stay in the process that made them.
+    loaded.SetCell(cdGridCoord(4, 9), cdGridCell(cdGridCell::CellType::BLOCKED));
+    cdGridMap other(second);
+    EXPECT_FALSE(other.CellCollides(cdGridCoord(4, 9)));
+
+    // Unlinking only stops new attachments.
+    EXPECT_TRUE(cdMapFile::RemoveShared(name.c_str()));
+    EXPECT_FALSE(cdMapFile().OpenShared(name.c_str()));
+    EXPECT_TRUE(other.CellCollides(cdGridCoord(4, 0)));
+}
+#endif
+
+TEST(CdMapFileTest, GoalBoundsKeepAgentSize) {
+    auto path = ::testing::TempDir() + "cdmapfile_agent2.cdpm";
+    cdPoint2f dimension(10, 10);
+    cdGridMap source(MakeWallCells(), 10, 10, dimension);
+    source.SetAgentSize(2);
+    source.BuildGoalBounds();
+    ASSERT_TRUE(cdMapFile::Write(path.c_str(), source));
+
+    auto file = std::make_shared<cdMapFile>();
+    ASSERT_TRUE(file->Open(path.c_str()));
+    EXPECT_EQ(file->FindSection(cdMapFile::SECTION_GOAL_BOUNDS)->Param, 2u);
+
+    // Loaded maps start at agent size 1, the bounds wait for the size they were built for.
+    cdGridMap loaded(file);
+    EXPECT_TRUE(loaded.HasGoalBounds());
+    EXPECT_EQ(loaded.GetGoalBoundsAgentSize(), 2);
+
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> sourcePath;
+    std::vector<cdGridCoord> loadedPath;
+    source.SetAgentSize(1);
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(9, 0), &source, sourcePath));
+    auto unboundedExpansions = aStar.GetNumExpansions();
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(9, 0), &loaded, loadedPath));
+    EXPECT_EQ(aStar.GetNumExpansions(), unboundedExpansions);
+    EXPECT_EQ(sourcePath, loadedPath);
+
+    source.SetAgentSize(2);
+    loaded.SetAgentSize(2);
+    sourcePath.clear();
+    loadedPath.clear();
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(1, 1), cdGridCoord(2, 7), &source, sourcePath));
+    auto boundedExpansions = aStar.GetNumExpansions();
+    ASSERT_TRUE(aStar.FindPath(cdGridCoord(1, 1), cdGridCoord(2, 7), &loaded, loadedPath));
+    EXPECT_EQ(aStar.GetNumExpansions(), boundedExpansions);
+    EXPECT_EQ(sourcePath, loadedPath);
+
+#ifndef _WIN32
+    auto name = "/cdmapfile_agent2_" + std::to_string(getpid());
+    ASSERT_TRUE(cdMapFile::CreateShared(name.c_str(), source));
+    auto shared = std::make_shared<cdMapFile>();
+    ASSERT_TRUE(shared->OpenShared(name.c_str()));
+    EXPECT_EQ(cdGridMap(shared).GetGoalBoundsAgentSize(), 2);
+    EXPECT_TRUE(cdMapFile::RemoveShared(name.c_str()));
+#endif
+
+    // Bounds built for MovingAI steps wait for a map that steps the same way.
+    auto movingAIPath = ::testing::TempDir() + "cdmapfile_never.cdpm";
+    cdGridMap movingAI(MakeWallCells(), 10, 10, dimension);
+    movingAI.SetCornerRule(cdCornerRule::NEVER);
+    movingAI.SetDiagonalStepLength(std::sqrt(2.0f));
+    movingAI.BuildGoalBounds();
+    ASSERT_TRUE(cdMapFile::Write(movingAIPath.c_str(), movingAI));
+    auto movingAIFile = std::make_shared<cdMapFile>();
+    ASSERT_TRUE(movingAIFile->Open(movingAIPath.c_str()));
+    auto section = movingAIFile->FindSection(cdMapFile::SECTION_GOAL_BOUNDS);
+    EXPECT_EQ(section->Param2, static_cast<u32>(cdCornerRule::NEVER));
+    EXPECT_EQ(section->ParamF, std::sqrt(2.0f));
+
+    cdGridMap movingAILoaded(movingAIFile);
+    EXPECT_TRUE(movingAILoaded.HasGoalBounds());
+    EXPECT_FALSE(movingAILoaded.GetGoalBoundsEnabled());
+    movingAILoaded.SetCornerRule(cdCornerRule::NEVER);
+    EXPECT_FALSE(movingAILoaded.GetGoalBoundsEnabled());
+    movingAILoaded.SetDiagonalStepLength(std::sqrt(2.0f));
+    EXPECT_TRUE(movingAILoaded.GetGoalBoundsEnabled());
+
+    // A goal bounds section that does not say which agent size it is for is refused.
+    file.reset();
+    auto patched = fopen(path.c_str(), "r+b");
+    ASSERT_NE(patched, nullptr);
+    cdMapFileHeader header;
+    ASSERT_EQ(fread(&header, sizeof(header), 1, patched), 1u);
+    for (u32 i = 0; i < header.NumSections; ++i) {
+        if (header.Sections[i].Type == cdMapFile::SECTION_GOAL_BOUNDS) {
+            header.Sections[i].Param = 0;
+        }
+    }
+    fseek(patched, 0, SEEK_SET);
+    ASSERT_EQ(fwrite(&header, sizeof(header), 1, patched), 1u);
+    fclose(patched);
+    EXPECT_FALSE(cdMapFile().Open(path.c_str()));
+}
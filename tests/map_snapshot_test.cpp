@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include "cdAStar.hpp"
+#include "cdMapSnapshot.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+constexpr int kCols = 60;
+constexpr int kRows = 100;
+
+std::unique_ptr<cdGridMap> MakeMap() {
+    cdGridCellList cells;
+    std::minstd_rand rng(7);
+    for (int y = 0; y < kRows; ++y) {
+        for (int x = 0; x < kCols; ++x) {
+            bool border = x == 0 || y == 0 || x == kCols - 1 || y == kRows - 1;
+            cdGridCell cell(border == false && rng() % 6 == 0 ? cdGridCell::CellType::BLOCKED : cdGridCell::CellType::EMPTY);
+            cell.Threat = static_cast<f32>(y) / kRows;
+            cells.push_back(cell);
+        }
+    }
+    return std::make_unique<cdGridMap>(std::move(cells), kCols, kRows,
+        cdPoint2f(static_cast<f32>(kCols), static_cast<f32>(kRows)));
+}
+}
+
+TEST(CdMapSnapshotTest, MatchesMap) {
+    auto map = MakeMap();
+    cdGridCoord start(2, 2);
+    cdGridCoord goal(kCols - 3, kRows - 3);
+    map->SetCell(start, cdGridCell(cdGridCell::CellType::EMPTY));
+    map->SetCell(goal, cdGridCell(cdGridCell::CellType::EMPTY));
+
+    for (auto mode : { cdSearchMode::JUMP_POINT, cdSearchMode::GRID, cdSearchMode::ANY_ANGLE }) {
+        map->SetSearchMode(mode);
+        cdSnapshotPublisher publisher(*map);
+        int reader = publisher.AddReader();
+        ASSERT_GE(reader, 0);
+
+        cdSnapshotGuard snapshot(publisher, reader);
+        EXPECT_EQ(snapshot->GetVersion(), map->GetVersion());
+        for (int y = -1; y <= kRows; ++y) {
+            for (int x = -1; x <= kCols; ++x) {
+                cdGridCoord cell(x, y);
+                ASSERT_EQ(snapshot->CellCollides(cell), map->CellCollides(cell)) << x << "," << y;
+                if (x >= 0 && y >= 0 && x < kCols && y < kRows) {
+                    ASSERT_EQ(snapshot->GetQuantizedThreat(cell), map->GetQuantizedThreat(cell));
+                }
+            }
+        }
+
+        cdAStar<cdGridCoord> aStar;
+        std::vector<cdGridCoord> mapPath;
+        std::vector<cdGridCoord> snapshotPath;
+        ASSERT_TRUE(aStar.FindPath(start, goal, map.get(), mapPath));
+        ASSERT_TRUE(aStar.FindPath(start, goal, snapshot.Get(), snapshotPath));
+        EXPECT_EQ(snapshotPath, mapPath);
+        publisher.RemoveReader(reader);
+    }
+}
+
+TEST(CdMapSnapshotTest, PublishCopiesEditedChunksOnly) {
+    auto map = MakeMap();
+    cdSnapshotPublisher publisher(*map);
+    int reader = publisher.AddReader();
+    int other = publisher.AddReader();
+    ASSERT_NE(reader, other);
+
+    cdGridCoord edited(10, 40);
+    cdGridCell blocked(cdGridCell::CellType::BLOCKED);
+    map->SetCell(edited, cdGridCell(cdGridCell::CellType::EMPTY));
+    publisher.Publish();
+
+    {
+        cdSnapshotGuard before(publisher, reader);
+        EXPECT_FALSE(before->CellCollides(edited));
+
+        map->SetCell(edited, blocked);
+        publisher.Publish();
+
+        // The pinned snapshot keeps its version and its memory.
+        EXPECT_FALSE(before->CellCollides(edited));
+        EXPECT_EQ(publisher.GetNumRetired(), 1u);
+
+        cdSnapshotGuard after(publisher, other);
+        EXPECT_TRUE(after->CellCollides(edited));
+        EXPECT_NE(after->GetVersion(), before->GetVersion());
+
+        const int editedChunk = map->GetChunkIndex(edited);
+        for (int chunk = 0; chunk < map->GetNumChunks(); ++chunk) {
+            if (chunk == editedChunk) {
+                EXPECT_NE(after->GetChunkData(chunk), before->GetChunkData(chunk));
+            } else {
+                EXPECT_EQ(after->GetChunkData(chunk), before->GetChunkData(chunk)) << chunk;
+            }
+        }
+    }
+
+    // Released, the next publish frees it.
+    publisher.Publish();
+    EXPECT_EQ(publisher.GetNumRetired(), 0u);
+    publisher.RemoveReader(reader);
+    publisher.RemoveReader(other);
+}
+
+TEST(CdMapSnapshotTest, CostSettingsShareEveryChunk) {
+    auto map = MakeMap();
+    map->SetCostMode(cdCostMode::THREAT_WEIGHTED);
+    cdSnapshotPublisher publisher(*map);
+    int reader = publisher.AddReader();
+    int other = publisher.AddReader();
+    cdGridCoord from(5, 50), to(6, 50);
+
+    {
+        cdSnapshotGuard before(publisher, reader);
+        map->SetThreatWeight(3.0f);
+        map->SetDiagonalStepLength(1.41421356f);
+        publisher.Publish();
+
+        // The cost table and diagonal length travel with the snapshot, the chunks are shared.
+        cdSnapshotGuard after(publisher, other);
+        EXPECT_NE(after->GetVersion(), before->GetVersion());
+        EXPECT_FLOAT_EQ(after->GetMovementCost(from, to), map->GetMovementCost(from, to));
+        EXPECT_GT(after->GetMovementCost(from, to), before->GetMovementCost(from, to));
+        for (int chunk = 0; chunk < map->GetNumChunks(); ++chunk) {
+            EXPECT_EQ(after->GetChunkData(chunk), before->GetChunkData(chunk)) << chunk;
+        }
+    }
+
+    publisher.RemoveReader(reader);
+    publisher.RemoveReader(other);
+}
+
+TEST(CdMapSnapshotTest, AgentSizeCopiesMasks) {
+    auto map = MakeMap();
+    map->SetSearchMode(cdSearchMode::GRID);
+    cdGridCoord start(2, 2), goal(kCols - 3, kRows - 3);
+    cdSnapshotPublisher publisher(*map);
+    int reader = publisher.AddReader();
+    int other = publisher.AddReader();
+
+    {
+        cdSnapshotGuard before(publisher, reader);
+        map->SetAgentSize(2);
+        publisher.Publish();
+
+        // The masks are the agent's, so no chunk is shared with the single cell snapshot.
+        cdSnapshotGuard after(publisher, other);
+        for (int chunk = 0; chunk < map->GetNumChunks(); ++chunk) {
+            EXPECT_NE(after->GetChunkData(chunk), before->GetChunkData(chunk)) << chunk;
+        }
+
+        cdAStar<cdGridCoord> aStar;
+        std::vector<cdGridCoord> mapPath, snapshotPath;
+        const bool found = aStar.FindPath(start, goal, map.get(), mapPath);
+        EXPECT_EQ(aStar.FindPath(start, goal, after.Get(), snapshotPath), found);
+        EXPECT_EQ(snapshotPath, mapPath);
+    }
+
+    publisher.RemoveReader(reader);
+    publisher.RemoveReader(other);
+}
+
+TEST(CdMapSnapshotTest, ReclaimWaitsForReaders) {
+    auto map = MakeMap();
+    cdSnapshotPublisher publisher(*map);
+    int reader = publisher.AddReader();
+
+    cdMapSnapshot* pinned = publisher.Acquire(reader);
+    for (int i = 0; i < 3; ++i) {
+        map->SetThreatRow(0, i, kCols, std::vector<f32>(kCols, 0.5f).data());
+        publisher.Publish();
+    }
+    EXPECT_EQ(publisher.GetNumRetired(), 3u);
+    EXPECT_EQ(pinned->GetQuantizedThreat(cdGridCoord(1, 0)), 0);
+    EXPECT_NE(map->GetQuantizedThreat(cdGridCoord(1, 0)), 0);
+
+    // A reader that pins the newest snapshot does not hold back the older ones.
+    publisher.Release(reader);
+    publisher.Acquire(reader);
+    EXPECT_EQ(publisher.Reclaim(), 3u);
+    publisher.Release(reader);
+    publisher.RemoveReader(reader);
+}
+
+TEST(CdMapSnapshotTest, ConcurrentEditAndSearch) {
+    auto map = MakeMap();
+    map->SetSearchMode(cdSearchMode::GRID);
+    cdGridCoord start(2, 2);
+    cdGridCoord goal(12, 14);
+    map->SetCell(start, cdGridCell(cdGridCell::CellType::EMPTY));
+    map->SetCell(goal, cdGridCell(cdGridCell::CellType::EMPTY));
+    cdSnapshotPublisher publisher(*map);
+
+    std::atomic<bool> done(false);
+    std::atomic<int> searches(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t) {
+        readers.emplace_back([&]() {
+            int reader = publisher.AddReader();
+            cdAStar<cdGridCoord> aStar;
+            std::vector<cdGridCoord> path;
+            while (done.load() == false || searches.load() < 4) {
+                cdSnapshotGuard snapshot(publisher, reader);
+                auto version = snapshot->GetVersion();
+                path.clear();
+                aStar.FindPath(start, goal, snapshot.Get(), path);
+                // The snapshot never changed under the search.
+                EXPECT_EQ(snapshot->GetVersion(), version);
+                for (const auto& cell : path) {
+                    EXPECT_FALSE(snapshot->CellCollides(cell));
+                }
+                ++searches;
+            }
+            publisher.RemoveReader(reader);
+        });
+    }
+
+    std::minstd_rand rng(11);
+    for (int i = 0; i < 50; ++i) {
+        cdGridCoord cell(static_cast<int>(3 + rng() % 8), static_cast<int>(3 + rng() % 10));
+        map->SetCell(cell, cdGridCell(rng() % 2 == 0 ? cdGridCell::CellType::BLOCKED : cdGridCell::CellType::EMPTY));
+        publisher.Publish();
+    }
+    done = true;
+    for (auto& thread : readers) {
+        thread.join();
+    }
+
+    publisher.Reclaim();
+    EXPECT_GE(searches.load(), 4);
+    EXPECT_EQ(publisher.GetNumRetired(), 0u);
+}
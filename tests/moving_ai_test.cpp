@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include "cdAStar.hpp"
+#include "cdMovingAI.hpp"
+
+using namespace ceed::ai::path;
+
+TEST(CdMovingAITest, LoadMapAndScenarios) {
+    auto mapPath = ::testing::TempDir() + "cdmovingai_test.map";
+    auto scenPath = ::testing::TempDir() + "cdmovingai_test.map.scen";
+    {
+        std::ofstream map(mapPath);
+        map << "type octile\nheight 4\nwidth 5\nmap\n"
+            << ".....\n"
+            << ".@@T.\n"
+            << ".GSW.\n"
+            << ".....\n";
+        std::ofstream scen(scenPath);
+        scen << "version 1\n"
+             << "0\tcdmovingai_test.map\t5\t4\t0\t0\t4\t0\t4\n"
+             << "1\tcdmovingai_test.map\t5\t4\t0\t1\t4\t3\t4.82842712\n";
+    }
+
+    auto gridMap = LoadMovingAIMap(mapPath.c_str());
+    ASSERT_NE(gridMap, nullptr);
+    EXPECT_EQ(gridMap->GetNumCols(), 5);
+    EXPECT_EQ(gridMap->GetNumRows(), 4);
+    EXPECT_TRUE(gridMap->CellCollides(cdGridCoord(1, 1)));
+    EXPECT_TRUE(gridMap->CellCollides(cdGridCoord(3, 1)));
+    EXPECT_TRUE(gridMap->CellCollides(cdGridCoord(3, 2)));
+    EXPECT_FALSE(gridMap->CellCollides(cdGridCoord(1, 2)));
+    EXPECT_FALSE(gridMap->CellCollides(cdGridCoord(2, 2)));
+
+    std::vector<cdMovingAIScenario> scenarios;
+    ASSERT_TRUE(LoadMovingAIScenarios(scenPath.c_str(), scenarios));
+    ASSERT_EQ(scenarios.size(), 2);
+    EXPECT_EQ(scenarios[1].Bucket, 1);
+    EXPECT_EQ(scenarios[1].MapName, "cdmovingai_test.map");
+    EXPECT_EQ(scenarios[1].Start, cdGridCoord(0, 1));
+    EXPECT_EQ(scenarios[1].Goal, cdGridCoord(4, 3));
+    EXPECT_DOUBLE_EQ(scenarios[1].OptimalLength, 4.82842712);
+
+    gridMap->SetSearchMode(cdSearchMode::GRID);
+    gridMap->SetCornerRule(cdCornerRule::NEVER);
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+    ASSERT_TRUE(aStar.FindPath(scenarios[0].Start, scenarios[0].Goal, gridMap.get(), resultPath));
+    EXPECT_DOUBLE_EQ(GetOctilePathLength(resultPath), scenarios[0].OptimalLength);
+    EXPECT_GT(aStar.GetNumExpansions(), 0);
+
+    EXPECT_EQ(LoadMovingAIMap((::testing::TempDir() + "missing.map").c_str()), nullptr);
+}
+
+TEST(CdMovingAITest, LengthErrorWithDiagonalPinch) {
+    // (1, 2) and (2, 1) only touch diagonally between two blocked cells. The reference length
+    // goes around, 6 steps either way.
+    auto mapPath = ::testing::TempDir() + "cdmovingai_pinch.map";
+    {
+        std::ofstream map(mapPath);
+        map << "type octile\nheight 4\nwidth 4\nmap\n"
+            << "....\n"
+            << ".@..\n"
+            << "..@.\n"
+            << "....\n";
+    }
+    auto gridMap = LoadMovingAIMap(mapPath.c_str());
+    ASSERT_NE(gridMap, nullptr);
+
+    cdGridCoord start(1, 2);
+    cdGridCoord goal(2, 1);
+    const f64 optimalLength = 6;
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> resultPath;
+
+    EXPECT_TRUE(SetMovingAISearchMode(*gridMap, cdSearchMode::GRID));
+    ASSERT_TRUE(aStar.FindPath(start, goal, gridMap.get(), resultPath));
+    EXPECT_GE(GetPathLengthError(resultPath, optimalLength), 0.0);
+    EXPECT_DOUBLE_EQ(GetOctilePathLength(resultPath), optimalLength);
+
+    // JPS goes around as well.
+    EXPECT_TRUE(SetMovingAISearchMode(*gridMap, cdSearchMode::JUMP_POINT));
+    resultPath.clear();
+    ASSERT_TRUE(aStar.FindPath(start, goal, gridMap.get(), resultPath));
+    EXPECT_DOUBLE_EQ(GetOctilePathLength(resultPath), optimalLength);
+
+    // Corner cutting JPS squeezes through.
+    gridMap->SetCornerRule(cdCornerRule::ALWAYS);
+    resultPath.clear();
+    ASSERT_TRUE(aStar.FindPath(start, goal, gridMap.get(), resultPath));
+    EXPECT_LT(GetPathLengthError(resultPath, optimalLength), 0.0);
+}
+
+TEST(CdMovingAITest, JumpPointMatchesGridLengths) {
+    // Under the MovingAI rules JPS, with and without goal bounds, finds the GRID search's lengths.
+    auto mapPath = ::testing::TempDir() + "cdmovingai_random.map";
+    {
+        std::ofstream map(mapPath);
+        map << "type octile\nheight 32\nwidth 48\nmap\n";
+        unsigned seed = 5;
+        for (int y = 0; y < 32; ++y) {
+            for (int x = 0; x < 48; ++x) {
+                seed = seed * 1103515245u + 12345u;
+                map << ((seed >> 8) % 4 == 0 ? '@' : '.');
+            }
+            map << "\n";
+        }
+    }
+    auto gridMap = LoadMovingAIMap(mapPath.c_str());
+    ASSERT_NE(gridMap, nullptr);
+
+    cdAStar<cdGridCoord> aStar;
+    unsigned seed = 9;
+    int numFound = 0;
+    for (int query = 0; query < 60; ++query) {
+        seed = seed * 1103515245u + 12345u;
+        cdGridCoord start(static_cast<int>((seed >> 4) % 48), static_cast<int>((seed >> 12) % 32));
+        seed = seed * 1103515245u + 12345u;
+        cdGridCoord goal(static_cast<int>((seed >> 4) % 48), static_cast<int>((seed >> 12) % 32));
+        if (gridMap->CellCollides(start) || gridMap->CellCollides(goal)) {
+            continue;
+        }
+
+        std::vector<cdGridCoord> gridPath;
+        ASSERT_TRUE(SetMovingAISearchMode(*gridMap, cdSearchMode::GRID));
+        const bool found = aStar.FindPath(start, goal, gridMap.get(), gridPath);
+
+        std::vector<cdGridCoord> jumpPath;
+        ASSERT_TRUE(SetMovingAISearchMode(*gridMap, cdSearchMode::JUMP_POINT));
+        gridMap->SetLineOfSightShortcut(false);
+        ASSERT_EQ(aStar.FindPath(start, goal, gridMap.get(), jumpPath), found);
+        if (found == false) {
+            continue;
+        }
+        ++numFound;
+        EXPECT_NEAR(GetOctilePathLength(jumpPath), GetOctilePathLength(gridPath), 1e-4);
+        // No leg squeezes past a corner.
+        for (size_t i = 0; i + 1 < jumpPath.size(); ++i) {
+            EXPECT_TRUE(WalkSupercover(jumpPath[i + 1], jumpPath[i], [&](const cdGridCoord& cell) {
+                return gridMap->CellCollides(cell) == false;
+            }));
+        }
+
+        if (numFound == 1) {
+            gridMap->BuildGoalBounds();
+        }
+        jumpPath.clear();
+        ASSERT_TRUE(aStar.FindPath(start, goal, gridMap.get(), jumpPath));
+        EXPECT_NEAR(GetOctilePathLength(jumpPath), GetOctilePathLength(gridPath), 1e-4);
+    }
+    EXPECT_GT(numFound, 10);
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include "cdPathCache.hpp"
+#include "test_maps.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+// Every cell of the path, its jump point legs walked a step at a time.
+std::vector<cdGridCoord> GetCells(const std::vector<cdGridCoord>& path) {
+    std::vector<cdGridCoord> cells;
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        auto cell = path[i];
+        while (cell != path[i + 1]) {
+            cells.push_back(cell);
+            cell.X += (path[i + 1].X > cell.X) - (path[i + 1].X < cell.X);
+            cell.Y += (path[i + 1].Y > cell.Y) - (path[i + 1].Y < cell.Y);
+        }
+    }
+    cells.push_back(path.back());
+    return cells;
+}
+}
+
+TEST(CdPathCacheTest, ChunkVersions) {
+    auto map = MakeRandomMap(100, 70, 2, 6, true);
+    EXPECT_EQ(map->GetNumChunks(), 4 * 3);
+    EXPECT_EQ(map->GetChunkIndex(cdGridCoord(99, 69)), 11);
+
+    std::vector<u32> versions;
+    for (int chunk = 0; chunk < map->GetNumChunks(); ++chunk) {
+        versions.push_back(map->GetChunkVersion(chunk));
+    }
+
+    // A threat edit stays in its chunk, a wall reaches the neighbours' moves across the border.
+    map->SetThreat(cdGridCoord(40, 40), 0.5f);
+    cdGridCell wall(cdGridCell::CellType::BLOCKED);
+    map->SetCell(cdGridCoord(31, 10), map->CellCollides(cdGridCoord(31, 10)) ? cdGridCell() : wall);
+    for (int chunk = 0; chunk < map->GetNumChunks(); ++chunk) {
+        const bool edited = chunk == 5 || chunk == 0 || chunk == 1;
+        EXPECT_EQ(map->GetChunkVersion(chunk) != versions[chunk], edited) << chunk;
+    }
+
+    // Cost settings leave the chunks alone, only the map version moves.
+    for (int chunk = 0; chunk < map->GetNumChunks(); ++chunk) {
+        versions[chunk] = map->GetChunkVersion(chunk);
+    }
+    auto version = map->GetVersion();
+    map->SetThreatWeight(2.0f);
+    map->SetDiagonalStepLength(1.41421356f);
+    for (int chunk = 0; chunk < map->GetNumChunks(); ++chunk) {
+        EXPECT_EQ(map->GetChunkVersion(chunk), versions[chunk]);
+    }
+    EXPECT_NE(map->GetVersion(), version);
+
+    // Writes that leave the quantized threat and the type as they were change nothing searches read.
+    version = map->GetVersion();
+    map->SetCell(cdGridCoord(40, 40), map->GetCell(cdGridCoord(40, 40)));
+    map->SetThreat(cdGridCoord(40, 40), 0.5f + 0.1f / 255.0f);
+    for (int chunk = 0; chunk < map->GetNumChunks(); ++chunk) {
+        EXPECT_EQ(map->GetChunkVersion(chunk), versions[chunk]);
+    }
+    EXPECT_EQ(map->GetVersion(), version);
+}
+
+TEST(CdPathCacheTest, InvalidatesOnlyEditedChunks) {
+    auto map = MakeRandomMap(128, 128, 5, 6, true);
+    map->SetCostMode(cdCostMode::THREAT_WEIGHTED);
+    cdGridCoord start(5, 5), goal(40, 20), farGoal(120, 120);
+    for (auto cell : { start, goal, farGoal }) {
+        map->SetCell(cell, cdGridCell());
+    }
+
+    cdPathCache cache(*map);
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> direct, cached;
+    ASSERT_TRUE(aStar.FindPath(start, goal, map.get(), direct));
+    ASSERT_TRUE(cache.FindPath(aStar, start, goal, cached));
+    EXPECT_EQ(cached, direct);
+    EXPECT_EQ(cache.GetNumMisses(), 1u);
+
+    cached.clear();
+    ASSERT_TRUE(cache.FindPath(aStar, start, goal, cached));
+    EXPECT_EQ(cached, direct);
+    EXPECT_EQ(cache.GetNumHits(), 1u);
+    EXPECT_FLOAT_EQ(cache.GetHitRate(), 0.5f);
+    EXPECT_GT(cache.GetMemoryUsage(), direct.size() * sizeof(cdGridCoord));
+
+    // Far from the path, it survives.
+    map->SetThreat(cdGridCoord(100, 100), 0.9f);
+    cached.clear();
+    ASSERT_TRUE(cache.FindPath(aStar, start, goal, cached));
+    EXPECT_EQ(cache.GetNumHits(), 2u);
+
+    // Walling a cell of it off does not.
+    const auto blocked = direct[direct.size() / 2];
+    map->SetCell(blocked, cdGridCell(cdGridCell::CellType::BLOCKED));
+    cached.clear();
+    direct.clear();
+    ASSERT_TRUE(cache.FindPath(aStar, start, goal, cached));
+    ASSERT_TRUE(aStar.FindPath(start, goal, map.get(), direct));
+    EXPECT_EQ(cached, direct);
+    EXPECT_EQ(std::find(cached.begin(), cached.end(), blocked), cached.end());
+    EXPECT_EQ(cache.GetNumInvalidations(), 1u);
+    EXPECT_EQ(cache.GetNumMisses(), 2u);
+    EXPECT_EQ(cache.GetNumPaths(), 1u);
+
+    // Other search settings never match, cost table included.
+    map->SetThreatWeight(4.0f);
+    cached.clear();
+    ASSERT_TRUE(cache.FindPath(aStar, start, goal, cached));
+    EXPECT_EQ(cache.GetNumMisses(), 3u);
+
+    map->SetCostMode(cdCostMode::DISTANCE);
+    cached.clear();
+    ASSERT_TRUE(cache.FindPath(aStar, start, goal, cached));
+    EXPECT_EQ(cache.GetNumMisses(), 4u);
+
+    // Shrinking to the latest path drops the one used longest ago.
+    const auto usage = cache.GetMemoryUsage();
+    cached.clear();
+    ASSERT_TRUE(cache.FindPath(aStar, start, farGoal, cached));
+    EXPECT_EQ(cache.GetNumPaths(), 2u);
+    cache.SetMemoryBudget(cache.GetMemoryUsage() - usage);
+    EXPECT_EQ(cache.GetNumPaths(), 1u);
+    EXPECT_LE(cache.GetMemoryUsage(), cache.GetMemoryBudget());
+    cached.clear();
+    ASSERT_TRUE(cache.FindPath(aStar, start, farGoal, cached));
+    EXPECT_EQ(cache.GetNumHits(), 3u);
+
+    cache.Clear();
+    EXPECT_EQ(cache.GetNumPaths(), 0u);
+    EXPECT_EQ(cache.GetMemoryUsage(), 0u);
+}
+
+TEST(CdPathCacheTest, JumpPointLegs) {
+    auto map = MakeRandomMap(128, 128, 9, 6, true);
+    map->SetSearchMode(cdSearchMode::JUMP_POINT);
+    cdGridCoord start(2, 2), goal(120, 100);
+    map->SetCell(start, cdGridCell());
+    map->SetCell(goal, cdGridCell());
+
+    cdPathCache cache(*map);
+    cdAStar<cdGridCoord> aStar;
+    std::vector<cdGridCoord> path;
+    ASSERT_TRUE(cache.FindPath(aStar, start, goal, path));
+
+    // A cell the path only crosses between jump points.
+    auto cells = GetCells(path);
+    cdGridCoord crossed = cells[cells.size() / 2];
+    for (const auto& cell : cells) {
+        if (std::find(path.begin(), path.end(), cell) == path.end() &&
+            map->GetChunkIndex(cell) != map->GetChunkIndex(start) && map->GetChunkIndex(cell) != map->GetChunkIndex(goal)) {
+            crossed = cell;
+            break;
+        }
+    }
+    map->SetThreat(crossed, 0.75f);
+
+    path.clear();
+    ASSERT_TRUE(cache.FindPath(aStar, start, goal, path));
+    EXPECT_EQ(cache.GetNumHits(), 0u);
+    EXPECT_EQ(cache.GetNumInvalidations(), 1u);
+}
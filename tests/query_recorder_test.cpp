@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "cdAStar.hpp"
+#include "cdQueryRecorder.hpp"
+
+using namespace ceed::ai::path;
+
+TEST(CdQueryRecorderTest, RecordAndLoad) {
+    auto path = ::testing::TempDir() + "cdqueryrecorder_test.cdql";
+    cdPoint2f dimension(10, 10);
+    cdGridCellList cells(100, cdGridCell());
+    for (int y = 0; y < 9; ++y) {
+        cells[y * 10 + 4].Type = cdGridCell::CellType::BLOCKED;
+    }
+    cdGridMap map(std::move(cells), 10, 10, dimension);
+    map.SetMapId(7);
+    map.SetSearchMode(cdSearchMode::GRID);
+    map.SetCornerRule(cdCornerRule::NEVER);
+    map.SetCostMode(cdCostMode::THREAT_WEIGHTED);
+    map.SetThreatWeight(3.0f);
+    map.SetThreatScale(2.0f);
+    map.SetDiagonalStepLength(std::sqrt(2.0f));
+    map.SetLineOfSightShortcut(false);
+
+    cdQueryRecorder recorder;
+    ASSERT_TRUE(recorder.Open(path.c_str()));
+
+    cdAStar<cdGridCoord> aStar;
+    recorder.Attach(aStar);
+    std::vector<cdGridCoord> resultPath;
+    EXPECT_TRUE(aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(9, 0), &map, resultPath));
+    auto expansions = aStar.GetNumExpansions();
+
+    // Edits bump the version the next query is logged with.
+    auto version = map.GetVersion();
+    map.SetCell(cdGridCoord(4, 9), cdGridCell(cdGridCell::CellType::BLOCKED));
+    EXPECT_GT(map.GetVersion(), version);
+
+    std::vector<cdGridCoord> goals = { cdGridCoord(9, 0), cdGridCoord(9, 9) };
+    resultPath.clear();
+    EXPECT_FALSE(aStar.FindPath(cdGridCoord(0, 0), goals, &map, resultPath));
+
+    // Detached searches are not logged.
+    cdQueryRecorder::Detach(aStar);
+    resultPath.clear();
+    aStar.FindPath(cdGridCoord(0, 0), cdGridCoord(1, 1), &map, resultPath);
+    EXPECT_EQ(recorder.GetNumRecords(), 2u);
+    recorder.Close();
+
+    std::vector<cdQueryRecord> records;
+    ASSERT_TRUE(cdQueryRecorder::Load(path.c_str(), records));
+    ASSERT_EQ(records.size(), 2u);
+
+    EXPECT_EQ(records[0].MapId, 7u);
+    EXPECT_EQ(records[0].MapVersion, version);
+    EXPECT_EQ(records[0].Start, cdGridCoord(0, 0));
+    ASSERT_EQ(records[0].Goals.size(), 1u);
+    EXPECT_EQ(records[0].Goals[0], cdGridCoord(9, 0));
+    EXPECT_EQ(records[0].SearchMode, cdSearchMode::GRID);
+    EXPECT_EQ(records[0].CornerRule, cdCornerRule::NEVER);
+    EXPECT_EQ(records[0].CostMode, cdCostMode::THREAT_WEIGHTED);
+    EXPECT_EQ(records[0].AgentSize, 1);
+    EXPECT_EQ(records[0].ThreatWeight, 3.0f);
+    EXPECT_EQ(records[0].ThreatScale, 2.0f);
+    EXPECT_EQ(records[0].DiagonalStepLength, std::sqrt(2.0f));
+    EXPECT_FALSE(records[0].LineOfSightShortcut);
+    EXPECT_TRUE(records[0].Found);
+    EXPECT_EQ(records[0].Expansions, expansions);
+    EXPECT_GE(records[0].LatencyUs, 0.0f);
+
+    EXPECT_EQ(records[1].MapVersion, map.GetVersion());
+    EXPECT_EQ(records[1].Goals, goals);
+    EXPECT_FALSE(records[1].Found);
+}
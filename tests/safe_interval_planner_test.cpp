@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+#include <bit>
+#include <random>
+#include <set>
+#include "cdSafeIntervalPlanner.hpp"
+#include "test_maps.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+std::vector<cdGridCoord> GetMoves(const cdGridMap& map, const cdGridCoord& cell) {
+    std::vector<cdGridCoord> moves;
+    unsigned mask = map.GetCellMoves(cell);
+    while (mask != 0) {
+        auto dir = std::countr_zero(mask);
+        mask &= mask - 1;
+        moves.push_back(cdGridCoord(cell.X + k_GridDirections[dir].X, cell.Y + k_GridDirections[dir].Y));
+    }
+    return moves;
+}
+}
+
+TEST(CdSafeIntervalPlannerTest, SafeIntervals) {
+    auto map = MakeRandomMap(8, 8, 1, 8);
+    map->SetCell(cdGridCoord(2, 2), cdGridCell(cdGridCell::CellType::EMPTY));
+    map->SetCell(cdGridCoord(3, 2), cdGridCell(cdGridCell::CellType::EMPTY));
+    map->SetCell(cdGridCoord(5, 5), cdGridCell(cdGridCell::CellType::BLOCKED));
+    cdSafeIntervalPlanner planner(*map);
+    EXPECT_EQ(planner.AddObstacle({ cdGridCoord(2, 2), cdGridCoord(2, 2), cdGridCoord(3, 2), cdGridCoord(2, 2) }, 3), 0);
+
+    const auto& intervals = planner.GetSafeIntervals(cdGridCoord(2, 2));
+    ASSERT_EQ(intervals.size(), 3u);
+    EXPECT_EQ(intervals[0].Begin, 0u);
+    EXPECT_EQ(intervals[0].End, 2u);
+    EXPECT_EQ(intervals[1].Begin, 5u);
+    EXPECT_EQ(intervals[1].End, 5u);
+    EXPECT_EQ(intervals[2].Begin, 7u);
+    EXPECT_EQ(intervals[2].End, cdSafeIntervalPlanner::k_Forever);
+
+    EXPECT_EQ(planner.GetSafeIntervals(cdGridCoord(3, 2)).size(), 2u);
+    EXPECT_EQ(planner.GetSafeIntervals(cdGridCoord(0, 7)).size(), map->CellCollides(cdGridCoord(0, 7)) ? 0u : 1u);
+    EXPECT_TRUE(planner.GetSafeIntervals(cdGridCoord(5, 5)).empty());
+
+    planner.ClearObstacles();
+    EXPECT_EQ(planner.GetSafeIntervals(cdGridCoord(2, 2)).size(), 1u);
+}
+
+TEST(CdSafeIntervalPlannerTest, WaitsForPlatform) {
+    // A bridge of one cell that a platform crosses, the agent has to let it pass.
+    cdGridCellList cells(5 * 3, cdGridCell(cdGridCell::CellType::BLOCKED));
+    for (int x = 0; x < 5; ++x) {
+        cells[5 + x] = cdGridCell(cdGridCell::CellType::EMPTY);
+    }
+    cdGridMap map(std::move(cells), 5, 3, cdPoint2f(5.0f, 3.0f));
+    map.SetSearchMode(cdSearchMode::GRID);
+
+    cdSafeIntervalPlanner planner(map);
+    planner.AddObstacle({ cdGridCoord(2, 1), cdGridCoord(2, 1), cdGridCoord(2, 1), cdGridCoord(2, 1) }, 0);
+
+    std::vector<cdTimedCell> path;
+    ASSERT_TRUE(planner.FindPath(cdGridCoord(0, 1), 0, cdGridCoord(4, 1), path));
+    EXPECT_EQ(path.back().Cell, cdGridCoord(4, 1));
+    EXPECT_EQ(path.back().Time, 6u);
+    ASSERT_EQ(path.size(), 7u);
+    EXPECT_EQ(path[4].Cell, cdGridCoord(2, 1));
+
+    // The platform never leaves the goal.
+    planner.AddObstacle({ cdGridCoord(4, 1) }, 0);
+    planner.AddObstacle(std::vector<cdGridCoord>(100, cdGridCoord(4, 1)), 1);
+    EXPECT_TRUE(planner.FindPath(cdGridCoord(0, 1), 0, cdGridCoord(4, 1), path));
+    EXPECT_EQ(path.back().Time, 101u);
+}
+
+TEST(CdSafeIntervalPlannerTest, MatchesTimeExpandedSearch) {
+    const int cols = 16, rows = 16;
+    const u32 horizon = 40;
+    auto map = MakeRandomMap(cols, rows, 7, 8);
+    cdSafeIntervalPlanner planner(*map);
+
+    // Random walkers, each tick a cell of theirs.
+    std::minstd_rand rng(3);
+    std::vector<std::vector<cdGridCoord>> walkers;
+    while (walkers.size() < 12) {
+        cdGridCoord cell(static_cast<int>(rng() % cols), static_cast<int>(rng() % rows));
+        if (map->CellCollides(cell)) {
+            continue;
+        }
+        std::vector<cdGridCoord> walk = { cell };
+        for (u32 t = 1; t < horizon; ++t) {
+            auto moves = GetMoves(*map, walk.back());
+            walk.push_back(moves.empty() || rng() % 4 == 0 ? walk.back() : moves[rng() % moves.size()]);
+        }
+        planner.AddObstacle(walk, 0);
+        walkers.push_back(walk);
+    }
+
+    auto occupied = [&](const cdGridCoord& cell, u32 time) {
+        for (const auto& walk : walkers) {
+            if (time < walk.size() && walk[time] == cell) {
+                return true;
+            }
+        }
+        return false;
+    };
+    auto swaps = [&](const cdGridCoord& from, const cdGridCoord& to, u32 arrival) {
+        for (const auto& walk : walkers) {
+            if (arrival < walk.size() && walk[arrival - 1] == to && walk[arrival] == from) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    int compared = 0;
+    for (int query = 0; query < 30; ++query) {
+        cdGridCoord start(static_cast<int>(rng() % cols), static_cast<int>(rng() % rows));
+        cdGridCoord goal(static_cast<int>(rng() % cols), static_cast<int>(rng() % rows));
+        const u32 startTime = rng() % 10;
+        if (map->CellCollides(start) || map->CellCollides(goal) || occupied(start, startTime)) {
+            continue;
+        }
+
+        // Every (cell, tick) reachable, a layer per tick.
+        u32 expected = cdSafeIntervalPlanner::k_Forever;
+        std::set<std::pair<int, int>> layer = { { start.X, start.Y } };
+        for (u32 time = startTime; time < horizon + cols * rows && layer.empty() == false; ++time) {
+            if (layer.count({ goal.X, goal.Y }) != 0) {
+                bool staysSafe = true;
+                for (u32 later = time; later < horizon; ++later) {
+                    staysSafe = staysSafe && occupied(goal, later) == false;
+                }
+                if (staysSafe) {
+                    expected = time;
+                    break;
+                }
+            }
+
+            std::set<std::pair<int, int>> nextLayer;
+            for (const auto& [x, y] : layer) {
+                cdGridCoord cell(x, y);
+                auto moves = GetMoves(*map, cell);
+                moves.push_back(cell);
+                for (const auto& next : moves) {
+                    if (occupied(next, time + 1) == false && (next == cell || swaps(cell, next, time + 1) == false)) {
+                        nextLayer.insert({ next.X, next.Y });
+                    }
+                }
+            }
+            layer.swap(nextLayer);
+        }
+
+        std::vector<cdTimedCell> path;
+        const bool found = planner.FindPath(start, startTime, goal, path);
+        ASSERT_EQ(found, expected != cdSafeIntervalPlanner::k_Forever);
+        if (found == false) {
+            continue;
+        }
+        ++compared;
+        EXPECT_EQ(path.back().Time, expected);
+        EXPECT_EQ(path.back().Cell, goal);
+        EXPECT_EQ(path.front().Cell, start);
+        ASSERT_EQ(path.size(), expected - startTime + 1);
+
+        for (size_t i = 1; i < path.size(); ++i) {
+            const auto& from = path[i - 1].Cell;
+            const auto& to = path[i].Cell;
+            EXPECT_EQ(path[i].Time, path[i - 1].Time + 1);
+            EXPECT_FALSE(occupied(to, path[i].Time));
+            if (from != to) {
+                auto moves = GetMoves(*map, from);
+                EXPECT_NE(std::find(moves.begin(), moves.end(), to), moves.end());
+                EXPECT_FALSE(swaps(from, to, path[i].Time));
+            }
+        }
+    }
+    EXPECT_GT(compared, 10);
+}
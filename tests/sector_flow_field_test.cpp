@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "cdSectorFlowField.hpp"
+
+using namespace ceed::ai::path;
+
+namespace {
+constexpr int kCols = 128;
+constexpr int kRows = 64;
+constexpr int kSectorSize = 16;
+
+// Open field with a wall down x = 40 that has one gap at the bottom, and a wall inside the
+// sector at (48..63, 16..31) that splits it into two regions joined only through other sectors.
+std::unique_ptr<cdGridMap> MakeMap() {
+    cdGridCellList cells(kCols * kRows, cdGridCell());
+    for (int y = 0; y < kRows - 4; ++y) {
+        cells[y * kCols + 40].Type = cdGridCell::CellType::BLOCKED;
+    }
+    for (int y = 16; y < 32; ++y) {
+        cells[y * kCols + 56].Type = cdGridCell::CellType::BLOCKED;
+    }
+    return std::make_unique<cdGridMap>(std::move(cells), kCols, kRows,
+        cdPoint2f(static_cast<f32>(kCols), static_cast<f32>(kRows)));
+}
+
+// Follows the field to the goal, returns the cost walked or -1 when it gets stuck.
+f32 Walk(cdGridMap& map, const cdSectorFlowField& field, cdGridCoord cell, const cdGridCoord& goal) {
+    f32 walked = 0.0f;
+    for (int steps = 0; steps < kCols * kRows && cell != goal; ++steps) {
+        auto next = field.GetNextCell(cell, goal);
+        if (next == cell || map.CellCollides(next)) {
+            return -1.0f;
+        }
+        walked += map.GetMovementCost(cell, next);
+        cell = next;
+    }
+    return cell == goal ? walked : -1.0f;
+}
+}
+
+TEST(CdSectorFlowFieldTest, IntegratesOnlyTheSectorPath) {
+    auto map = MakeMap();
+    cdSectorFlowField field(*map, kSectorSize);
+    cdGridCoord goal(120, 8);
+    cdGridCoord start(4, 4);
+
+    ASSERT_TRUE(field.Prepare(start, goal));
+    const auto walked = Walk(*map, field, start, goal);
+    EXPECT_NEAR(walked, field.GetDistance(start, goal), 1e-3f);
+    EXPECT_LT(field.GetNumCachedSectors(), static_cast<size_t>(field.GetGraph().GetNumSectors()));
+
+    // Never shorter than the whole map field.
+    cdFlowField full;
+    ASSERT_TRUE(full.Build(*map, { goal }));
+    EXPECT_GE(field.GetDistance(start, goal), full.GetDistance(start) - 1e-3f);
+
+    // A second group starting nearby reuses most of the path, the same start reuses all of it.
+    const auto integrations = field.GetNumIntegrations();
+    ASSERT_TRUE(field.Prepare(start, goal));
+    EXPECT_EQ(field.GetNumIntegrations(), integrations);
+    cdGridCoord other(4, 40);
+    ASSERT_TRUE(field.Prepare(other, goal));
+    EXPECT_GT(Walk(*map, field, other, goal), 0.0f);
+    EXPECT_LT(field.GetNumIntegrations() - integrations, integrations);
+
+    // Other goals get their own fields.
+    EXPECT_EQ(field.GetDirection(start, cdGridCoord(100, 50)), cdFlowField::k_NoDirection);
+
+    // Settings that change step costs drop the cached fields like an edit does.
+    const auto prepared = field.GetNumIntegrations();
+    map->SetThreatWeight(2.0f);
+    ASSERT_TRUE(field.Prepare(start, goal));
+    EXPECT_GT(field.GetNumIntegrations(), prepared);
+}
+
+TEST(CdSectorFlowFieldTest, SplitSectorsAndEdits) {
+    auto map = MakeMap();
+    cdSectorFlowField field(*map, kSectorSize);
+    EXPECT_EQ(field.GetGraph().GetNumSectors(), (kCols / kSectorSize) * (kRows / kSectorSize));
+
+    // Both sides of the inner wall live in the same sector but are different regions.
+    cdSectorGraph graph(*map, kSectorSize);
+    auto left = graph.GetRegion(cdGridCoord(50, 20));
+    auto right = graph.GetRegion(cdGridCoord(60, 20));
+    EXPECT_EQ(left.Sector, right.Sector);
+    EXPECT_NE(left.Region, right.Region);
+    EXPECT_EQ(graph.GetRegion(cdGridCoord(56, 20)).Region, -1);
+
+    cdGridCoord goal(60, 20);
+    ASSERT_TRUE(field.Prepare(cdGridCoord(50, 20), goal));
+    EXPECT_GT(Walk(*map, field, cdGridCoord(50, 20), goal), 0.0f);
+
+    // Closing the gap in the long wall cuts the left side off, the cached fields go with the edit.
+    EXPECT_TRUE(field.Prepare(goal, goal));
+    for (int y = kRows - 4; y < kRows; ++y) {
+        map->SetCell(cdGridCoord(40, y), cdGridCell(cdGridCell::CellType::BLOCKED));
+    }
+    EXPECT_FALSE(field.Prepare(cdGridCoord(4, 4), goal));
+    EXPECT_EQ(field.GetDistance(cdGridCoord(50, 20), goal), cdFlowField::k_Unreachable);
+    EXPECT_FALSE(field.Prepare(cdGridCoord(40, 10), goal));
+}
@@ -0,0 +1,31 @@
+#ifndef _TEST_MAPS_HPP_
+#define _TEST_MAPS_HPP_
+
+#include <memory>
+#include <random>
+#include "cdGridMap.hpp"
+
+namespace ceed::ai::path {
+// Random GRID mode map. Each cell is blocked one time in blockedOneIn, never when it is 0. With
+// threat every cell also gets a threat in [0, 1) in steps of 0.01. The same seed and parameters
+// always give the same map.
+inline std::unique_ptr<cdGridMap> MakeRandomMap(int cols, int rows, u32 seed, int blockedOneIn,
+    bool threat = false) {
+    cdGridCellList cells;
+    std::minstd_rand rng(seed);
+    for (int i = 0; i < cols * rows; ++i) {
+        const bool blocked = blockedOneIn > 0 && rng() % blockedOneIn == 0;
+        cdGridCell cell(blocked ? cdGridCell::CellType::BLOCKED : cdGridCell::CellType::EMPTY);
+        if (threat) {
+            cell.Threat = static_cast<f32>(rng() % 100) / 100.0f;
+        }
+        cells.push_back(cell);
+    }
+    auto map = std::make_unique<cdGridMap>(std::move(cells), cols, rows,
+        cdPoint2f(static_cast<f32>(cols), static_cast<f32>(rows)));
+    map->SetSearchMode(cdSearchMode::GRID);
+    return map;
+}
+}
+
+#endif